@@ -0,0 +1,87 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <pow.h>
+#include <sync.h>
+#include <txdb.h>
+#include <util.h>
+#include <validation.h>
+
+#include <vector>
+
+static const int NUM_BLOCK_INDEX_ENTRIES = 600000;
+
+// Load a block index of 600k synthetic headers from an in-memory block tree
+// database, as happens at every startup: read the entries, check their proof
+// of work unless a previous load already did, link them into mapBlockIndex
+// and compute the chain work.
+static void LoadBlockIndexBench(benchmark::State& state, bool already_verified)
+{
+    // The block tree database is opened under the data directory, so point
+    // that at a scratch location for the duration of the benchmark.
+    SelectParams(CBaseChainParams::REGTEST);
+    const fs::path data_dir = fs::temp_directory_path() / fs::unique_path("bench_bitcoin_%%%%%%%%");
+    fs::create_directories(data_dir);
+    gArgs.ForceSetArg("-datadir", data_dir.string());
+    ClearDatadirCache();
+
+    const CChainParams& chain_params = Params();
+    const Consensus::Params& consensus_params = chain_params.GetConsensus();
+
+    std::vector<uint256> hashes(NUM_BLOCK_INDEX_ENTRIES);
+    std::vector<CBlockIndex> entries(NUM_BLOCK_INDEX_ENTRIES);
+    std::vector<const CBlockIndex*> blockinfo;
+    blockinfo.reserve(NUM_BLOCK_INDEX_ENTRIES);
+    CBlockHeader header = chain_params.GenesisBlock().GetBlockHeader();
+    for (int i = 0; i < NUM_BLOCK_INDEX_ENTRIES; ++i) {
+        if (i > 0) {
+            header.hashPrevBlock = hashes[i - 1];
+            header.nTime += 600;
+            // The regtest proof of work limit lets about every other hash pass.
+            while (!CheckProofOfWork(header.GetHash(), header.nBits, consensus_params)) ++header.nNonce;
+        }
+        hashes[i] = header.GetHash();
+        CBlockIndex& entry = entries[i];
+        entry = CBlockIndex(header);
+        entry.phashBlock = &hashes[i];
+        entry.pprev = i > 0 ? &entries[i - 1] : nullptr;
+        entry.nHeight = i;
+        entry.nTx = 1;
+        entry.RaiseValidity(BLOCK_VALID_TREE);
+        blockinfo.push_back(&entry);
+    }
+
+    pblocktree.reset(new CBlockTreeDB(1 << 20, true /* fMemory */, true /* fWipe */));
+    pblocktree->WriteBatchSync({}, 0, blockinfo);
+    pblocktree->WriteFlag("blockindexverified", already_verified);
+
+    while (state.KeepRunning()) {
+        LOCK(cs_main);
+        if (!already_verified) pblocktree->WriteFlag("blockindexverified", false);
+        LoadBlockIndex(chain_params);
+        assert(mapBlockIndex.size() == NUM_BLOCK_INDEX_ENTRIES);
+        UnloadBlockIndex();
+    }
+
+    pblocktree.reset();
+    fs::remove_all(data_dir);
+    gArgs.ForceSetArg("-datadir", "");
+    ClearDatadirCache();
+}
+
+static void LoadBlockIndex600k(benchmark::State& state)
+{
+    LoadBlockIndexBench(state, true);
+}
+
+static void LoadBlockIndex600kUnverified(benchmark::State& state)
+{
+    LoadBlockIndexBench(state, false);
+}
+
+BENCHMARK(LoadBlockIndex600k, 1);
+BENCHMARK(LoadBlockIndex600kUnverified, 1);
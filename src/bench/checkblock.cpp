@@ -32,6 +32,29 @@ static void DeserializeBlockTest(benchmark::State& state)
     }
 }
 
+// Deserialize the block from bytes held elsewhere, as a database value or a
+// received message is: either copied into a CDataStream first, or read in
+// place through a SpanReader.
+static void DeserializeBlockCopiedTest(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        CDataStream stream((const char*)block_bench::block413567,
+                (const char*)&block_bench::block413567[sizeof(block_bench::block413567)],
+                SER_NETWORK, PROTOCOL_VERSION);
+        CBlock block;
+        stream >> block;
+    }
+}
+
+static void DeserializeBlockSpanTest(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        SpanReader stream(SER_NETWORK, PROTOCOL_VERSION, block_bench::block413567, sizeof(block_bench::block413567));
+        CBlock block;
+        stream >> block;
+    }
+}
+
 static void DeserializeAndCheckBlockTest(benchmark::State& state)
 {
     CDataStream stream((const char*)block_bench::block413567,
@@ -52,5 +75,69 @@ static void DeserializeAndCheckBlockTest(benchmark::State& state)
     }
 }
 
+// Weigh every transaction of the block, as mempool acceptance, mining and
+// fee estimation do for the transactions they handle.
+static void BlockTransactionWeights(benchmark::State& state)
+{
+    CDataStream stream((const char*)block_bench::block413567,
+            (const char*)&block_bench::block413567[sizeof(block_bench::block413567)],
+            SER_NETWORK, PROTOCOL_VERSION);
+    CBlock block;
+    stream >> block;
+    // Header and transaction count are not part of any transaction.
+    const int64_t expected_weight = GetBlockWeight(block) - WITNESS_SCALE_FACTOR * (80 + GetSizeOfCompactSize(block.vtx.size()));
+
+    while (state.KeepRunning()) {
+        int64_t weight = 0;
+        for (const CTransactionRef& tx : block.vtx) {
+            weight += GetTransactionWeight(*tx);
+        }
+        assert(weight == expected_weight);
+    }
+}
+
+// Compute the serialized size of the block with and without witness data, as
+// CheckBlock and GetBlockWeight do.
+static void BlockSerializeSize(benchmark::State& state)
+{
+    CDataStream stream((const char*)block_bench::block413567,
+            (const char*)&block_bench::block413567[sizeof(block_bench::block413567)],
+            SER_NETWORK, PROTOCOL_VERSION);
+    CBlock block;
+    stream >> block;
+    const size_t stripped_size = ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS);
+
+    while (state.KeepRunning()) {
+        assert(::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION) == sizeof(block_bench::block413567));
+        assert(::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS) == stripped_size);
+    }
+}
+
+// The same for mutable copies of the transactions, which have no cached sizes,
+// so that every input, output, script and witness stack is visited.
+static void MutableTransactionsSerializeSize(benchmark::State& state)
+{
+    CDataStream stream((const char*)block_bench::block413567,
+            (const char*)&block_bench::block413567[sizeof(block_bench::block413567)],
+            SER_NETWORK, PROTOCOL_VERSION);
+    CBlock block;
+    stream >> block;
+    std::vector<CMutableTransaction> txs;
+    for (const CTransactionRef& tx : block.vtx) {
+        txs.emplace_back(*tx);
+    }
+    const size_t stripped_size = ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS) - 80;
+
+    while (state.KeepRunning()) {
+        assert(::GetSerializeSize(txs, SER_NETWORK, PROTOCOL_VERSION) == sizeof(block_bench::block413567) - 80);
+        assert(::GetSerializeSize(txs, SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS) == stripped_size);
+    }
+}
+
 BENCHMARK(DeserializeBlockTest, 130);
+BENCHMARK(DeserializeBlockCopiedTest, 130);
+BENCHMARK(DeserializeBlockSpanTest, 130);
 BENCHMARK(DeserializeAndCheckBlockTest, 160);
+BENCHMARK(BlockTransactionWeights, 500);
+BENCHMARK(BlockSerializeSize, 500);
+BENCHMARK(MutableTransactionsSerializeSize, 100);
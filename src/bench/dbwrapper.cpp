@@ -0,0 +1,60 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <coins.h>
+#include <dbwrapper.h>
+#include <fs.h>
+#include <random.h>
+#include <util.h>
+
+#include <vector>
+
+static const char DB_COIN = 'C';
+static const int NUM_COINS = 200000;
+
+// Look up random outpoints that are not in a chainstate-like database of
+// coins, as CCoinsViewDB::GetCoin does for outputs that were created and
+// spent without being flushed. The cache is kept small so that lookups
+// have to consult the tables on disk.
+static void CoinsDBMiss(benchmark::State& state, int bloom_bits)
+{
+    gArgs.ForceSetArg("-dbbloombits", std::to_string(bloom_bits));
+    const fs::path path = fs::temp_directory_path() / fs::unique_path("bench_coinsdb_%%%%%%%%");
+    {
+        CDBWrapper db(path, 1 << 20, false /* fMemory */, true /* fWipe */, true /* obfuscate */);
+        const Coin coin(CTxOut(COIN, CScript() << OP_1), 1, false);
+        CDBBatch batch(db);
+        for (int i = 0; i < NUM_COINS; i++) {
+            batch.Write(std::make_pair(DB_COIN, COutPoint(GetRandHash(), 0)), coin);
+            if (batch.SizeEstimate() > (1 << 20)) {
+                db.WriteBatch(batch);
+                batch.Clear();
+            }
+        }
+        db.WriteBatch(batch);
+
+        FastRandomContext rng(true);
+        while (state.KeepRunning()) {
+            for (int i = 0; i < 100; i++) {
+                db.Exists(std::make_pair(DB_COIN, COutPoint(rng.rand256(), 0)));
+            }
+        }
+    }
+    fs::remove_all(path);
+    gArgs.ForceSetArg("-dbbloombits", std::to_string(DEFAULT_DB_BLOOM_BITS));
+}
+
+static void CoinsDBMissBloom(benchmark::State& state)
+{
+    CoinsDBMiss(state, DEFAULT_DB_BLOOM_BITS);
+}
+
+static void CoinsDBMissNoBloom(benchmark::State& state)
+{
+    CoinsDBMiss(state, 0);
+}
+
+BENCHMARK(CoinsDBMissBloom, 100);
+BENCHMARK(CoinsDBMissNoBloom, 100);
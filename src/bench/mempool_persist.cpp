@@ -0,0 +1,121 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <coins.h>
+#include <consensus/validation.h>
+#include <fs.h>
+#include <key.h>
+#include <keystore.h>
+#include <pubkey.h>
+#include <random.h>
+#include <scheduler.h>
+#include <script/sigcache.h>
+#include <script/sign.h>
+#include <script/standard.h>
+#include <sync.h>
+#include <txdb.h>
+#include <txmempool.h>
+#include <util.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+static const int MIN_CORES = 2;
+static const int NUM_TXS = 2000;
+
+// Load a mempool.dat through LoadMempool, which checks the scripts of each
+// batch on the script check threads before accepting its transactions. Every
+// other transaction spends an output of the one before it, so half of the
+// inputs are only available from earlier in the file. The signature and script
+// execution caches are emptied before every load, so every signature is
+// verified once per iteration.
+static void MempoolPersist(benchmark::State& state)
+{
+    ECCVerifyHandle verify_handle;
+    SelectParams(CBaseChainParams::REGTEST);
+    const fs::path data_dir = fs::temp_directory_path() / fs::unique_path("bench_mempool_%%%%%%%%");
+    fs::create_directories(data_dir);
+    gArgs.ForceSetArg("-datadir", data_dir.string());
+    ClearDatadirCache();
+
+    // Transactions added to the mempool are announced on the scheduler.
+    CScheduler scheduler;
+    boost::thread_group threads;
+    threads.create_thread(boost::bind(&CScheduler::serviceQueue, &scheduler));
+    GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
+
+    pblocktree.reset(new CBlockTreeDB(1 << 20, true));
+    pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
+    pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+    {
+        CValidationState validation_state;
+        assert(LoadGenesisBlock(Params()));
+        assert(ActivateBestChain(validation_state, Params()));
+    }
+
+    InitSignatureCache();
+    InitScriptExecutionCache();
+    nScriptCheckThreads = std::max(MIN_CORES, GetNumCores());
+    for (int i = 0; i < nScriptCheckThreads - 1; ++i) {
+        threads.create_thread(&ThreadScriptCheck);
+    }
+
+    CBasicKeyStore keystore;
+    CKey key;
+    key.MakeNewKey(true);
+    keystore.AddKey(key);
+    const CScript script_pub_key = GetScriptForDestination(key.GetPubKey().GetID());
+
+    CTransactionRef prev;
+    for (int i = 0; i < NUM_TXS; ++i) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        if (i % 2 == 0) {
+            tx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+            LOCK(cs_main);
+            pcoinsTip->AddCoin(tx.vin[0].prevout, Coin(CTxOut(COIN, script_pub_key), 0, false), false);
+        } else {
+            tx.vin[0].prevout = COutPoint(prev->GetHash(), 0);
+        }
+        tx.vout.resize(1);
+        tx.vout[0].nValue = COIN - (i % 2 + 1) * 1000;
+        tx.vout[0].scriptPubKey = script_pub_key;
+        SignSignature(keystore, script_pub_key, tx, 0, COIN - (i % 2) * 1000, SIGHASH_ALL);
+        prev = MakeTransactionRef(std::move(tx));
+
+        LOCK(cs_main);
+        CValidationState validation_state;
+        assert(AcceptToMemoryPool(mempool, validation_state, prev, nullptr /* pfMissingInputs */,
+                                  nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */));
+    }
+    assert(DumpMempool());
+
+    while (state.KeepRunning()) {
+        mempool.clear();
+        InitSignatureCache();
+        InitScriptExecutionCache();
+        assert(LoadMempool());
+        assert(mempool.size() == (size_t)NUM_TXS);
+    }
+
+    threads.interrupt_all();
+    threads.join_all();
+    GetMainSignals().FlushBackgroundCallbacks();
+    GetMainSignals().UnregisterBackgroundSignalScheduler();
+    nScriptCheckThreads = 0;
+    mempool.clear();
+    UnloadBlockIndex();
+    pcoinsTip.reset();
+    pcoinsdbview.reset();
+    pblocktree.reset();
+    fs::remove_all(data_dir);
+}
+
+BENCHMARK(MempoolPersist, 2);
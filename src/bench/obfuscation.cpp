@@ -0,0 +1,31 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <clientversion.h>
+#include <random.h>
+#include <streams.h>
+
+#include <vector>
+
+// De-obfuscate a database value the way CDBWrapper::Read does, with a
+// random 8-byte key as CDBWrapper creates for a new database.
+static void Xor(benchmark::State& state, size_t value_size)
+{
+    FastRandomContext rng(true);
+    std::vector<unsigned char> key = rng.randbytes(8);
+    std::vector<unsigned char> value = rng.randbytes(value_size);
+    CDataStream ssValue(value, SER_DISK, CLIENT_VERSION);
+    while (state.KeepRunning()) {
+        ssValue.Xor(key);
+    }
+}
+
+// A typical P2PKH coin in the chainstate
+static void XorCoinValue(benchmark::State& state) { Xor(state, 39); }
+// A multi-kilobyte value, where the word loop dominates
+static void XorLargeValue(benchmark::State& state) { Xor(state, 4096); }
+
+BENCHMARK(XorCoinValue, 20 * 1000 * 1000);
+BENCHMARK(XorLargeValue, 300 * 1000);
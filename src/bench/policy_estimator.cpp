@@ -0,0 +1,69 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <policy/fees.h>
+#include <txmempool.h>
+
+#include <vector>
+
+static const int TXS_PER_BLOCK = 500;
+
+static CTxMemPoolEntry MakeEntry(unsigned int nHeight, uint32_t n, CAmount nFee)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << nHeight;
+    tx.vin[0].prevout.n = n;
+    tx.vout.resize(1);
+    tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+    tx.vout[0].nValue = 10 * COIN;
+    LockPoints lp;
+    return CTxMemPoolEntry(MakeTransactionRef(tx), nFee, 0 /* nTime */, nHeight,
+                           false /* spendsCoinbase */, 4 /* sigOpCost */, lp);
+}
+
+// Feed the estimator one block per iteration: the transactions seen at the
+// previous height are confirmed, spread over a range of feerates.
+static void AddBlock(CBlockPolicyEstimator& estimator, unsigned int nHeight)
+{
+    std::vector<CTxMemPoolEntry> entries;
+    entries.reserve(TXS_PER_BLOCK);
+    for (int i = 0; i < TXS_PER_BLOCK; i++) {
+        entries.push_back(MakeEntry(nHeight - 1, i, 1000 + 100 * (i % 200)));
+        estimator.processTransaction(entries.back(), true);
+    }
+    std::vector<const CTxMemPoolEntry*> block;
+    for (const CTxMemPoolEntry& entry : entries) {
+        block.push_back(&entry);
+    }
+    estimator.processBlock(nHeight, block);
+}
+
+static void PolicyEstimatorProcessBlock(benchmark::State& state)
+{
+    CBlockPolicyEstimator estimator;
+    unsigned int nHeight = 1;
+    while (state.KeepRunning()) {
+        AddBlock(estimator, nHeight++);
+    }
+}
+
+static void PolicyEstimatorEstimateSmartFee(benchmark::State& state)
+{
+    CBlockPolicyEstimator estimator;
+    unsigned int nHeight = 1;
+    for (; nHeight <= 200; nHeight++) {
+        AddBlock(estimator, nHeight);
+    }
+    while (state.KeepRunning()) {
+        for (int target = 1; target <= 48; target++) {
+            estimator.estimateSmartFee(target, nullptr, false);
+            estimator.estimateSmartFee(target, nullptr, true);
+        }
+    }
+}
+
+BENCHMARK(PolicyEstimatorProcessBlock, 10);
+BENCHMARK(PolicyEstimatorEstimateSmartFee, 1000);
@@ -0,0 +1,64 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <random.h>
+#include <script/sigcache.h>
+#include <uint256.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+static const int SIG_CACHE_BENCH_THREADS = 8;
+static const size_t SIG_CACHE_BENCH_ENTRIES = 20000;
+
+// Insert entries into a signature cache from several threads at once, then
+// look them up and erase them again, as script verification threads do while
+// validating a block.
+template <unsigned int NUM_SHARDS>
+static void SignatureCacheContention(benchmark::State& state)
+{
+    std::unique_ptr<ShardedSignatureCache<NUM_SHARDS>> cache(new ShardedSignatureCache<NUM_SHARDS>());
+    cache->setup_bytes(DEFAULT_MAX_SIG_CACHE_SIZE << 20);
+
+    FastRandomContext rng(true);
+    std::vector<std::vector<uint256>> entries(SIG_CACHE_BENCH_THREADS);
+    for (std::vector<uint256>& thread_entries : entries) {
+        thread_entries.reserve(SIG_CACHE_BENCH_ENTRIES);
+        for (size_t i = 0; i < SIG_CACHE_BENCH_ENTRIES; ++i) {
+            thread_entries.push_back(rng.rand256());
+        }
+    }
+
+    while (state.KeepRunning()) {
+        std::vector<std::thread> threads;
+        for (const std::vector<uint256>& thread_entries : entries) {
+            threads.emplace_back([&cache, &thread_entries] {
+                for (const uint256& entry : thread_entries) {
+                    cache->insert(entry);
+                }
+                for (const uint256& entry : thread_entries) {
+                    cache->contains(entry, true);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+}
+
+static void SignatureCacheSharded(benchmark::State& state)
+{
+    SignatureCacheContention<SIGNATURE_CACHE_SHARDS>(state);
+}
+
+static void SignatureCacheSingleLock(benchmark::State& state)
+{
+    SignatureCacheContention<1>(state);
+}
+
+BENCHMARK(SignatureCacheSharded, 10);
+BENCHMARK(SignatureCacheSingleLock, 10);
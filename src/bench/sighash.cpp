@@ -0,0 +1,66 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <bench/bench.h>
+#include <pubkey.h>
+#include <primitives/transaction.h>
+#include <script/interpreter.h>
+#include <script/script.h>
+#include <script/standard.h>
+#include <uint256.h>
+
+#include <vector>
+
+static const int NUM_LEGACY_INPUTS = 5000;
+
+// A consolidation transaction spending 5000 pay-to-pubkey-hash outputs.
+static CMutableTransaction BuildConsolidationTransaction()
+{
+    CMutableTransaction tx;
+    tx.vin.resize(NUM_LEGACY_INPUTS);
+    for (int i = 0; i < NUM_LEGACY_INPUTS; ++i) {
+        tx.vin[i].prevout = COutPoint(ArithToUint256(i + 1), i % 4);
+        // Sized like a signature and a compressed public key.
+        tx.vin[i].scriptSig = CScript() << std::vector<unsigned char>(72, 0x30) << std::vector<unsigned char>(33, 0x02);
+    }
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 1;
+    tx.vout[0].scriptPubKey = GetScriptForDestination(CKeyID(uint160()));
+    return tx;
+}
+
+// Compute the legacy SIGHASH_ALL signature hash of every input of the
+// transaction, as validating it does.
+static void LegacySignatureHashes(benchmark::State& state, bool precompute)
+{
+    const CTransaction tx(BuildConsolidationTransaction());
+    const CScript script_code = GetScriptForDestination(CKeyID(uint160()));
+
+    while (state.KeepRunning()) {
+        if (precompute) {
+            const PrecomputedTransactionData txdata(tx);
+            for (unsigned int i = 0; i < tx.vin.size(); ++i) {
+                SignatureHash(script_code, tx, i, SIGHASH_ALL, 0, SIGVERSION_BASE, &txdata);
+            }
+        } else {
+            for (unsigned int i = 0; i < tx.vin.size(); ++i) {
+                SignatureHash(script_code, tx, i, SIGHASH_ALL, 0, SIGVERSION_BASE);
+            }
+        }
+    }
+}
+
+static void LegacySignatureHash5000(benchmark::State& state)
+{
+    LegacySignatureHashes(state, true);
+}
+
+static void LegacySignatureHash5000Uncached(benchmark::State& state)
+{
+    LegacySignatureHashes(state, false);
+}
+
+BENCHMARK(LegacySignatureHash5000, 1);
+BENCHMARK(LegacySignatureHash5000Uncached, 1);
@@ -9,6 +9,7 @@
 #endif
 #include <script/script.h>
 #include <script/sign.h>
+#include <script/standard.h>
 #include <streams.h>
 
 #include <array>
@@ -105,4 +106,168 @@ static void VerifyScriptBench(benchmark::State& state)
     }
 }
 
+static CKey BenchKey(unsigned char n)
+{
+    std::array<unsigned char, 32> vchKey = {};
+    vchKey[31] = n;
+    CKey key;
+    key.Set(vchKey.begin(), vchKey.end(), true);
+    return key;
+}
+
+static std::vector<unsigned char> BenchSign(const CKey& key, const uint256& hash)
+{
+    std::vector<unsigned char> vchSig;
+    key.Sign(hash, vchSig);
+    vchSig.push_back(static_cast<unsigned char>(SIGHASH_ALL));
+    return vchSig;
+}
+
+static void RunVerifyScript(benchmark::State& state, const CTransaction& txCredit, const CMutableTransaction& txSpend)
+{
+    const int flags = SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_P2SH;
+    while (state.KeepRunning()) {
+        ScriptError err;
+        bool success = VerifyScript(
+            txSpend.vin[0].scriptSig,
+            txCredit.vout[0].scriptPubKey,
+            &txSpend.vin[0].scriptWitness,
+            flags,
+            MutableTransactionSignatureChecker(&txSpend, 0, txCredit.vout[0].nValue),
+            &err);
+        assert(err == SCRIPT_ERR_OK);
+        assert(success);
+    }
+}
+
+// Verification of a pay-to-pubkey-hash spend.
+static void VerifyScriptP2PKH(benchmark::State& state)
+{
+    const CKey key = BenchKey(1);
+    const CPubKey pubkey = key.GetPubKey();
+
+    CScript scriptPubKey = GetScriptForDestination(pubkey.GetID());
+    CTransaction txCredit = BuildCreditingTransaction(scriptPubKey);
+    CMutableTransaction txSpend = BuildSpendingTransaction(CScript(), txCredit);
+    const uint256 hash = SignatureHash(scriptPubKey, txSpend, 0, SIGHASH_ALL, txCredit.vout[0].nValue, SIGVERSION_BASE);
+    txSpend.vin[0].scriptSig = CScript() << BenchSign(key, hash) << ToByteVector(pubkey);
+
+    RunVerifyScript(state, txCredit, txSpend);
+}
+
+static CScript BenchMultisigScript(const std::vector<CKey>& keys)
+{
+    std::vector<CPubKey> pubkeys;
+    for (const CKey& key : keys) {
+        pubkeys.push_back(key.GetPubKey());
+    }
+    return GetScriptForMultisig(2, pubkeys);
+}
+
+// Verification of a 2-of-3 multisig spend wrapped in pay-to-script-hash.
+static void VerifyScriptP2SHMultisig(benchmark::State& state)
+{
+    const std::vector<CKey> keys = {BenchKey(1), BenchKey(2), BenchKey(3)};
+    const CScript redeemScript = BenchMultisigScript(keys);
+
+    CScript scriptPubKey = GetScriptForDestination(CScriptID(redeemScript));
+    CTransaction txCredit = BuildCreditingTransaction(scriptPubKey);
+    CMutableTransaction txSpend = BuildSpendingTransaction(CScript(), txCredit);
+    const uint256 hash = SignatureHash(redeemScript, txSpend, 0, SIGHASH_ALL, txCredit.vout[0].nValue, SIGVERSION_BASE);
+    txSpend.vin[0].scriptSig = CScript() << OP_0 << BenchSign(keys[0], hash) << BenchSign(keys[1], hash)
+                                         << std::vector<unsigned char>(redeemScript.begin(), redeemScript.end());
+
+    RunVerifyScript(state, txCredit, txSpend);
+}
+
+// Verification of a 2-of-3 multisig spend as a pay-to-witness-script-hash.
+static void VerifyScriptP2WSHMultisig(benchmark::State& state)
+{
+    const std::vector<CKey> keys = {BenchKey(1), BenchKey(2), BenchKey(3)};
+    const CScript witnessScript = BenchMultisigScript(keys);
+
+    CScript scriptPubKey = GetScriptForWitness(witnessScript);
+    CTransaction txCredit = BuildCreditingTransaction(scriptPubKey);
+    CMutableTransaction txSpend = BuildSpendingTransaction(CScript(), txCredit);
+    const uint256 hash = SignatureHash(witnessScript, txSpend, 0, SIGHASH_ALL, txCredit.vout[0].nValue, SIGVERSION_WITNESS_V0);
+    CScriptWitness& witness = txSpend.vin[0].scriptWitness;
+    witness.stack.emplace_back();
+    witness.stack.push_back(BenchSign(keys[0], hash));
+    witness.stack.push_back(BenchSign(keys[1], hash));
+    witness.stack.emplace_back(witnessScript.begin(), witnessScript.end());
+
+    RunVerifyScript(state, txCredit, txSpend);
+}
+
+#if defined(HAVE_CONSENSUS_LIB)
+static const unsigned int NUM_BATCH_INPUTS = 100;
+
+// Verify all inputs of a serialized transaction spending 100 P2WPKH outputs
+// through libbitcoinconsensus, either one call per input or with a single
+// batch call on the given number of threads.
+static void VerifyTransactionConsensusLib(benchmark::State& state, bool batch, unsigned int threads)
+{
+    const int flags = bitcoinconsensus_SCRIPT_FLAGS_VERIFY_ALL;
+    const CKey key = BenchKey(1);
+    const CPubKey pubkey = key.GetPubKey();
+    const CScript scriptCode = GetScriptForDestination(pubkey.GetID());
+    const CScript scriptPubKey = GetScriptForWitness(scriptCode);
+    const CAmount amount = 1;
+
+    CMutableTransaction txSpend;
+    for (unsigned int i = 0; i < NUM_BATCH_INPUTS; ++i) {
+        txSpend.vin.emplace_back(COutPoint(BuildCreditingTransaction(CScript() << i).GetHash(), 0));
+    }
+    txSpend.vout.emplace_back(NUM_BATCH_INPUTS * amount, scriptCode);
+    const PrecomputedTransactionData txdata(txSpend);
+    for (unsigned int i = 0; i < NUM_BATCH_INPUTS; ++i) {
+        const uint256 hash = SignatureHash(scriptCode, txSpend, i, SIGHASH_ALL, amount, SIGVERSION_WITNESS_V0, &txdata);
+        txSpend.vin[i].scriptWitness.stack = {BenchSign(key, hash), ToByteVector(pubkey)};
+    }
+
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << txSpend;
+    const std::vector<bitcoinconsensus_spent_output> spentOutputs(NUM_BATCH_INPUTS, {scriptPubKey.data(), static_cast<unsigned int>(scriptPubKey.size()), amount});
+
+    while (state.KeepRunning()) {
+        if (batch) {
+            int csuccess = bitcoinconsensus_verify_transaction(
+                (const unsigned char*)stream.data(), stream.size(),
+                spentOutputs.data(), spentOutputs.size(), flags, threads, nullptr, nullptr);
+            assert(csuccess == 1);
+        } else {
+            for (unsigned int i = 0; i < NUM_BATCH_INPUTS; ++i) {
+                int csuccess = bitcoinconsensus_verify_script_with_amount(
+                    scriptPubKey.data(), scriptPubKey.size(), amount,
+                    (const unsigned char*)stream.data(), stream.size(), i, flags, nullptr);
+                assert(csuccess == 1);
+            }
+        }
+    }
+}
+
+static void VerifyTransactionPerInput(benchmark::State& state)
+{
+    VerifyTransactionConsensusLib(state, false, 1);
+}
+
+static void VerifyTransactionBatch(benchmark::State& state)
+{
+    VerifyTransactionConsensusLib(state, true, 1);
+}
+
+static void VerifyTransactionBatch4Threads(benchmark::State& state)
+{
+    VerifyTransactionConsensusLib(state, true, 4);
+}
+#endif
+
 BENCHMARK(VerifyScriptBench, 6300);
+BENCHMARK(VerifyScriptP2PKH, 6300);
+BENCHMARK(VerifyScriptP2SHMultisig, 3000);
+BENCHMARK(VerifyScriptP2WSHMultisig, 3000);
+#if defined(HAVE_CONSENSUS_LIB)
+BENCHMARK(VerifyTransactionPerInput, 50);
+BENCHMARK(VerifyTransactionBatch, 50);
+BENCHMARK(VerifyTransactionBatch4Threads, 50);
+#endif
@@ -0,0 +1,169 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crypto/muhash.h>
+
+#include <crypto/chacha20.h>
+#include <crypto/common.h>
+#include <crypto/sha256.h>
+
+#include <string.h>
+
+namespace {
+
+/** 2^3072 - MAX_PRIME_DIFF is the largest 3072-bit safe prime */
+const uint32_t MAX_PRIME_DIFF = 1103717;
+
+/** Whether a fully carried number is at least the prime */
+bool IsOverflow(const Num3072& a)
+{
+    if (a.limbs[0] <= (uint32_t)(0 - MAX_PRIME_DIFF) - 1) return false;
+    for (int i = 1; i < Num3072::LIMBS; ++i) {
+        if (a.limbs[i] != 0xFFFFFFFF) return false;
+    }
+    return true;
+}
+
+/** Subtract the prime, by adding 2^3072 - prime and dropping the carry out of the top limb */
+void FullReduce(Num3072& a)
+{
+    uint64_t c = MAX_PRIME_DIFF;
+    for (int i = 0; i < Num3072::LIMBS && c; ++i) {
+        c += a.limbs[i];
+        a.limbs[i] = (uint32_t)c;
+        c >>= 32;
+    }
+}
+
+} // namespace
+
+Num3072::Num3072(const unsigned char (&data)[BYTE_SIZE])
+{
+    for (int i = 0; i < LIMBS; ++i) {
+        limbs[i] = ReadLE32(data + 4 * i);
+    }
+}
+
+void Num3072::SetToOne()
+{
+    limbs[0] = 1;
+    memset(limbs + 1, 0, (LIMBS - 1) * sizeof(limbs[0]));
+}
+
+void Num3072::Reduce(const uint32_t (&product)[2 * LIMBS])
+{
+    // 2^3072 is congruent to MAX_PRIME_DIFF, so fold the upper half onto the
+    // lower half multiplied by it. What carries out of the top limb is folded
+    // in the same way until nothing is left.
+    uint64_t carry = 0;
+    for (int i = 0; i < LIMBS; ++i) {
+        uint64_t t = (uint64_t)product[LIMBS + i] * MAX_PRIME_DIFF + product[i] + carry;
+        limbs[i] = (uint32_t)t;
+        carry = t >> 32;
+    }
+    while (carry) {
+        uint64_t c = carry * MAX_PRIME_DIFF;
+        for (int i = 0; i < LIMBS && c; ++i) {
+            c += limbs[i];
+            limbs[i] = (uint32_t)c;
+            c >>= 32;
+        }
+        carry = c;
+    }
+    if (IsOverflow(*this)) FullReduce(*this);
+}
+
+void Num3072::Multiply(const Num3072& a)
+{
+    uint32_t product[2 * LIMBS] = {0};
+    for (int i = 0; i < LIMBS; ++i) {
+        uint64_t carry = 0;
+        for (int j = 0; j < LIMBS; ++j) {
+            uint64_t t = (uint64_t)limbs[i] * a.limbs[j] + product[i + j] + carry;
+            product[i + j] = (uint32_t)t;
+            carry = t >> 32;
+        }
+        product[i + LIMBS] = (uint32_t)carry;
+    }
+    Reduce(product);
+}
+
+Num3072 Num3072::GetInverse() const
+{
+    // By Fermat's little theorem the inverse is this^(p - 2). All limbs of
+    // p - 2 are ones except the lowest, so use a fixed 4-bit window.
+    Num3072 table[16];
+    for (int i = 1; i < 16; ++i) {
+        table[i] = table[i - 1];
+        table[i].Multiply(*this);
+    }
+    Num3072 out;
+    for (int i = LIMBS - 1; i >= 0; --i) {
+        const uint32_t exponent = i == 0 ? (uint32_t)(0 - MAX_PRIME_DIFF - 2) : 0xFFFFFFFF;
+        for (int shift = 28; shift >= 0; shift -= 4) {
+            for (int k = 0; k < 4; ++k) {
+                out.Multiply(out);
+            }
+            const int window = (exponent >> shift) & 15;
+            if (window) out.Multiply(table[window]);
+        }
+    }
+    return out;
+}
+
+void Num3072::Divide(const Num3072& a)
+{
+    Multiply(a.GetInverse());
+}
+
+void Num3072::ToBytes(unsigned char (&out)[BYTE_SIZE]) const
+{
+    for (int i = 0; i < LIMBS; ++i) {
+        WriteLE32(out + 4 * i, limbs[i]);
+    }
+}
+
+Num3072 MuHash3072::ToNum3072(const unsigned char* data, size_t len)
+{
+    unsigned char hash[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(data, len).Finalize(hash);
+    unsigned char expanded[Num3072::BYTE_SIZE];
+    ChaCha20(hash, sizeof(hash)).Output(expanded, sizeof(expanded));
+    return Num3072(expanded);
+}
+
+MuHash3072& MuHash3072::Insert(const unsigned char* data, size_t len)
+{
+    numerator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::Remove(const unsigned char* data, size_t len)
+{
+    denominator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator*=(const MuHash3072& mul)
+{
+    numerator.Multiply(mul.numerator);
+    denominator.Multiply(mul.denominator);
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator/=(const MuHash3072& div)
+{
+    numerator.Multiply(div.denominator);
+    denominator.Multiply(div.numerator);
+    return *this;
+}
+
+void MuHash3072::Finalize(unsigned char* out) const
+{
+    Num3072 value = numerator;
+    value.Divide(denominator);
+    unsigned char data[Num3072::BYTE_SIZE];
+    value.ToBytes(data);
+    CSHA256().Write(data, sizeof(data)).Finalize(out);
+}
@@ -0,0 +1,88 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_MUHASH_H
+#define BITCOIN_CRYPTO_MUHASH_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/** A number modulo the prime 2^3072 - 1103717, in little-endian 32-bit limbs */
+class Num3072
+{
+public:
+    static const size_t BYTE_SIZE = 384;
+    static const int LIMBS = 96;
+
+    uint32_t limbs[LIMBS];
+
+    Num3072() { SetToOne(); }
+    explicit Num3072(const unsigned char (&data)[BYTE_SIZE]);
+
+    void SetToOne();
+    /** Multiply by a, modulo the prime */
+    void Multiply(const Num3072& a);
+    /** Multiply by the inverse of a, modulo the prime */
+    void Divide(const Num3072& a);
+    Num3072 GetInverse() const;
+    void ToBytes(unsigned char (&out)[BYTE_SIZE]) const;
+
+private:
+    /** Reduce a double width product into this number */
+    void Reduce(const uint32_t (&product)[2 * LIMBS]);
+};
+
+/**
+ * A hash of a multiset of byte strings that can be updated in any order:
+ * inserting and removing the same elements always gives the same result.
+ *
+ * Every element is expanded with SHA256 and ChaCha20 into a number modulo a
+ * 3072-bit prime, and the set hash is the product of those numbers. Removed
+ * elements are collected in a separate denominator, so that the expensive
+ * modular inversion only happens in Finalize().
+ */
+class MuHash3072
+{
+private:
+    Num3072 numerator;
+    Num3072 denominator;
+
+    static Num3072 ToNum3072(const unsigned char* data, size_t len);
+
+public:
+    /** The hash of the empty set */
+    MuHash3072() {}
+
+    MuHash3072& Insert(const unsigned char* data, size_t len);
+    MuHash3072& Remove(const unsigned char* data, size_t len);
+
+    /** Add or remove all elements of another set */
+    MuHash3072& operator*=(const MuHash3072& mul);
+    MuHash3072& operator/=(const MuHash3072& div);
+
+    /** Write the 32-byte hash of the set to out */
+    void Finalize(unsigned char* out) const;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        unsigned char data[Num3072::BYTE_SIZE];
+        numerator.ToBytes(data);
+        s.write((const char*)data, sizeof(data));
+        denominator.ToBytes(data);
+        s.write((const char*)data, sizeof(data));
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        unsigned char data[Num3072::BYTE_SIZE];
+        s.read((char*)data, sizeof(data));
+        numerator = Num3072(data);
+        s.read((char*)data, sizeof(data));
+        denominator = Num3072(data);
+    }
+};
+
+#endif // BITCOIN_CRYPTO_MUHASH_H
@@ -475,6 +475,19 @@ public:
             }
         return false;
     }
+
+    /** for_each calls f on every element in the table that has not been
+     * marked discardable. Same requirements as contains(*, false).
+     *
+     * @param f the function to call with each element
+     */
+    template <typename F>
+    void for_each(F f) const
+    {
+        for (uint32_t i = 0; i < table.size(); ++i)
+            if (!collection_flags.bit_is_set(i))
+                f(table[i]);
+    }
 };
 } // namespace CuckooCache
 
@@ -76,9 +76,16 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     leveldb::Options options;
     options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
     options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
+    // Bloom filters let a lookup of a missing key (such as a coin that was
+    // created and spent while still in the cache) skip reading table blocks.
+    // Filters in existing tables remain usable if the number of bits changes.
+    int bloom_bits = gArgs.GetArg("-dbbloombits", DEFAULT_DB_BLOOM_BITS);
+    options.filter_policy = bloom_bits > 0 ? leveldb::NewBloomFilterPolicy(bloom_bits) : nullptr;
     options.compression = leveldb::kNoCompression;
-    options.max_open_files = 64;
+    // LevelDB clamps these to its supported ranges.
+    options.max_open_files = gArgs.GetArg("-dbmaxopenfiles", DEFAULT_DB_MAX_OPEN_FILES);
+    options.block_size = gArgs.GetArg("-dbblocksize", DEFAULT_DB_BLOCK_SIZE);
+    options.max_file_size = gArgs.GetArg("-dbmaxfilesize", DEFAULT_DB_MAX_FILE_SIZE);
     options.info_log = new CBitcoinLevelDBLogger();
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
@@ -123,7 +130,12 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     // The base-case obfuscation key, which is a noop.
     obfuscate_key = std::vector<unsigned char>(OBFUSCATE_KEY_NUM_BYTES, '\000');
 
-    bool key_exists = Read(OBFUSCATE_KEY_KEY, obfuscate_key);
+    // Reads undo the obfuscation as they go, so the key must not be read into itself.
+    std::vector<unsigned char> stored_key;
+    bool key_exists = Read(OBFUSCATE_KEY_KEY, stored_key);
+    if (key_exists) {
+        obfuscate_key = stored_key;
+    }
 
     if (!key_exists && obfuscate && IsEmpty()) {
         // Initialize non-degenerate obfuscation if it won't upset
@@ -161,8 +173,19 @@ bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
     if (log_memory) {
         mem_before = DynamicMemoryUsage() / 1024 / 1024;
     }
+    const int64_t write_start = GetTimeMicros();
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
     dbwrapper_private::HandleError(status);
+    const int64_t write_end = GetTimeMicros();
+    {
+        LOCK(cs_stats);
+        stats.writes++;
+        stats.written_bytes += batch.SizeEstimate();
+        stats.written_since_compaction += batch.SizeEstimate();
+        stats.write_time += write_end - write_start;
+        stats.max_write_time = std::max(stats.max_write_time, write_end - write_start);
+        m_last_write_time = write_end;
+    }
     if (log_memory) {
         double mem_after = DynamicMemoryUsage() / 1024 / 1024;
         LogPrint(BCLog::LEVELDB, "WriteBatch memory usage: db=%s, before=%.1fMiB, after=%.1fMiB\n",
@@ -180,6 +203,83 @@ size_t CDBWrapper::DynamicMemoryUsage() const {
     return stoul(memory);
 }
 
+bool CDBWrapper::GetProperty(const std::string& name, std::string& value) const
+{
+    return pdb->GetProperty(name, &value);
+}
+
+CDBWrapper::Stats CDBWrapper::GetStats() const
+{
+    LOCK(cs_stats);
+    return stats;
+}
+
+int CDBWrapper::GetLevel0Files() const
+{
+    std::string value;
+    if (!pdb->GetProperty("leveldb.num-files-at-level0", &value)) return 0;
+    return atoi(value);
+}
+
+bool CDBWrapper::CompactIfIdle(int64_t idle_time, const std::function<bool()>& interrupted, int min_level0_files)
+{
+    int64_t last_write_time;
+    {
+        LOCK(cs_stats);
+        last_write_time = m_last_write_time;
+    }
+    if (GetTimeMicros() - last_write_time < idle_time) return false;
+    int level0_files = GetLevel0Files();
+    if (level0_files < min_level0_files) return false;
+
+    LogPrint(BCLog::LEVELDB, "Starting background compaction of %s with %d level 0 files\n", m_name, level0_files);
+    const int64_t start = GetTimeMicros();
+    // Compacting a key range merges all level 0 files that overlap it into
+    // level 1, along with the level 1 files they overlap. It also compacts
+    // the range itself at the deeper levels. Compacting a whole prefix of the
+    // chainstate would rewrite gigabytes, and LevelDB holds back its own
+    // level 0 compactions while a manual one runs. So only ranges of one two
+    // byte prefix are compacted, starting where the previous compaction
+    // stopped. The level 0 files left by a flush span most keys, so a range
+    // or two is usually enough to drain them.
+    int compacted = 0;
+    bool stopped = false;
+    for (int i = 0; i < 0x10000 && compacted < DB_COMPACT_MAX_RANGES && level0_files >= min_level0_files; ++i) {
+        const int pos = m_compact_cursor;
+        m_compact_cursor = (m_compact_cursor + 1) & 0xffff;
+        // The first range also covers keys shorter than two bytes, and each
+        // range ends where the next one starts.
+        const std::string range_begin = pos == 0 ? std::string() : std::string{(char)(pos >> 8), (char)(pos & 0xff)};
+        const std::string range_end = pos < 0xffff ? std::string{(char)((pos + 1) >> 8), (char)((pos + 1) & 0xff)} : std::string(DBWRAPPER_PREALLOC_KEY_SIZE, '\xff');
+        const leveldb::Slice slBegin(range_begin), slEnd(range_end);
+        leveldb::Range range(slBegin, slEnd);
+        uint64_t size = 0;
+        pdb->GetApproximateSizes(&range, 1, &size);
+        if (size == 0) continue;
+        pdb->CompactRange(&slBegin, &slEnd);
+        ++compacted;
+        level0_files = GetLevel0Files();
+        bool written;
+        {
+            LOCK(cs_stats);
+            written = m_last_write_time != last_write_time;
+        }
+        if (written || interrupted()) {
+            stopped = true;
+            break;
+        }
+    }
+    const int64_t end = GetTimeMicros();
+    LogPrint(BCLog::LEVELDB, "%s background compaction of %s after %d ranges in %.2fs, %d level 0 files left\n",
+        stopped ? "Stopped" : "Finished", m_name, compacted, (end - start) * 0.000001, level0_files);
+    LOCK(cs_stats);
+    stats.written_since_compaction = 0;
+    stats.compactions++;
+    stats.compaction_time += end - start;
+    stats.last_compaction = end / 1000000;
+    return level0_files < min_level0_files;
+}
+
 // Prefixed with null character to avoid collisions with other keys
 //
 // We must use a string constructor which specifies length so that we copy
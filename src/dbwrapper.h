@@ -9,6 +9,7 @@
 #include <fs.h>
 #include <serialize.h>
 #include <streams.h>
+#include <sync.h>
 #include <util.h>
 #include <utilstrencodings.h>
 #include <version.h>
@@ -16,9 +17,27 @@
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
+#include <functional>
+#include <memory>
+
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
 
+//! -dbbloombits default: bits per key of the bloom filter in each table (0 disables it)
+static const int DEFAULT_DB_BLOOM_BITS = 10;
+//! -dbmaxopenfiles default: table files kept open by each database
+static const int DEFAULT_DB_MAX_OPEN_FILES = 64;
+//! -dbblocksize default (bytes): uncompressed size of a table block
+static const int64_t DEFAULT_DB_BLOCK_SIZE = 4 << 10;
+//! -dbmaxfilesize default (bytes): size at which a new table file is started
+static const int64_t DEFAULT_DB_MAX_FILE_SIZE = 2 << 20;
+//! -dbcompactidle default (seconds): idle time after a flush before a database is compacted in the background
+static const int64_t DEFAULT_DB_COMPACT_IDLE = 60;
+//! Level 0 table files a database must have before a background compaction runs
+static const int DB_COMPACT_MIN_LEVEL0_FILES = 2;
+//! Key ranges a background compaction compacts at most while the database stays idle
+static const int DB_COMPACT_MAX_RANGES = 16;
+
 class dbwrapper_error : public std::runtime_error
 {
 public:
@@ -147,7 +166,7 @@ public:
     template<typename K> bool GetKey(K& key) {
         leveldb::Slice slKey = piter->key();
         try {
-            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            SpanReader ssKey(SER_DISK, CLIENT_VERSION, reinterpret_cast<const unsigned char*>(slKey.data()), slKey.size());
             ssKey >> key;
         } catch (const std::exception&) {
             return false;
@@ -158,7 +177,8 @@ public:
     template<typename V> bool GetValue(V& value) {
         leveldb::Slice slValue = piter->value();
         try {
-            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            // Read straight out of the iterator's buffer, undoing the obfuscation on the way
+            SpanReader ssValue(SER_DISK, CLIENT_VERSION, reinterpret_cast<const unsigned char*>(slValue.data()), slValue.size());
             ssValue.Xor(dbwrapper_private::GetObfuscateKey(parent));
             ssValue >> value;
         } catch (const std::exception&) {
@@ -212,6 +232,37 @@ private:
 
     std::vector<unsigned char> CreateObfuscateKey() const;
 
+public:
+    /** A consistent view of the database as of GetSnapshot(), released when the last copy goes away */
+    typedef std::shared_ptr<const leveldb::Snapshot> Snapshot;
+
+    /** Write and compaction counters, see GetStats() */
+    struct Stats {
+        //! number of batches written
+        uint64_t writes = 0;
+        //! bytes written, as estimated by the batches
+        uint64_t written_bytes = 0;
+        //! total and longest time spent in a single write, which includes any write stall (microseconds)
+        int64_t write_time = 0;
+        int64_t max_write_time = 0;
+        //! bytes written since the last background compaction
+        uint64_t written_since_compaction = 0;
+        //! background compactions run, their total time (microseconds) and the time the last one finished
+        uint64_t compactions = 0;
+        int64_t compaction_time = 0;
+        int64_t last_compaction = 0;
+    };
+
+private:
+    mutable CCriticalSection cs_stats;
+    Stats stats;
+    //! time of the last write (microseconds)
+    int64_t m_last_write_time = 0;
+    //! two byte key prefix the next background compaction starts at
+    int m_compact_cursor = 0;
+
+    int GetLevel0Files() const;
+
 public:
     /**
      * @param[in] path        Location in the filesystem where leveldb data will be stored.
@@ -225,7 +276,7 @@ public:
     ~CDBWrapper();
 
     template <typename K, typename V>
-    bool Read(const K& key, V& value) const
+    bool Read(const K& key, V& value, const Snapshot& snapshot = nullptr) const
     {
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
@@ -233,7 +284,9 @@ public:
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
 
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::ReadOptions options = readoptions;
+        options.snapshot = snapshot.get();
+        leveldb::Status status = pdb->Get(options, slKey, &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -241,7 +294,7 @@ public:
             dbwrapper_private::HandleError(status);
         }
         try {
-            CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+            SpanReader ssValue(SER_DISK, CLIENT_VERSION, reinterpret_cast<const unsigned char*>(strValue.data()), strValue.size());
             ssValue.Xor(obfuscate_key);
             ssValue >> value;
         } catch (const std::exception&) {
@@ -290,6 +343,23 @@ public:
     // Get an estimate of LevelDB memory usage (in bytes).
     size_t DynamicMemoryUsage() const;
 
+    /** Read a LevelDB property such as "leveldb.stats" or "leveldb.sstables". */
+    bool GetProperty(const std::string& name, std::string& value) const;
+
+    Stats GetStats() const;
+
+    /**
+     * Merge the level 0 table files into level 1 if there are at least
+     * min_level0_files of them and nothing has been written for idle_time
+     * microseconds. Small key ranges are compacted one at a time, at most
+     * DB_COMPACT_MAX_RANGES of them, until level 0 is drained. The compaction
+     * stops between ranges once the database is written to again or
+     * interrupted() returns true. Returns whether level 0 was drained. Safe to
+     * call from a thread other than the writer, but not concurrently with
+     * itself.
+     */
+    bool CompactIfIdle(int64_t idle_time, const std::function<bool()>& interrupted, int min_level0_files = DB_COMPACT_MIN_LEVEL0_FILES);
+
     // not available for LevelDB; provide for compatibility with BDB
     bool Flush()
     {
@@ -302,9 +372,21 @@ public:
         return WriteBatch(batch, true);
     }
 
-    CDBIterator *NewIterator()
+    CDBIterator *NewIterator(const Snapshot& snapshot = nullptr)
+    {
+        leveldb::ReadOptions options = iteroptions;
+        options.snapshot = snapshot.get();
+        return new CDBIterator(*this, pdb->NewIterator(options));
+    }
+
+    /**
+     * Take a snapshot of the database. Reads and iterators given the
+     * snapshot all see the same state, whatever is written in the meantime.
+     */
+    Snapshot GetSnapshot() const
     {
-        return new CDBIterator(*this, pdb->NewIterator(iteroptions));
+        leveldb::DB* db = pdb;
+        return Snapshot(pdb->GetSnapshot(), [db](const leveldb::Snapshot* snapshot) { db->ReleaseSnapshot(snapshot); });
     }
 
     /**
@@ -0,0 +1,310 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <coins.h>
+#include <crypto/sha256.h>
+#include <index/addrindex.h>
+#include <undo.h>
+#include <util.h>
+#include <validation.h>
+
+constexpr char DB_ADDR_HISTORY = 'h';
+constexpr char DB_ADDR_UNSPENT = 'u';
+
+std::unique_ptr<AddrIndex> g_addrindex;
+
+namespace {
+
+uint256 GetScriptHash(const CScript& script)
+{
+    uint256 hash;
+    CSHA256().Write(script.data(), script.size()).Finalize(hash.begin());
+    return hash;
+}
+
+/**
+ * Key of a history entry. Heights and positions are stored big endian so
+ * that the entries of a script iterate in block order.
+ */
+struct HistoryKey {
+    uint256 script_hash;
+    uint32_t height;
+    uint32_t tx_pos;
+    bool spend;
+    uint32_t index;
+
+    HistoryKey() : height(0), tx_pos(0), spend(false), index(0) {}
+    HistoryKey(const uint256& script_hash_in, uint32_t height_in, uint32_t tx_pos_in, bool spend_in, uint32_t index_in) :
+        script_hash(script_hash_in), height(height_in), tx_pos(tx_pos_in), spend(spend_in), index(index_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_ADDR_HISTORY);
+        s << script_hash;
+        ser_writedata32be(s, height);
+        ser_writedata32be(s, tx_pos);
+        ser_writedata8(s, spend);
+        ser_writedata32be(s, index);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        if (ser_readdata8(s) != DB_ADDR_HISTORY) {
+            throw std::ios_base::failure("Invalid format for address history key");
+        }
+        s >> script_hash;
+        height = ser_readdata32be(s);
+        tx_pos = ser_readdata32be(s);
+        spend = ser_readdata8(s);
+        index = ser_readdata32be(s);
+    }
+};
+
+/** Value of a history entry. The spent outpoint is only stored for spends. */
+struct HistoryValue {
+    bool spend;
+    uint256 txid;
+    CAmount amount;
+    COutPoint prevout;
+
+    explicit HistoryValue(bool spend_in) : spend(spend_in), amount(0) {}
+    HistoryValue(const uint256& txid_in, CAmount amount_in) :
+        spend(false), txid(txid_in), amount(amount_in) {}
+    HistoryValue(const uint256& txid_in, CAmount amount_in, const COutPoint& prevout_in) :
+        spend(true), txid(txid_in), amount(amount_in), prevout(prevout_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s << txid;
+        uint64_t value = amount;
+        s << VARINT(value);
+        if (spend) s << prevout;
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        s >> txid;
+        uint64_t value = 0;
+        s >> VARINT(value);
+        amount = value;
+        if (spend) s >> prevout;
+    }
+};
+
+struct UnspentKey {
+    uint256 script_hash;
+    COutPoint outpoint;
+
+    UnspentKey() {}
+    UnspentKey(const uint256& script_hash_in, const COutPoint& outpoint_in) :
+        script_hash(script_hash_in), outpoint(outpoint_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_ADDR_UNSPENT);
+        s << script_hash;
+        s << outpoint.hash;
+        ser_writedata32be(s, outpoint.n);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        if (ser_readdata8(s) != DB_ADDR_UNSPENT) {
+            throw std::ios_base::failure("Invalid format for address unspent key");
+        }
+        s >> script_hash;
+        s >> outpoint.hash;
+        outpoint.n = ser_readdata32be(s);
+    }
+};
+
+/** Value of an unspent entry, with height and coinbase flag packed as in Coin */
+struct UnspentValue {
+    int height;
+    bool coinbase;
+    CAmount amount;
+
+    UnspentValue() : height(0), coinbase(false), amount(0) {}
+    explicit UnspentValue(const Coin& coin) :
+        height(coin.nHeight), coinbase(coin.fCoinBase), amount(coin.out.nValue) {}
+    UnspentValue(int height_in, bool coinbase_in, CAmount amount_in) :
+        height(height_in), coinbase(coinbase_in), amount(amount_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        uint32_t code = height * 2 + coinbase;
+        uint64_t value = amount;
+        s << VARINT(code);
+        s << VARINT(value);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        uint32_t code = 0;
+        uint64_t value = 0;
+        s >> VARINT(code);
+        s >> VARINT(value);
+        height = code >> 1;
+        coinbase = code & 1;
+        amount = value;
+    }
+};
+
+} // namespace
+
+/** Access to the address index database (indexes/addrindex/) */
+class AddrIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+};
+
+AddrIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "addrindex", n_cache_size, f_memory, f_wipe)
+{}
+
+AddrIndex::AddrIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<AddrIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+AddrIndex::~AddrIndex() {}
+
+bool AddrIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // The genesis block outputs are not spendable and have no undo data.
+    if (pindex->nHeight == 0) return true;
+
+    CBlockUndo blockundo;
+    if (!UndoReadFromDisk(blockundo, pindex)) {
+        return false;
+    }
+    if (blockundo.vtxundo.size() + 1 != block.vtx.size()) {
+        return error("%s: undo data of block %s does not match the block", __func__, pindex->GetBlockHash().ToString());
+    }
+
+    // Within a block, an output may be spent by a later transaction. The
+    // batch is applied in order, so the erase of its unspent entry wins.
+    CDBBatch batch(*m_db);
+    for (uint32_t i = 0; i < block.vtx.size(); ++i) {
+        const CTransaction& tx = *block.vtx[i];
+        const uint256& txid = tx.GetHash();
+        if (i > 0) {
+            const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+            for (uint32_t j = 0; j < tx.vin.size(); ++j) {
+                const COutPoint& prevout = tx.vin[j].prevout;
+                const Coin& coin = txundo.vprevout[j];
+                const uint256 script_hash = GetScriptHash(coin.out.scriptPubKey);
+                batch.Write(HistoryKey(script_hash, pindex->nHeight, i, true, j), HistoryValue(txid, coin.out.nValue, prevout));
+                batch.Erase(UnspentKey(script_hash, prevout));
+            }
+        }
+        for (uint32_t j = 0; j < tx.vout.size(); ++j) {
+            const CTxOut& out = tx.vout[j];
+            if (out.scriptPubKey.IsUnspendable()) continue;
+            const uint256 script_hash = GetScriptHash(out.scriptPubKey);
+            batch.Write(HistoryKey(script_hash, pindex->nHeight, i, false, j), HistoryValue(txid, out.nValue));
+            batch.Write(UnspentKey(script_hash, COutPoint(txid, j)), UnspentValue(pindex->nHeight, i == 0, out.nValue));
+        }
+    }
+    return m_db->WriteBatch(batch);
+}
+
+bool AddrIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    const Consensus::Params& consensus_params = Params().GetConsensus();
+    for (const CBlockIndex* pindex = current_tip; pindex != new_tip; pindex = pindex->pprev) {
+        CBlock block;
+        CBlockUndo blockundo;
+        if (!ReadBlockFromDisk(block, pindex, consensus_params) || !UndoReadFromDisk(blockundo, pindex)) {
+            return error("%s: failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+        }
+
+        // Undo the transactions in reverse, so that outputs created and spent
+        // within the block end up erased.
+        CDBBatch batch(*m_db);
+        for (uint32_t i = block.vtx.size(); i-- > 0;) {
+            const CTransaction& tx = *block.vtx[i];
+            for (uint32_t j = 0; j < tx.vout.size(); ++j) {
+                const CTxOut& out = tx.vout[j];
+                if (out.scriptPubKey.IsUnspendable()) continue;
+                const uint256 script_hash = GetScriptHash(out.scriptPubKey);
+                batch.Erase(HistoryKey(script_hash, pindex->nHeight, i, false, j));
+                batch.Erase(UnspentKey(script_hash, COutPoint(tx.GetHash(), j)));
+            }
+            if (i > 0) {
+                const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+                for (uint32_t j = 0; j < tx.vin.size(); ++j) {
+                    const Coin& coin = txundo.vprevout[j];
+                    const uint256 script_hash = GetScriptHash(coin.out.scriptPubKey);
+                    batch.Erase(HistoryKey(script_hash, pindex->nHeight, i, true, j));
+                    batch.Write(UnspentKey(script_hash, tx.vin[j].prevout), UnspentValue(coin));
+                }
+            }
+        }
+        if (!m_db->WriteBatch(batch)) {
+            return error("%s: failed to rewind block %s", __func__, pindex->GetBlockHash().ToString());
+        }
+    }
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& AddrIndex::GetDB() const { return *m_db; }
+
+bool AddrIndex::FindHistory(const CScript& script, int start_height, size_t skip, size_t count,
+                            std::vector<AddressHistoryEntry>& entries) const
+{
+    const uint256 script_hash = GetScriptHash(script);
+    std::unique_ptr<CDBIterator> cursor(m_db->NewIterator());
+    for (cursor->Seek(HistoryKey(script_hash, std::max(start_height, 0), 0, false, 0));
+         cursor->Valid() && entries.size() < count; cursor->Next()) {
+        HistoryKey key;
+        if (!cursor->GetKey(key) || key.script_hash != script_hash) break;
+        if (skip > 0) {
+            --skip;
+            continue;
+        }
+
+        HistoryValue value(key.spend);
+        if (!cursor->GetValue(value)) {
+            return error("%s: cannot parse address history record", __func__);
+        }
+        entries.push_back({(int)key.height, value.txid, key.spend, key.index, value.amount, value.prevout});
+    }
+    return true;
+}
+
+bool AddrIndex::FindUnspent(const CScript& script, size_t skip, size_t count,
+                            std::vector<AddressUnspent>& unspent) const
+{
+    const uint256 script_hash = GetScriptHash(script);
+    std::unique_ptr<CDBIterator> cursor(m_db->NewIterator());
+    for (cursor->Seek(UnspentKey(script_hash, COutPoint(uint256(), 0)));
+         cursor->Valid() && unspent.size() < count; cursor->Next()) {
+        UnspentKey key;
+        if (!cursor->GetKey(key) || key.script_hash != script_hash) break;
+        if (skip > 0) {
+            --skip;
+            continue;
+        }
+
+        UnspentValue value;
+        if (!cursor->GetValue(value)) {
+            return error("%s: cannot parse address unspent record", __func__);
+        }
+        unspent.push_back({key.outpoint, value.height, value.coinbase, value.amount});
+    }
+    return true;
+}
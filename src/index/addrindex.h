@@ -0,0 +1,90 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_ADDRINDEX_H
+#define BITCOIN_INDEX_ADDRINDEX_H
+
+#include <amount.h>
+#include <chain.h>
+#include <index/base.h>
+#include <script/script.h>
+
+#include <vector>
+
+/** An output paying to a script, or an input spending from it */
+struct AddressHistoryEntry {
+    int height;
+    uint256 txid;
+    //! Whether this is an input spending an output paying to the script
+    bool spend;
+    //! The output index for receives, the input index for spends
+    uint32_t index;
+    //! The value received or spent, always positive
+    CAmount amount;
+    //! The spent output, null for receives
+    COutPoint prevout;
+};
+
+/** An unspent output paying to a script */
+struct AddressUnspent {
+    COutPoint outpoint;
+    int height;
+    bool coinbase;
+    CAmount amount;
+};
+
+/**
+ * AddrIndex looks up the transaction history and unspent outputs of a
+ * scriptPubKey. Entries are keyed by the SHA256 of the script, so lookups
+ * are a single database seek no matter how long the chain is.
+ *
+ * The history records every output paying to the script and every input
+ * spending one of those outputs, in block order. Spent outputs are resolved
+ * from the block undo data, so the index is built without a UTXO lookup and
+ * can be rewound on a reorg.
+ */
+class AddrIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "addrindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit AddrIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~AddrIndex() override;
+
+    /// Look up the history of a script, oldest first.
+    ///
+    /// @param[in]   script  The scriptPubKey to look up.
+    /// @param[in]   start_height  Skip entries in blocks below this height.
+    /// @param[in]   skip  Skip this many entries from start_height on.
+    /// @param[in]   count  Return at most this many entries.
+    /// @param[out]  entries  The history entries found.
+    /// @return  false on a database error
+    bool FindHistory(const CScript& script, int start_height, size_t skip, size_t count,
+                     std::vector<AddressHistoryEntry>& entries) const;
+
+    /// Look up the unspent outputs paying to a script, ordered by outpoint.
+    bool FindUnspent(const CScript& script, size_t skip, size_t count,
+                     std::vector<AddressUnspent>& unspent) const;
+};
+
+/// The global address index. May be null.
+extern std::unique_ptr<AddrIndex> g_addrindex;
+
+#endif // BITCOIN_INDEX_ADDRINDEX_H
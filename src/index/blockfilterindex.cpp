@@ -0,0 +1,160 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coins.h>
+#include <index/blockfilterindex.h>
+#include <undo.h>
+#include <util.h>
+#include <validation.h>
+
+/* The index database stores two records per block, both keyed by block hash:
+ *
+ * - 'f' + hash -> the encoded filter
+ * - 'h' + hash -> the filter hash and filter header
+ *
+ * Headers are stored apart from the filters so a range of headers can be read
+ * without loading the filters, which are much larger.
+ */
+constexpr char DB_FILTER = 'f';
+constexpr char DB_FILTER_HEADER = 'h';
+
+std::unique_ptr<BlockFilterIndex> g_blockfilterindex;
+
+namespace {
+
+struct FilterHeaderValue {
+    uint256 hash;
+    uint256 header;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(hash);
+        READWRITE(header);
+    }
+};
+
+} // namespace
+
+/** Access to the block filter index database (indexes/blockfilter/<type>/) */
+class BlockFilterIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(const fs::path& path, size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    bool ReadFilter(const uint256& block_hash, std::vector<unsigned char>& encoded_filter) const;
+    bool ReadFilterHeader(const uint256& block_hash, FilterHeaderValue& value) const;
+};
+
+BlockFilterIndex::DB::DB(const fs::path& path, size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(path, n_cache_size, f_memory, f_wipe)
+{}
+
+bool BlockFilterIndex::DB::ReadFilter(const uint256& block_hash, std::vector<unsigned char>& encoded_filter) const
+{
+    return Read(std::make_pair(DB_FILTER, block_hash), encoded_filter);
+}
+
+bool BlockFilterIndex::DB::ReadFilterHeader(const uint256& block_hash, FilterHeaderValue& value) const
+{
+    return Read(std::make_pair(DB_FILTER_HEADER, block_hash), value);
+}
+
+BlockFilterIndex::BlockFilterIndex(BlockFilterType filter_type,
+                                   size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_filter_type(filter_type)
+{
+    const std::string& filter_name = BlockFilterTypeName(filter_type);
+    if (filter_name.empty()) throw std::invalid_argument("unknown filter_type");
+
+    m_name = filter_name + " block filter index";
+    m_db = MakeUnique<BlockFilterIndex::DB>(GetDataDir() / "indexes" / "blockfilter" / filter_name,
+                                            n_cache_size, f_memory, f_wipe);
+}
+
+BlockFilterIndex::~BlockFilterIndex() {}
+
+bool BlockFilterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // The genesis block has no undo data and spends nothing.
+    CBlockUndo block_undo;
+    uint256 prev_header;
+    if (pindex->nHeight > 0) {
+        if (!UndoReadFromDisk(block_undo, pindex)) {
+            return false;
+        }
+
+        FilterHeaderValue prev_value;
+        if (!m_db->ReadFilterHeader(pindex->pprev->GetBlockHash(), prev_value)) {
+            return error("%s: cannot read filter header of block %s", __func__,
+                         pindex->pprev->GetBlockHash().ToString());
+        }
+        prev_header = prev_value.header;
+    }
+
+    BlockFilter filter(m_filter_type, block, block_undo);
+
+    FilterHeaderValue value;
+    value.hash = filter.GetHash();
+    value.header = filter.ComputeHeader(prev_header);
+
+    CDBBatch batch(*m_db);
+    batch.Write(std::make_pair(DB_FILTER, pindex->GetBlockHash()), filter.GetEncodedFilter());
+    batch.Write(std::make_pair(DB_FILTER_HEADER, pindex->GetBlockHash()), value);
+    return m_db->WriteBatch(batch);
+}
+
+BaseIndex::DB& BlockFilterIndex::GetDB() const { return *m_db; }
+
+bool BlockFilterIndex::LookupFilter(const CBlockIndex* block_index, BlockFilter& filter_out) const
+{
+    std::vector<unsigned char> encoded_filter;
+    if (!m_db->ReadFilter(block_index->GetBlockHash(), encoded_filter)) {
+        return false;
+    }
+
+    try {
+        filter_out = BlockFilter(m_filter_type, block_index->GetBlockHash(), std::move(encoded_filter));
+    } catch (const std::exception& e) {
+        return error("%s: cannot parse filter of block %s: %s", __func__,
+                     block_index->GetBlockHash().ToString(), e.what());
+    }
+    return true;
+}
+
+bool BlockFilterIndex::LookupFilterHeader(const CBlockIndex* block_index, uint256& header_out) const
+{
+    FilterHeaderValue value;
+    if (!m_db->ReadFilterHeader(block_index->GetBlockHash(), value)) {
+        return false;
+    }
+
+    header_out = value.header;
+    return true;
+}
+
+bool BlockFilterIndex::LookupFilterHashRange(int start_height, const CBlockIndex* stop_index,
+                                             std::vector<uint256>& hashes_out, std::vector<uint256>& headers_out) const
+{
+    if (start_height < 0 || start_height > stop_index->nHeight) {
+        return error("%s: start height (%d) is outside of the range ending at %d", __func__,
+                     start_height, stop_index->nHeight);
+    }
+
+    const size_t results_size = stop_index->nHeight - start_height + 1;
+    hashes_out.resize(results_size);
+    headers_out.resize(results_size);
+
+    for (const CBlockIndex* pindex = stop_index; pindex && pindex->nHeight >= start_height; pindex = pindex->pprev) {
+        FilterHeaderValue value;
+        if (!m_db->ReadFilterHeader(pindex->GetBlockHash(), value)) {
+            return false;
+        }
+        const size_t i = pindex->nHeight - start_height;
+        hashes_out[i] = value.hash;
+        headers_out[i] = value.header;
+    }
+    return true;
+}
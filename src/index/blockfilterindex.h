@@ -0,0 +1,63 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_BLOCKFILTERINDEX_H
+#define BITCOIN_INDEX_BLOCKFILTERINDEX_H
+
+#include <blockfilter.h>
+#include <chain.h>
+#include <index/base.h>
+
+/**
+ * BlockFilterIndex is used to store and retrieve block filters, hashes, and
+ * headers for a range of blocks by block hash. Serving a light client then
+ * takes a database read instead of a scan of the block.
+ *
+ * Filters and their headers are keyed by block hash, so the entries of blocks
+ * disconnected in a reorg stay valid and the index needs no rewinding. The
+ * filters of stale blocks are not removed.
+ */
+class BlockFilterIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    BlockFilterType m_filter_type;
+    std::string m_name;
+    std::unique_ptr<DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return m_name.c_str(); }
+
+public:
+    /** Constructs the index, which becomes available to be queried. */
+    explicit BlockFilterIndex(BlockFilterType filter_type,
+                              size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~BlockFilterIndex() override;
+
+    BlockFilterType GetFilterType() const { return m_filter_type; }
+
+    /** Get a single filter by block. */
+    bool LookupFilter(const CBlockIndex* block_index, BlockFilter& filter_out) const;
+
+    /** Get a single filter header by block. */
+    bool LookupFilterHeader(const CBlockIndex* block_index, uint256& header_out) const;
+
+    /** Get the filter hash and header of each block from start_height up to
+     *  stop_index, which must be in the chain the index is synced to. */
+    bool LookupFilterHashRange(int start_height, const CBlockIndex* stop_index,
+                               std::vector<uint256>& hashes_out, std::vector<uint256>& headers_out) const;
+};
+
+/// The global block filter index. May be null.
+extern std::unique_ptr<BlockFilterIndex> g_blockfilterindex;
+
+#endif // BITCOIN_INDEX_BLOCKFILTERINDEX_H
@@ -19,6 +19,9 @@
 #include <fs.h>
 #include <httpserver.h>
 #include <httprpc.h>
+#include <index/addrindex.h>
+#include <index/blockfilterindex.h>
+#include <index/txindex.h>
 #include <key.h>
 #include <validation.h>
 #include <miner.h>
@@ -117,6 +120,7 @@ static const char* FEE_ESTIMATES_FILENAME="fee_estimates.dat";
 
 std::atomic<bool> fRequestShutdown(false);
 std::atomic<bool> fDumpMempoolLater(false);
+static bool fDumpSigCacheLater = false;
 
 void StartShutdown()
 {
@@ -168,6 +172,15 @@ void Interrupt()
     InterruptMapPort();
     if (g_connman)
         g_connman->Interrupt();
+    if (g_txindex) {
+        g_txindex->Interrupt();
+    }
+    if (g_addrindex) {
+        g_addrindex->Interrupt();
+    }
+    if (g_blockfilterindex) {
+        g_blockfilterindex->Interrupt();
+    }
 }
 
 void Shutdown()
@@ -212,6 +225,11 @@ void Shutdown()
         DumpMempool();
     }
 
+    if (fDumpSigCacheLater) {
+        DumpSignatureCache();
+        DumpScriptExecutionCache();
+    }
+
     if (fFeeEstimatesInitialized)
     {
         ::feeEstimator.FlushUnconfirmed();
@@ -233,6 +251,20 @@ void Shutdown()
     // CValidationInterface callbacks, flush them...
     GetMainSignals().FlushBackgroundCallbacks();
 
+    // Stop and delete all indexes only after flushing background callbacks.
+    if (g_txindex) {
+        g_txindex->Stop();
+        g_txindex.reset();
+    }
+    if (g_addrindex) {
+        g_addrindex->Stop();
+        g_addrindex.reset();
+    }
+    if (g_blockfilterindex) {
+        g_blockfilterindex->Stop();
+        g_blockfilterindex.reset();
+    }
+
     // Any future callbacks will be dropped. This should absolutely be safe - if
     // missing a callback results in an unrecoverable situation, unclean shutdown
     // would too. The only reason to do the above flushes is to let the wallet catch
@@ -347,8 +379,15 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory"));
     if (showDebug) {
         strUsage += HelpMessageOpt("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize));
+        strUsage += HelpMessageOpt("-dbblocksize=<n>", strprintf("Uncompressed size in bytes of a database table block (default: %u)", DEFAULT_DB_BLOCK_SIZE));
+        strUsage += HelpMessageOpt("-dbbloombits=<n>", strprintf("Bits per key of the database bloom filters, 0 to disable (default: %u)", DEFAULT_DB_BLOOM_BITS));
     }
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    if (showDebug) {
+        strUsage += HelpMessageOpt("-dbcompactidle=<n>", strprintf("Compact the databases in the background once they have been idle for <n> seconds after a flush, 0 to disable (default: %u)", DEFAULT_DB_COMPACT_IDLE));
+        strUsage += HelpMessageOpt("-dbmaxfilesize=<n>", strprintf("Size in bytes at which the database starts a new table file (default: %u)", DEFAULT_DB_MAX_FILE_SIZE));
+        strUsage += HelpMessageOpt("-dbmaxopenfiles=<n>", strprintf("Maximum number of table files kept open by each database (default: %u)", DEFAULT_DB_MAX_OPEN_FILES));
+    }
     strUsage += HelpMessageOpt("-debuglogfile=<file>", strprintf(_("Specify location of debug log file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)"), DEFAULT_DEBUGLOGFILE));
     if (showDebug)
         strUsage += HelpMessageOpt("-feefilter", strprintf("Tell other nodes to filter invs to us by our mempool min fee (default: %u)", DEFAULT_FEEFILTER));
@@ -362,6 +401,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
     strUsage += HelpMessageOpt("-persistmempool", strprintf(_("Whether to save the mempool on shutdown and load on restart (default: %u)"), DEFAULT_PERSIST_MEMPOOL));
+    strUsage += HelpMessageOpt("-persistsigcache", strprintf(_("Whether to save the signature and script execution caches on shutdown and load them on restart (default: %u)"), DEFAULT_PERSIST_SIG_CACHE));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)"), BITCOIN_PID_FILENAME));
 #endif
@@ -373,7 +413,10 @@ std::string HelpMessage(HelpMessageMode mode)
 #ifndef WIN32
     strUsage += HelpMessageOpt("-sysperms", _("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
 #endif
+    strUsage += HelpMessageOpt("-addrindex", strprintf(_("Maintain an index of outputs and spends by scriptPubKey, used by the getaddresshistory and getaddressutxos rpc calls (default: %u)"), DEFAULT_ADDRINDEX));
+    strUsage += HelpMessageOpt("-blockfilterindex", strprintf(_("Maintain an index of BIP 158 compact block filters, used by the getblockfilter rpc call and the blockfilter REST endpoints (default: %u)"), DEFAULT_BLOCKFILTERINDEX));
     strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), DEFAULT_TXINDEX));
+    strUsage += HelpMessageOpt("-utxohash", strprintf(_("Maintain a rolling hash of the UTXO set for every block, used by gettxoutsetinfo \"muhash\" (default: %u)"), DEFAULT_UTXOSETHASH));
 
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open (see the `addnode` RPC command help for more info)"));
@@ -697,6 +740,21 @@ void ThreadImport(std::vector<fs::path> vImportFiles)
     }
 }
 
+/**
+ * Compact the chainstate and block index databases while they are idle, so
+ * that the level-0 backlog left by a flush is merged before the next burst of
+ * writes runs into LevelDB's write stalls.
+ */
+static void ThreadCompactDatabases(int64_t idle_time)
+{
+    while (true) {
+        MilliSleep(10000);
+        if (pcoinsdbview) pcoinsdbview->GetDB().CompactIfIdle(idle_time, ShutdownRequested);
+        boost::this_thread::interruption_point();
+        if (pblocktree) pblocktree->CompactIfIdle(idle_time, ShutdownRequested);
+    }
+}
+
 /** Sanity checks
  *  Ensure that Bitcoin is running in a usable environment with all
  *  necessary library support.
@@ -974,6 +1032,10 @@ bool AppInitParameterInteraction()
 	// 因为block pruning需要删除一些区块的信息，而-txindex是对所有交易建立索引，所以这两者不兼容，如果同时设置了，那么则提示错误。
         if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX))
             return InitError(_("Prune mode is incompatible with -txindex."));
+        if (gArgs.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX))
+            return InitError(_("Prune mode is incompatible with -addrindex."));
+        if (gArgs.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX))
+            return InitError(_("Prune mode is incompatible with -blockfilterindex."));
     }
 
     // -bind and -whitebind can't be set when not listening
@@ -985,6 +1047,13 @@ bool AppInitParameterInteraction()
 
     // Make sure enough file descriptors are available
     int nBind = std::max(nUserBind, size_t(1));
+    // MIN_CORE_FILEDESCRIPTORS covers the default -dbmaxopenfiles for the
+    // block tree and chainstate databases; reserve more if it was raised,
+    // and a full -dbmaxopenfiles for each enabled index database.
+    int nDBMaxOpenFiles = std::max<int>(0, gArgs.GetArg("-dbmaxopenfiles", DEFAULT_DB_MAX_OPEN_FILES));
+    int nIndexDBs = gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) + gArgs.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX) +
+                    gArgs.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX);
+    int nCoreFD = MIN_CORE_FILEDESCRIPTORS + 2 * std::max(0, nDBMaxOpenFiles - DEFAULT_DB_MAX_OPEN_FILES) + nIndexDBs * nDBMaxOpenFiles;
     nUserMaxConnections = gArgs.GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
     nMaxConnections = std::max(nUserMaxConnections, 0);
 
@@ -992,11 +1061,11 @@ bool AppInitParameterInteraction()
     // 首先判断文件描述符的数量是否够用，如果不够用那么直接报错并退出程序；
     // 然后判断命令行设置的-maxconnections是否超过了系统支持的最大连接数，
     // 如果超过了，那么就提示强制设置为系统的最大连接数。
-    nMaxConnections = std::max(std::min(nMaxConnections, FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS), 0);
-    nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS + MAX_ADDNODE_CONNECTIONS);
-    if (nFD < MIN_CORE_FILEDESCRIPTORS)
+    nMaxConnections = std::max(std::min(nMaxConnections, FD_SETSIZE - nBind - nCoreFD - MAX_ADDNODE_CONNECTIONS), 0);
+    nFD = RaiseFileDescriptorLimit(nMaxConnections + nCoreFD + MAX_ADDNODE_CONNECTIONS);
+    if (nFD < nCoreFD)
         return InitError(_("Not enough file descriptors available."));
-    nMaxConnections = std::min(nFD - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS, nMaxConnections);
+    nMaxConnections = std::min(nFD - nCoreFD - MAX_ADDNODE_CONNECTIONS, nMaxConnections);
 
     if (nMaxConnections < nUserMaxConnections)
         InitWarning(strprintf(_("Reducing -maxconnections from %d to %d, because of system limitations."), nUserMaxConnections, nMaxConnections));
@@ -1066,6 +1135,7 @@ Sanity check之前在http://blog.csdn.net/pure_lady/article/details/77776716#t2
 
     // 每隔一段时间检查mapBlockIndex、setBlockIndexCandidates、chainActive和mapBlockUnlinked变量的一致性。
     fCheckBlockIndex = gArgs.GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
+    fUTXOSetHash = gArgs.GetBoolArg("-utxohash", DEFAULT_UTXOSETHASH);
 
     // 该变量默认为1，表示不验证当前已经存在的链；如果为0，表示要检查一些校验点的区块信息是否正确，所有校验点的信息也都保存在chainparams中的checkpointdata中。
     fCheckpointsEnabled = gArgs.GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
@@ -1426,6 +1496,11 @@ bool AppInitMain()
     // 这个两个变量的类型都是Cache
     InitSignatureCache();
     InitScriptExecutionCache();
+    if (gArgs.GetBoolArg("-persistsigcache", DEFAULT_PERSIST_SIG_CACHE)) {
+        LoadSignatureCache();
+        LoadScriptExecutionCache();
+        fDumpSigCacheLater = true;
+    }
 
 /*
 nScriptCheckThreads是由参数中-par设定的，位于http://blog.csdn.net/pure_lady/article/details/77982837#t4，这段代码是根据参数来创建线程具体的线程
@@ -1597,9 +1672,14 @@ nScriptCheckThreads是由参数中-par设定的，位于http://blog.csdn.net/pur
     int64_t nTotalCache = (gArgs.GetArg("-dbcache", nDefaultDbCache) << 20);
     nTotalCache = std::max(nTotalCache, nMinDbCache << 20); // total cache cannot be less than nMinDbCache
     nTotalCache = std::min(nTotalCache, nMaxDbCache << 20); // total cache cannot be greater than nMaxDbcache
-    int64_t nBlockTreeDBCache = nTotalCache / 8;
-    nBlockTreeDBCache = std::min(nBlockTreeDBCache, (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxBlockDBAndTxIndexCache : nMaxBlockDBCache) << 20);
+    int64_t nBlockTreeDBCache = std::min(nTotalCache / 8, nMaxBlockDBCache << 20);
     nTotalCache -= nBlockTreeDBCache;
+    int64_t nTxIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxTxIndexCache << 20 : 0);
+    nTotalCache -= nTxIndexCache;
+    int64_t nAddrIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX) ? nMaxAddrIndexCache << 20 : 0);
+    nTotalCache -= nAddrIndexCache;
+    int64_t nBlockFilterIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX) ? nMaxBlockFilterIndexCache << 20 : 0);
+    nTotalCache -= nBlockFilterIndexCache;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
@@ -1607,6 +1687,15 @@ nScriptCheckThreads是由参数中-par设定的，位于http://blog.csdn.net/pur
     int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
+    if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
+        LogPrintf("* Using %.1fMiB for transaction index database\n", nTxIndexCache * (1.0 / 1024 / 1024));
+    }
+    if (gArgs.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX)) {
+        LogPrintf("* Using %.1fMiB for address index database\n", nAddrIndexCache * (1.0 / 1024 / 1024));
+    }
+    if (gArgs.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX)) {
+        LogPrintf("* Using %.1fMiB for block filter index database\n", nBlockFilterIndexCache * (1.0 / 1024 / 1024));
+    }
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set (plus up to %.1fMiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
 
@@ -1640,9 +1729,8 @@ nScriptCheckThreads是由参数中-par设定的，位于http://blog.csdn.net/pur
 
                 if (fRequestShutdown) break;
 
-                // LoadBlockIndex will load fTxIndex from the db, or set it if
-                // we're reindexing. It will also load fHavePruned if we've
-                // ever removed a block file from disk.
+                // LoadBlockIndex will load fHavePruned if we've ever removed a
+                // block file from disk.
                 // Note that it also sets fReindex based on the disk flag!
                 // From here on out fReindex and fReset mean something different!
                 if (!LoadBlockIndex(chainparams)) {
@@ -1656,12 +1744,6 @@ nScriptCheckThreads是由参数中-par设定的，位于http://blog.csdn.net/pur
                     return InitError(_("Incorrect or no genesis block found. Wrong datadir for network?"));
                 }
 
-                // Check for changed -txindex state
-                if (fTxIndex != gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex to change -txindex");
-                    break;
-                }
-
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
                 // in the past, but is now trying to run unpruned.
                 if (fHavePruned && !fPruneMode) {
@@ -1721,6 +1803,13 @@ nScriptCheckThreads是由参数中-par设定的，位于http://blog.csdn.net/pur
                     }
                 }
 
+                // VerifyDB reconnects blocks at -checklevel=4, which needs the
+                // UTXO set hash of the tip to derive those below it.
+                if (!InitUTXOSetHash()) {
+                    strLoadError = _("Unable to compute the UTXO set hash for -utxohash");
+                    break;
+                }
+
                 if (!is_coinsview_empty) {
                     uiInterface.InitMessage(_("Verifying blocks..."));
                     if (fHavePruned && gArgs.GetArg("-checkblocks", DEFAULT_CHECKBLOCKS) > MIN_BLOCKS_TO_KEEP) {
@@ -1784,6 +1873,31 @@ nScriptCheckThreads是由参数中-par设定的，位于http://blog.csdn.net/pur
         LogPrintf(" block index %15dms\n", GetTimeMillis() - nStart);
     }
 
+    // The indexes are built in the background from the block files, so they
+    // can be switched on or off without a reindex.
+    if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
+        g_txindex = MakeUnique<TxIndex>(nTxIndexCache, false, fReindex);
+        if (!g_txindex->Start()) {
+            if (ShutdownRequested()) {
+                LogPrintf("Shutdown requested. Exiting.\n");
+                return false;
+            }
+            return InitError(_("Unable to open the transaction index database"));
+        }
+    }
+    if (gArgs.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX)) {
+        g_addrindex = MakeUnique<AddrIndex>(nAddrIndexCache, false, fReindex);
+        if (!g_addrindex->Start()) {
+            return InitError(_("Unable to open the address index database"));
+        }
+    }
+    if (gArgs.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX)) {
+        g_blockfilterindex = MakeUnique<BlockFilterIndex>(BlockFilterType::BASIC, nBlockFilterIndexCache, false, fReindex);
+        if (!g_blockfilterindex->Start()) {
+            return InitError(_("Unable to open the block filter index database"));
+        }
+    }
+
     fs::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
     CAutoFile est_filein(fsbridge::fopen(est_path, "rb"), SER_DISK, CLIENT_VERSION);
     // Allowed to fail as this file IS missing on first startup.
@@ -1844,6 +1958,12 @@ nScriptCheckThreads是由参数中-par设定的，位于http://blog.csdn.net/pur
 
     threadGroup.create_thread(boost::bind(&ThreadImport, vImportFiles));
 
+    const int64_t compact_idle = gArgs.GetArg("-dbcompactidle", DEFAULT_DB_COMPACT_IDLE);
+    if (compact_idle > 0) {
+        std::function<void()> compactLoop = std::bind(&ThreadCompactDatabases, compact_idle * 1000000);
+        threadGroup.create_thread(boost::bind(&TraceThread<std::function<void()>>, "dbcompact", compactLoop));
+    }
+
     // Wait for genesis block to be processed
     {
         WaitableLock lock(cs_GenesisWait);
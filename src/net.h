@@ -562,6 +562,8 @@ class CNetMessage {
 private:
     mutable CHash256 hasher;
     mutable uint256 data_hash;
+    const int nRecvType;
+    int nRecvVersion;
 public:
     bool in_data;                   // parsing header (false) or data (true)
 
@@ -569,12 +571,12 @@ public:
     CMessageHeader hdr;             // complete header
     unsigned int nHdrPos;
 
-    CDataStream vRecv;              // received message data
+    std::vector<unsigned char> vRecv; // received message data, read in place through GetDataReader()
     unsigned int nDataPos;
 
     int64_t nTime;                  // time (in microseconds) of message receipt.
 
-    CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
+    CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : nRecvType(nTypeIn), nRecvVersion(nVersionIn), hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn) {
         hdrbuf.resize(24);
         in_data = false;
         nHdrPos = 0;
@@ -594,7 +596,13 @@ public:
     void SetVersion(int nVersionIn)
     {
         hdrbuf.SetVersion(nVersionIn);
-        vRecv.SetVersion(nVersionIn);
+        nRecvVersion = nVersionIn;
+    }
+
+    /** Stream over the received message data, which must outlive it. */
+    SpanReader GetDataReader() const
+    {
+        return SpanReader(nRecvType, nRecvVersion, vRecv.data(), vRecv.size());
     }
 
     int readHeader(const char *pch, unsigned int nBytes);
@@ -7,6 +7,7 @@
 #include <policy/policy.h>
 
 #include <clientversion.h>
+#include <hash.h>
 #include <primitives/transaction.h>
 #include <streams.h>
 #include <txmempool.h>
@@ -14,6 +15,9 @@
 
 static constexpr double INF_FEERATE = 1e99;
 
+/** Fold the pending decay into the stored averages once it drops below this */
+static constexpr double MIN_DECAY_FACTOR = 1e-20;
+
 std::string StringForFeeEstimateHorizon(FeeEstimateHorizon horizon) {
     static const std::map<FeeEstimateHorizon, std::string> horizon_strings = {
         {FeeEstimateHorizon::SHORT_HALFLIFE, "short"},
@@ -96,6 +100,11 @@ private:
     // Combine the conf counts with tx counts to calculate the confirmation % for each Y,X
     // Combine the total value with the tx counts to calculate the avg feerate per bucket
 
+    // The moving averages above are stored divided by decayFactor, the product
+    // of the decays applied since they were last rescaled. Decaying them for a
+    // new block then only updates decayFactor instead of every counter.
+    double decayFactor;
+
     double decay;
 
     // Resolution (# of blocks) with which confirmations are tracked
@@ -110,6 +119,9 @@ private:
 
     void resizeInMemoryCounters(size_t newbuckets);
 
+    /** Apply decayFactor to the stored moving averages and reset it to 1 */
+    void Rescale();
+
 public:
     /**
      * Create new TxConfirmStats. This is called by BlockPolicyEstimator's
@@ -177,6 +189,7 @@ TxConfirmStats::TxConfirmStats(const std::vector<double>& defaultBuckets,
                                unsigned int maxPeriods, double _decay, unsigned int _scale)
     : buckets(defaultBuckets), bucketMap(defaultBucketMap)
 {
+    decayFactor = 1;
     decay = _decay;
     assert(_scale != 0 && "_scale must be non-zero");
     scale = _scale;
@@ -221,23 +234,33 @@ void TxConfirmStats::Record(int blocksToConfirm, double val)
         return;
     int periodsToConfirm = (blocksToConfirm + scale - 1)/scale;
     unsigned int bucketindex = bucketMap.lower_bound(val)->second;
+    const double weight = 1 / decayFactor;
     for (size_t i = periodsToConfirm; i <= confAvg.size(); i++) {
-        confAvg[i - 1][bucketindex]++;
+        confAvg[i - 1][bucketindex] += weight;
     }
-    txCtAvg[bucketindex]++;
-    avg[bucketindex] += val;
+    txCtAvg[bucketindex] += weight;
+    avg[bucketindex] += val * weight;
 }
 
 void TxConfirmStats::UpdateMovingAverages()
+{
+    decayFactor *= decay;
+    if (decayFactor < MIN_DECAY_FACTOR) {
+        Rescale();
+    }
+}
+
+void TxConfirmStats::Rescale()
 {
     for (unsigned int j = 0; j < buckets.size(); j++) {
         for (unsigned int i = 0; i < confAvg.size(); i++)
-            confAvg[i][j] = confAvg[i][j] * decay;
+            confAvg[i][j] = confAvg[i][j] * decayFactor;
         for (unsigned int i = 0; i < failAvg.size(); i++)
-            failAvg[i][j] = failAvg[i][j] * decay;
-        avg[j] = avg[j] * decay;
-        txCtAvg[j] = txCtAvg[j] * decay;
+            failAvg[i][j] = failAvg[i][j] * decayFactor;
+        avg[j] = avg[j] * decayFactor;
+        txCtAvg[j] = txCtAvg[j] * decayFactor;
     }
+    decayFactor = 1;
 }
 
 // returns -1 on error conditions
@@ -285,9 +308,9 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
             newBucketRange = false;
         }
         curFarBucket = bucket;
-        nConf += confAvg[periodTarget - 1][bucket];
-        totalNum += txCtAvg[bucket];
-        failNum += failAvg[periodTarget - 1][bucket];
+        nConf += confAvg[periodTarget - 1][bucket] * decayFactor;
+        totalNum += txCtAvg[bucket] * decayFactor;
+        failNum += failAvg[periodTarget - 1][bucket] * decayFactor;
         for (unsigned int confct = confTarget; confct < GetMaxConfirms(); confct++)
             extraNum += unconfTxs[(nBlockHeight - confct)%bins][bucket];
         extraNum += oldUnconfTxs[bucket];
@@ -342,6 +365,7 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     // Find the bucket with the median transaction and then report the average feerate from that bucket
     // This is a compromise between finding the median which we can't since we don't save all tx's
     // and reporting the average which is less accurate
+    // (Only ratios of txCtAvg and avg are used here, so decayFactor cancels out.)
     unsigned int minBucket = std::min(bestNearBucket, bestFarBucket);
     unsigned int maxBucket = std::max(bestNearBucket, bestFarBucket);
     for (unsigned int j = minBucket; j <= maxBucket; j++) {
@@ -393,14 +417,31 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     return median;
 }
 
+static std::vector<double> ScaledAverages(const std::vector<double>& stored, double factor)
+{
+    std::vector<double> result(stored);
+    for (double& val : result) {
+        val *= factor;
+    }
+    return result;
+}
+
 void TxConfirmStats::Write(CAutoFile& fileout) const
 {
+    // The file holds the decayed averages, so it does not depend on decayFactor.
+    std::vector<std::vector<double>> confAvgScaled, failAvgScaled;
+    for (const std::vector<double>& periodAvg : confAvg) {
+        confAvgScaled.push_back(ScaledAverages(periodAvg, decayFactor));
+    }
+    for (const std::vector<double>& periodAvg : failAvg) {
+        failAvgScaled.push_back(ScaledAverages(periodAvg, decayFactor));
+    }
     fileout << decay;
     fileout << scale;
-    fileout << avg;
-    fileout << txCtAvg;
-    fileout << confAvg;
-    fileout << failAvg;
+    fileout << ScaledAverages(avg, decayFactor);
+    fileout << ScaledAverages(txCtAvg, decayFactor);
+    fileout << confAvgScaled;
+    fileout << failAvgScaled;
 }
 
 void TxConfirmStats::Read(CAutoFile& filein, int nFileVersion, size_t numBuckets)
@@ -451,6 +492,8 @@ void TxConfirmStats::Read(CAutoFile& filein, int nFileVersion, size_t numBuckets
         }
     }
 
+    decayFactor = 1;
+
     // Resize the current block variables which aren't stored in the data file
     // to match the number of confirms and buckets
     resizeInMemoryCounters(numBuckets);
@@ -498,8 +541,9 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
     if (!inBlock && (unsigned int)blocksAgo >= scale) { // Only counts as a failure if not confirmed for entire period
         assert(scale != 0);
         unsigned int periodsAgo = blocksAgo / scale;
+        const double weight = 1 / decayFactor;
         for (size_t i = 0; i < periodsAgo && i < failAvg.size(); i++) {
-            failAvg[i][bucketindex]++;
+            failAvg[i][bucketindex] += weight;
         }
     }
 }
@@ -512,18 +556,26 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
 bool CBlockPolicyEstimator::removeTx(uint256 hash, bool inBlock)
 {
     LOCK(cs_feeEstimator);
-    std::map<uint256, TxStatsInfo>::iterator pos = mapMemPoolTxs.find(hash);
+    auto pos = mapMemPoolTxs.find(hash);
     if (pos != mapMemPoolTxs.end()) {
         feeStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
         shortStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
         longStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
-        mapMemPoolTxs.erase(hash);
+        mapMemPoolTxs.erase(pos);
+        smartFeeCache.clear();
         return true;
     } else {
         return false;
     }
 }
 
+CBlockPolicyEstimator::TxidHasher::TxidHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+size_t CBlockPolicyEstimator::TxidHasher::operator()(const uint256& txid) const
+{
+    return SipHashUint256(k0, k1, txid);
+}
+
 CBlockPolicyEstimator::CBlockPolicyEstimator()
     : nBestSeenHeight(0), firstRecordedHeight(0), historicalFirst(0), historicalBest(0), trackedTxs(0), untrackedTxs(0)
 {
@@ -583,6 +635,8 @@ void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, boo
     assert(bucketIndex == bucketIndex2);
     unsigned int bucketIndex3 = longStats->NewTx(txHeight, (double)feeRate.GetFeePerK());
     assert(bucketIndex == bucketIndex3);
+    // The unconfirmed counts feed into the estimates.
+    smartFeeCache.clear();
 }
 
 bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry)
@@ -629,6 +683,7 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
     // calls to removeTx (via processBlockTx) correctly calculate age
     // of unconfirmed txs to remove from tracking.
     nBestSeenHeight = nBlockHeight;
+    smartFeeCache.clear();
 
     // Update unconfirmed circular buffer
     feeStats->ClearCurrent(nBlockHeight);
@@ -821,6 +876,20 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
 {
     LOCK(cs_feeEstimator);
 
+    auto cached = smartFeeCache.find(std::make_pair(confTarget, conservative));
+    if (cached == smartFeeCache.end()) {
+        FeeCalculation calc;
+        CFeeRate feeRate = estimateSmartFeeUncached(confTarget, &calc, conservative);
+        cached = smartFeeCache.emplace(std::make_pair(confTarget, conservative), std::make_pair(feeRate, calc)).first;
+    }
+    if (feeCalc) *feeCalc = cached->second.second;
+    return cached->second.first;
+}
+
+CFeeRate CBlockPolicyEstimator::estimateSmartFeeUncached(int confTarget, FeeCalculation *feeCalc, bool conservative) const
+{
+    AssertLockHeld(cs_feeEstimator);
+
     if (feeCalc) {
         feeCalc->desiredTarget = confTarget;
         feeCalc->returnedTarget = confTarget;
@@ -972,6 +1041,7 @@ bool CBlockPolicyEstimator::Read(CAutoFile& filein)
             nBestSeenHeight = nFileBestSeenHeight;
             historicalFirst = nFileHistoricalFirst;
             historicalBest = nFileHistoricalBest;
+            smartFeeCache.clear();
         }
     }
     catch (const std::exception& e) {
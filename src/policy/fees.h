@@ -13,6 +13,7 @@
 
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 class CAutoFile;
@@ -241,8 +242,19 @@ private:
         TxStatsInfo() : blockHeight(0), bucketIndex(0) {}
     };
 
+    /** Salted hash of a txid, for mapMemPoolTxs */
+    class TxidHasher
+    {
+    private:
+        const uint64_t k0, k1;
+
+    public:
+        TxidHasher();
+        size_t operator()(const uint256& txid) const;
+    };
+
     // map of txids to information about that transaction
-    std::map<uint256, TxStatsInfo> mapMemPoolTxs;
+    std::unordered_map<uint256, TxStatsInfo, TxidHasher> mapMemPoolTxs;
 
     /** Classes to track historical data on transaction confirmations */
     std::unique_ptr<TxConfirmStats> feeStats;
@@ -257,9 +269,16 @@ private:
 
     mutable CCriticalSection cs_feeEstimator;
 
+    /** estimateSmartFee results by (confTarget, conservative). Cleared
+     *  whenever the data they depend on changes: on each new block, and when
+     *  a tracked transaction enters or leaves the mempool. */
+    mutable std::map<std::pair<int, bool>, std::pair<CFeeRate, FeeCalculation>> smartFeeCache;
+
     /** Process a transaction confirmed in a block*/
     bool processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry);
 
+    /** Helper for estimateSmartFee, computes an estimate without the cache */
+    CFeeRate estimateSmartFeeUncached(int confTarget, FeeCalculation *feeCalc, bool conservative) const;
     /** Helper for estimateSmartFee */
     double estimateCombinedFee(unsigned int confTarget, double successThreshold, bool checkShorterHorizon, EstimationResult *result) const;
     /** Helper for estimateSmartFee */
@@ -31,6 +31,10 @@
  *    - Size capacity: the number of allocated elements
  *    - T* indirect: a pointer to an array of capacity elements of type T
  *      (only the first _size are initialized).
+ *  - External storage (see assign_external):
+ *    - Size _size: the number of used elements plus N + 1
+ *    - Size capacity: 0
+ *    - T* indirect: a pointer to _size elements of type T owned by someone else.
  *
  *  The data type T must be movable by memmove/realloc(). Once we switch to C++,
  *  move constructors can be used instead.
@@ -162,19 +166,30 @@ private:
     T* indirect_ptr(difference_type pos) { return reinterpret_cast<T*>(_union.indirect) + pos; }
     const T* indirect_ptr(difference_type pos) const { return reinterpret_cast<const T*>(_union.indirect) + pos; }
     bool is_direct() const { return _size <= N; }
+    bool is_external() const { return !is_direct() && _union.capacity == 0; }
 
     void change_capacity(size_type new_capacity) {
         if (new_capacity <= N) {
             if (!is_direct()) {
                 T* indirect = indirect_ptr(0);
+                bool external = is_external();
                 T* src = indirect;
                 T* dst = direct_ptr(0);
                 memcpy(dst, src, size() * sizeof(T));
-                free(indirect);
+                if (!external) {
+                    free(indirect);
+                }
                 _size -= N + 1;
             }
         } else {
-            if (!is_direct()) {
+            if (is_external()) {
+                // External storage cannot be resized; move to an allocation of our own.
+                char* new_indirect = static_cast<char*>(malloc(((size_t)sizeof(T)) * new_capacity));
+                assert(new_indirect);
+                memcpy(new_indirect, _union.indirect, size() * sizeof(T));
+                _union.indirect = new_indirect;
+                _union.capacity = new_capacity;
+            } else if (!is_direct()) {
                 /* FIXME: Because malloc/realloc here won't call new_handler if allocation fails, assert
                     success. These should instead use an allocator or new/delete so that handlers
                     are called as necessary, but performance would be slightly degraded by doing so. */
@@ -347,6 +362,22 @@ public:
         }
     }
 
+    /** Replace the contents by the n elements at data, without copying them.
+     *  The elements stay where they are and must outlive this prevector (and
+     *  any prevector it is moved into); they are modified in place. Operations
+     *  that need more room, or shrink_to_fit, copy them into storage of the
+     *  prevector's own first.
+     */
+    void assign_external(T* data, size_type n) {
+        clear();
+        if (!is_direct() && !is_external()) {
+            free(_union.indirect);
+        }
+        _union.indirect = reinterpret_cast<char*>(data);
+        _union.capacity = 0;
+        _size = n + N + 1;
+    }
+
     void shrink_to_fit() {
         change_capacity(size());
     }
@@ -458,7 +489,7 @@ public:
         if (!std::is_trivially_destructible<T>::value) {
             clear();
         }
-        if (!is_direct()) {
+        if (!is_direct() && !is_external()) {
             free(_union.indirect);
             _union.indirect = nullptr;
         }
@@ -511,6 +542,10 @@ public:
     size_t allocated_memory() const {
         if (is_direct()) {
             return 0;
+        } else if (is_external()) {
+            // Count the external elements, so that memory usage estimates
+            // include what this prevector keeps alive.
+            return ((size_t)(sizeof(T))) * size();
         } else {
             return ((size_t)(sizeof(T))) * _union.capacity;
         }
@@ -8,6 +8,7 @@
 
 #include <primitives/transaction.h>
 #include <serialize.h>
+#include <support/monotonicarena.h>
 #include <uint256.h>
 
 /** Nodes collect new transactions into a block, hash them into a hash tree,
@@ -75,6 +76,26 @@ public:
 };
 
 
+/**
+ * Read a vector of transactions that are, together with their scripts, stored
+ * in one arena instead of many separate allocations. Every transaction shares
+ * ownership of the arena, which is freed along with the last of them.
+ */
+template <typename Stream>
+void UnserializeTransactionsInArena(Stream& s, std::vector<CTransactionRef>& vtx)
+{
+    std::shared_ptr<MonotonicArena> arena = std::make_shared<MonotonicArena>();
+    ArenaStream<Stream> arena_stream(&s, *arena);
+    vtx.clear();
+    uint64_t count = ReadCompactSize(s);
+    // Limit the up-front reservation so a bogus count won't cause out of memory.
+    vtx.reserve(std::min<uint64_t>(count, 1 + 4999999 / sizeof(CTransactionRef)));
+    for (uint64_t i = 0; i < count; ++i) {
+        const CTransaction* tx = arena->Create<CTransaction>(deserialize, arena_stream);
+        vtx.emplace_back(arena, tx);
+    }
+}
+
 class CBlock : public CBlockHeader
 {
 public:
@@ -97,12 +118,16 @@ public:
         *(static_cast<CBlockHeader*>(this)) = header;
     }
 
-    ADD_SERIALIZE_METHODS;
+    template <typename Stream>
+    void Serialize(Stream& s) const {
+        s << *static_cast<const CBlockHeader*>(this);
+        s << vtx;
+    }
 
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action) {
-        READWRITE(*static_cast<CBlockHeader*>(this));
-        READWRITE(vtx);
+    template <typename Stream>
+    void Unserialize(Stream& s) {
+        s >> *static_cast<CBlockHeader*>(this);
+        UnserializeTransactionsInArena(s, vtx);
     }
 
     void SetNull()
@@ -62,11 +62,41 @@ uint256 CMutableTransaction::GetHash() const
     return SerializeHash(*this, SER_GETHASH, SERIALIZE_TRANSACTION_NO_WITNESS);
 }
 
+bool CTransaction::ComputeHasWitness() const
+{
+    for (const CTxIn& txin : vin) {
+        if (!txin.scriptWitness.IsNull()) {
+            return true;
+        }
+    }
+    return false;
+}
+
 uint256 CTransaction::ComputeHash() const
 {
     return SerializeHash(*this, SER_GETHASH, SERIALIZE_TRANSACTION_NO_WITNESS);
 }
 
+uint256 CTransaction::ComputeHash(const std::vector<unsigned char>& serialized, bool extended) const
+{
+    if (!extended) {
+        return Hash(serialized.begin(), serialized.end());
+    }
+    // Leave out the dummy and flags after the version, and the witnesses
+    // between the outputs and the lock time.
+    uint256 result;
+    CHash256().Write(serialized.data(), 4).Write(serialized.data() + 6, m_stripped_size - 8).Write(serialized.data() + serialized.size() - 4, 4).Finalize(result.begin());
+    return result;
+}
+
+unsigned int CTransaction::ComputeSerializeSize(int nVersion) const
+{
+    // Serialize explicitly, as Serialize(CSizeComputer&) returns the cached sizes.
+    CSizeComputer s(SER_NETWORK, nVersion);
+    SerializeTransaction(*this, s);
+    return s.size();
+}
+
 uint256 CTransaction::GetWitnessHash() const
 {
     if (!HasWitness()) {
@@ -76,9 +106,20 @@ uint256 CTransaction::GetWitnessHash() const
 }
 
 /* For backward compatibility, the hash is initialized to 0. TODO: remove the need for this default constructor entirely. */
-CTransaction::CTransaction() : vin(), vout(), nVersion(CTransaction::CURRENT_VERSION), nLockTime(0), hash() {}
-CTransaction::CTransaction(const CMutableTransaction &tx) : vin(tx.vin), vout(tx.vout), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash(ComputeHash()) {}
-CTransaction::CTransaction(CMutableTransaction &&tx) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash(ComputeHash()) {}
+CTransaction::CTransaction() : vin(), vout(), nVersion(CTransaction::CURRENT_VERSION), nLockTime(0), m_has_witness(false), m_total_size(ComputeSerializeSize(PROTOCOL_VERSION)), m_stripped_size(m_total_size), hash() {}
+CTransaction::CTransaction(const CMutableTransaction &tx) : vin(tx.vin), vout(tx.vout), nVersion(tx.nVersion), nLockTime(tx.nLockTime), m_has_witness(ComputeHasWitness()), m_total_size(ComputeSerializeSize(PROTOCOL_VERSION)), m_stripped_size(m_has_witness ? ComputeSerializeSize(PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS) : m_total_size), hash(ComputeHash()) {}
+CTransaction::CTransaction(CMutableTransaction &&tx) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), m_has_witness(ComputeHasWitness()), m_total_size(ComputeSerializeSize(PROTOCOL_VERSION)), m_stripped_size(m_has_witness ? ComputeSerializeSize(PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS) : m_total_size), hash(ComputeHash()) {}
+
+/** Whether serialized is in the extended format: with witnesses allowed, an
+ *  empty vin followed by non-zero flags. */
+static bool IsExtendedSerialization(const std::vector<unsigned char>& serialized, bool allow_witness)
+{
+    return allow_witness && serialized.size() > 5 && serialized[4] == 0 && serialized[5] != 0;
+}
+
+/* The bytes read are the transaction's full serialization, unless they carry
+ * an empty witness for every input, which is not serialized again. */
+CTransaction::CTransaction(CMutableTransaction&& tx, const std::vector<unsigned char>& serialized, bool allow_witness) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), m_has_witness(ComputeHasWitness()), m_total_size(m_has_witness == IsExtendedSerialization(serialized, allow_witness) ? serialized.size() : ComputeSerializeSize(PROTOCOL_VERSION)), m_stripped_size(m_has_witness ? ComputeSerializeSize(PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS) : m_total_size), hash(ComputeHash(serialized, IsExtendedSerialization(serialized, allow_witness))) {}
 
 CAmount CTransaction::GetValueOut() const
 {
@@ -91,11 +132,6 @@ CAmount CTransaction::GetValueOut() const
     return nValueOut;
 }
 
-unsigned int CTransaction::GetTotalSize() const
-{
-    return ::GetSerializeSize(*this, SER_NETWORK, PROTOCOL_VERSION);
-}
-
 std::string CTransaction::ToString() const
 {
     std::string str;
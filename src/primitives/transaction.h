@@ -312,9 +312,19 @@ public:
 
 private:
     /** Memory only. */
+    const bool m_has_witness;
+    const unsigned int m_total_size;
+    const unsigned int m_stripped_size;
     const uint256 hash;
 
+    bool ComputeHasWitness() const;
     uint256 ComputeHash() const;
+    uint256 ComputeHash(const std::vector<unsigned char>& serialized, bool extended) const;
+    unsigned int ComputeSerializeSize(int nVersion) const;
+
+    /** Convert a CMutableTransaction read from serialized, taking the hash and
+     *  sizes from those bytes where possible. */
+    CTransaction(CMutableTransaction&& tx, const std::vector<unsigned char>& serialized, bool allow_witness);
 
 public:
     /** Construct a CTransaction that qualifies as IsNull() */
@@ -329,11 +339,24 @@ public:
         SerializeTransaction(*this, s);
     }
 
+    /** The serialized sizes are known, so computing them needs no serialization. */
+    void Serialize(CSizeComputer& s) const {
+        s.seek((s.GetVersion() & SERIALIZE_TRANSACTION_NO_WITNESS) ? m_stripped_size : m_total_size);
+    }
+
     /** This deserializing constructor is provided instead of an Unserialize method.
      *  Unserialize is not possible, since it would require overwriting const fields. */
     template <typename Stream>
     CTransaction(deserialize_type, Stream& s) : CTransaction(CMutableTransaction(deserialize, s)) {}
 
+    /** Deserialize through an ArenaStream, which records the bytes read, so
+     *  the hash covers those instead of the transaction serialized again. */
+    template <typename Stream>
+    CTransaction(deserialize_type, ArenaStream<Stream>& s) : CTransaction(CMutableTransaction(deserialize, s), s.GetRecorded(), !(s.GetVersion() & SERIALIZE_TRANSACTION_NO_WITNESS))
+    {
+        s.ClearRecorded();
+    }
+
     bool IsNull() const {
         return vin.empty() && vout.empty();
     }
@@ -357,7 +380,7 @@ public:
      * "Total Size" defined in BIP141 and BIP144.
      * @return Total transaction size in bytes
      */
-    unsigned int GetTotalSize() const;
+    unsigned int GetTotalSize() const { return m_total_size; }
 
     // 判断是否是 coinbase　交易
     bool IsCoinBase() const
@@ -377,15 +400,7 @@ public:
 
     std::string ToString() const;
 
-    bool HasWitness() const
-    {
-        for (size_t i = 0; i < vin.size(); i++) {
-            if (!vin[i].scriptWitness.IsNull()) {
-                return true;
-            }
-        }
-        return false;
-    }
+    bool HasWitness() const { return m_has_witness; }
 };
 
 /** A mutable version of CTransaction. */
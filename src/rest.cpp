@@ -3,9 +3,11 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <blockfilter.h>
 #include <chain.h>
 #include <chainparams.h>
 #include <core_io.h>
+#include <index/blockfilterindex.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <validation.h>
@@ -194,6 +196,186 @@ static bool rest_headers(HTTPRequest* req,
     }
 }
 
+static bool rest_filter_header(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+
+    std::vector<std::string> uri_parts;
+    boost::split(uri_parts, param, boost::is_any_of("/"));
+    if (uri_parts.size() != 3) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/blockfilterheaders/<filtertype>/<count>/<blockhash>");
+    }
+
+    uint256 block_hash;
+    if (!ParseHashStr(uri_parts[2], block_hash)) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + uri_parts[2]);
+    }
+
+    BlockFilterType filtertype;
+    if (!BlockFilterTypeByName(uri_parts[0], filtertype)) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Unknown filtertype " + uri_parts[0]);
+    }
+
+    if (!g_blockfilterindex || g_blockfilterindex->GetFilterType() != filtertype) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Index is not enabled for filtertype " + uri_parts[0]);
+    }
+
+    long count = strtol(uri_parts[1].c_str(), nullptr, 10);
+    if (count < 1 || count > 2000) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Header count out of range: " + uri_parts[1]);
+    }
+
+    // The headers are looked up backwards from the last block of the range,
+    // which must be in the active chain.
+    const CBlockIndex* start_index;
+    const CBlockIndex* stop_index;
+    {
+        LOCK(cs_main);
+        start_index = LookupBlockIndex(block_hash);
+        if (!start_index || !chainActive.Contains(start_index)) {
+            return RESTERR(req, HTTP_NOT_FOUND, uri_parts[2] + " not found");
+        }
+        stop_index = chainActive[std::min<int>(start_index->nHeight + count - 1, chainActive.Height())];
+    }
+
+    if (!g_blockfilterindex->BlockUntilSyncedToCurrentChain()) {
+        return RESTERR(req, HTTP_SERVICE_UNAVAILABLE, "Block filters are still in the process of being indexed");
+    }
+
+    std::vector<uint256> filter_hashes;
+    std::vector<uint256> filter_headers;
+    if (!g_blockfilterindex->LookupFilterHashRange(start_index->nHeight, stop_index, filter_hashes, filter_headers)) {
+        return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Unable to read the block filter index");
+    }
+
+    switch (rf) {
+    case RF_BINARY: {
+        CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
+        for (const uint256& header : filter_headers) {
+            ssHeader << header;
+        }
+
+        std::string binaryHeader = ssHeader.str();
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, binaryHeader);
+        return true;
+    }
+    case RF_HEX: {
+        CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
+        for (const uint256& header : filter_headers) {
+            ssHeader << header;
+        }
+
+        std::string strHex = HexStr(ssHeader.begin(), ssHeader.end()) + "\n";
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, strHex);
+        return true;
+    }
+    case RF_JSON: {
+        UniValue jsonHeaders(UniValue::VARR);
+        for (const uint256& header : filter_headers) {
+            jsonHeaders.push_back(header.GetHex());
+        }
+
+        std::string strJSON = jsonHeaders.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: .bin, .hex, .json)");
+    }
+    }
+}
+
+static bool rest_block_filter(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+
+    // request is sent over URI scheme /rest/blockfilter/filtertype/blockhash
+    std::vector<std::string> uri_parts;
+    boost::split(uri_parts, param, boost::is_any_of("/"));
+    if (uri_parts.size() != 2) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/blockfilter/<filtertype>/<blockhash>");
+    }
+
+    uint256 block_hash;
+    if (!ParseHashStr(uri_parts[1], block_hash)) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + uri_parts[1]);
+    }
+
+    BlockFilterType filtertype;
+    if (!BlockFilterTypeByName(uri_parts[0], filtertype)) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Unknown filtertype " + uri_parts[0]);
+    }
+
+    if (!g_blockfilterindex || g_blockfilterindex->GetFilterType() != filtertype) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Index is not enabled for filtertype " + uri_parts[0]);
+    }
+
+    const CBlockIndex* block_index;
+    bool block_was_connected;
+    {
+        LOCK(cs_main);
+        block_index = LookupBlockIndex(block_hash);
+        if (!block_index) {
+            return RESTERR(req, HTTP_NOT_FOUND, uri_parts[1] + " not found");
+        }
+        block_was_connected = block_index->IsValid(BLOCK_VALID_SCRIPTS);
+    }
+
+    bool index_ready = g_blockfilterindex->BlockUntilSyncedToCurrentChain();
+
+    BlockFilter filter;
+    if (!g_blockfilterindex->LookupFilter(block_index, filter)) {
+        if (!block_was_connected) {
+            return RESTERR(req, HTTP_NOT_FOUND, "Block was not connected to active chain");
+        }
+        if (!index_ready) {
+            return RESTERR(req, HTTP_SERVICE_UNAVAILABLE, "Block filters are still in the process of being indexed");
+        }
+        return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Filter not found. This error is unexpected and indicates index corruption");
+    }
+
+    switch (rf) {
+    case RF_BINARY: {
+        CDataStream ssResp(SER_NETWORK, PROTOCOL_VERSION);
+        ssResp << filter;
+
+        std::string binaryResp = ssResp.str();
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, binaryResp);
+        return true;
+    }
+    case RF_HEX: {
+        CDataStream ssResp(SER_NETWORK, PROTOCOL_VERSION);
+        ssResp << filter;
+
+        std::string strHex = HexStr(ssResp.begin(), ssResp.end()) + "\n";
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, strHex);
+        return true;
+    }
+    case RF_JSON: {
+        UniValue ret(UniValue::VOBJ);
+        ret.pushKV("filter", HexStr(filter.GetEncodedFilter()));
+        std::string strJSON = ret.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: .bin, .hex, .json)");
+    }
+    }
+}
+
 static bool rest_block(HTTPRequest* req,
                        const std::string& strURIPart,
                        bool showTxDetails)
@@ -570,6 +752,65 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
     }
 }
 
+// A bit of a hack - dependency on functions defined in rpc/blockchain.cpp
+UniValue getaddresshistory(const JSONRPCRequest& request);
+UniValue getaddressutxos(const JSONRPCRequest& request);
+
+// Serve /rest/<query>/<address>/<n>/<n>/....json by calling the matching RPC
+// with the address and up to max_numbers numeric arguments.
+static bool rest_address_query(HTTPRequest* req, const std::string& strURIPart,
+                               UniValue (*query)(const JSONRPCRequest&), size_t max_numbers)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+    if (path.empty() || path[0].empty() || path.size() > 1 + max_numbers)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format");
+
+    JSONRPCRequest jsonRequest;
+    jsonRequest.params = UniValue(UniValue::VARR);
+    jsonRequest.params.push_back(path[0]);
+    for (size_t i = 1; i < path.size(); i++) {
+        int32_t n;
+        if (!ParseInt32(path[i], &n))
+            return RESTERR(req, HTTP_BAD_REQUEST, "Parse error: " + path[i]);
+        jsonRequest.params.push_back(n);
+    }
+
+    switch (rf) {
+    case RF_JSON: {
+        UniValue result;
+        try {
+            result = query(jsonRequest);
+        } catch (const UniValue& objError) {
+            const enum HTTPStatusCode status = find_value(objError, "code").get_int() == RPC_MISC_ERROR ? HTTP_SERVICE_UNAVAILABLE : HTTP_BAD_REQUEST;
+            return RESTERR(req, status, find_value(objError, "message").get_str());
+        }
+        std::string strJSON = result.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
+    }
+    }
+}
+
+static bool rest_address_history(HTTPRequest* req, const std::string& strURIPart)
+{
+    return rest_address_query(req, strURIPart, getaddresshistory, 3);
+}
+
+static bool rest_address_utxos(HTTPRequest* req, const std::string& strURIPart)
+{
+    return rest_address_query(req, strURIPart, getaddressutxos, 2);
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
@@ -581,7 +822,11 @@ static const struct {
       {"/rest/mempool/info", rest_mempool_info},
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
+      {"/rest/blockfilter/", rest_block_filter},
+      {"/rest/blockfilterheaders/", rest_filter_header},
       {"/rest/getutxos", rest_getutxos},
+      {"/rest/addresshistory/", rest_address_history},
+      {"/rest/addressutxos/", rest_address_utxos},
 };
 
 bool StartREST()
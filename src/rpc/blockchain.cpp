@@ -17,6 +17,7 @@
 #include <policy/policy.h>
 #include <primitives/transaction.h>
 #include <rpc/server.h>
+#include <script/standard.h>
 #include <streams.h>
 #include <sync.h>
 #include <txdb.h>
@@ -24,6 +25,12 @@
 #include <util.h>
 #include <utilstrencodings.h>
 #include <hash.h>
+#include <index/addrindex.h>
+#include <index/blockfilterindex.h>
+#include <index/txindex.h>
+#include <key_io.h>
+#include <init.h>
+#include <ui_interface.h>
 #include <validationinterface.h>
 #include <warnings.h>
 
@@ -33,8 +40,10 @@
 
 #include <boost/thread/thread.hpp> // boost::thread::interrupt
 
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include <thread>
 
 struct CUpdatedBlock
 {
@@ -412,9 +421,8 @@ void entryToJSON(UniValue &info, const CTxMemPoolEntry &e)
 
     UniValue spent(UniValue::VARR);
     const CTxMemPool::txiter &it = mempool.mapTx.find(tx.GetHash());
-    const CTxMemPool::setEntries &setChildren = mempool.GetMemPoolChildren(it);
-    for (const CTxMemPool::txiter &childiter : setChildren) {
-        spent.push_back(childiter->GetTx().GetHash().ToString());
+    for (const CTxMemPoolEntry* child : mempool.GetMemPoolChildren(it)) {
+        spent.push_back(child->GetTx().GetHash().ToString());
     }
 
     info.pushKV("spentby", spent);
@@ -830,7 +838,13 @@ struct CCoinsStats
     CCoinsStats() : nHeight(0), nTransactions(0), nTransactionOutputs(0), nBogoSize(0), nDiskSize(0), nTotalAmount(0) {}
 };
 
-static void ApplyStats(CCoinsStats &stats, CHashWriter& ss, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
+//! Number of ranges of txids the UTXO set is split into by GetUTXOStats, one per leading byte
+static const int UTXO_STATS_RANGES = 256;
+//! Maximum number of threads GetUTXOStats reads the UTXO set with
+static const int MAX_UTXO_STATS_THREADS = 8;
+
+template <typename Stream>
+static void ApplyStats(CCoinsStats &stats, Stream& ss, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
 {
     assert(!outputs.empty());
     ss << hash;
@@ -848,40 +862,141 @@ static void ApplyStats(CCoinsStats &stats, CHashWriter& ss, const uint256& hash,
     ss << VARINT(0u);
 }
 
-//! Calculate statistics about the unspent transaction output set
-static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
+/** The coins of the txids sharing one leading byte, serialized as they are hashed */
+struct UTXOStatsRange
 {
-    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
-    assert(pcursor);
+    CCoinsStats stats;
+    CDataStream ss{SER_GETHASH, PROTOCOL_VERSION};
+    bool done = false;
+};
 
-    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
-    stats.hashBlock = pcursor->GetBestBlock();
-    {
-        LOCK(cs_main);
-        stats.nHeight = LookupBlockIndex(stats.hashBlock)->nHeight;
-    }
-    ss << stats.hashBlock;
+//! Count and serialize the coins in snapshot whose txid starts with first_byte
+static bool GetUTXOStatsRange(const CCoinsViewDB* view, const CDBWrapper::Snapshot& snapshot, unsigned char first_byte, UTXOStatsRange& range, const std::atomic<bool>& abort)
+{
+    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor(snapshot, first_byte));
     uint256 prevkey;
     std::map<uint32_t, Coin> outputs;
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
+    while (pcursor->Valid() && !abort) {
         COutPoint key;
         Coin coin;
-        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
-            if (!outputs.empty() && key.hash != prevkey) {
-                ApplyStats(stats, ss, prevkey, outputs);
-                outputs.clear();
-            }
-            prevkey = key.hash;
-            outputs[key.n] = std::move(coin);
-        } else {
+        if (!pcursor->GetKey(key)) {
+            return error("%s: unable to read key", __func__);
+        }
+        if (*key.hash.begin() != first_byte) {
+            break;
+        }
+        if (!pcursor->GetValue(coin)) {
             return error("%s: unable to read value", __func__);
         }
+        if (!outputs.empty() && key.hash != prevkey) {
+            ApplyStats(range.stats, range.ss, prevkey, outputs);
+            outputs.clear();
+        }
+        prevkey = key.hash;
+        outputs[key.n] = std::move(coin);
         pcursor->Next();
     }
     if (!outputs.empty()) {
-        ApplyStats(stats, ss, prevkey, outputs);
+        ApplyStats(range.stats, range.ss, prevkey, outputs);
+    }
+    return !abort;
+}
+
+/**
+ * Calculate statistics about the unspent transaction output set.
+ *
+ * Worker threads read the ranges of a single database snapshot through
+ * their own cursors. The serialized ranges are hashed in key order, so the
+ * hash is the same as that of a single sequential scan. Workers stay at most
+ * two ranges per thread ahead of the hasher to bound memory use.
+ */
+static bool GetUTXOStats(CCoinsViewDB *view, CCoinsStats &stats)
+{
+    const CDBWrapper::Snapshot snapshot = view->GetDB().GetSnapshot();
+    stats.hashBlock = view->GetBestBlock(snapshot);
+    {
+        LOCK(cs_main);
+        stats.nHeight = LookupBlockIndex(stats.hashBlock)->nHeight;
     }
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << stats.hashBlock;
+
+    std::vector<UTXOStatsRange> ranges(UTXO_STATS_RANGES);
+    std::mutex cs_ranges;
+    std::condition_variable cond_ranges;
+    std::atomic<bool> abort(false);
+    int next_range = 0;
+    int hashed = 0;
+    const int num_threads = std::max(1, std::min(GetNumCores(), MAX_UTXO_STATS_THREADS));
+
+    auto worker = [&]() {
+        while (true) {
+            int r;
+            {
+                std::unique_lock<std::mutex> lock(cs_ranges);
+                cond_ranges.wait(lock, [&] { return abort || next_range == UTXO_STATS_RANGES || next_range < hashed + 2 * num_threads; });
+                if (abort || next_range == UTXO_STATS_RANGES) return;
+                r = next_range++;
+            }
+            bool ok = false;
+            try {
+                ok = GetUTXOStatsRange(view, snapshot, r, ranges[r], abort);
+            } catch (const std::exception& e) {
+                LogPrintf("%s: %s\n", __func__, e.what());
+            }
+            {
+                std::lock_guard<std::mutex> lock(cs_ranges);
+                ranges[r].done = true;
+                if (!ok) abort = true;
+            }
+            cond_ranges.notify_all();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back(worker);
+    }
+
+    uiInterface.ShowProgress(_("Computing UTXO set statistics..."), 0, false);
+    for (int r = 0; r < UTXO_STATS_RANGES; ++r) {
+        {
+            std::unique_lock<std::mutex> lock(cs_ranges);
+            while (!ranges[r].done && !abort) {
+                if (ShutdownRequested()) {
+                    abort = true;
+                } else {
+                    cond_ranges.wait_for(lock, std::chrono::milliseconds(100));
+                }
+            }
+            if (abort) break;
+        }
+        UTXOStatsRange& range = ranges[r];
+        ss.write(range.ss.data(), range.ss.size());
+        stats.nTransactions += range.stats.nTransactions;
+        stats.nTransactionOutputs += range.stats.nTransactionOutputs;
+        stats.nBogoSize += range.stats.nBogoSize;
+        stats.nTotalAmount += range.stats.nTotalAmount;
+        range.ss = CDataStream(SER_GETHASH, PROTOCOL_VERSION);
+        {
+            std::lock_guard<std::mutex> lock(cs_ranges);
+            hashed = r + 1;
+        }
+        cond_ranges.notify_all();
+        uiInterface.ShowProgress(_("Computing UTXO set statistics..."), hashed * 100 / UTXO_STATS_RANGES, false);
+    }
+    {
+        std::lock_guard<std::mutex> lock(cs_ranges);
+        if (hashed != UTXO_STATS_RANGES) abort = true;
+    }
+    cond_ranges.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    uiInterface.ShowProgress("", 100, false);
+    if (abort) {
+        return false;
+    }
+
     stats.hashSerialized = ss.GetHash();
     stats.nDiskSize = view->EstimateSize();
     return true;
@@ -938,29 +1053,76 @@ UniValue pruneblockchain(const JSONRPCRequest& request)
 
 UniValue gettxoutsetinfo(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 0)
+    if (request.fHelp || request.params.size() > 2)
         throw std::runtime_error(
-            "gettxoutsetinfo\n"
+            "gettxoutsetinfo ( \"hash_type\" \"hash_or_height\" )\n"
             "\nReturns statistics about the unspent transaction output set.\n"
-            "Note this call may take some time.\n"
+            "Note this call may take some time, except with hash_type \"muhash\".\n"
+            "\nArguments:\n"
+            "1. \"hash_type\"       (string, optional, default=hash_serialized_2) Which UTXO set hash to return:\n"
+            "                      \"hash_serialized_2\" scans the whole UTXO set at the tip,\n"
+            "                      \"muhash\" returns the order-independent hash kept for every block with -utxohash\n"
+            "2. \"hash_or_height\"  (string or numeric, optional) With \"muhash\", the hash of the block, or the height of the\n"
+            "                      active chain block, to report on (default: the tip)\n"
             "\nResult:\n"
             "{\n"
             "  \"height\":n,     (numeric) The current block height (index)\n"
             "  \"bestblock\": \"hex\",   (string) the best block hash hex\n"
-            "  \"transactions\": n,      (numeric) The number of transactions\n"
+            "  \"transactions\": n,      (numeric) The number of transactions (hash_serialized_2 only)\n"
             "  \"txouts\": n,            (numeric) The number of output transactions\n"
             "  \"bogosize\": n,          (numeric) A meaningless metric for UTXO set size\n"
-            "  \"hash_serialized_2\": \"hash\", (string) The serialized hash\n"
-            "  \"disk_size\": n,         (numeric) The estimated size of the chainstate on disk\n"
+            "  \"hash_serialized_2\": \"hash\", (string) The serialized hash (hash_serialized_2 only)\n"
+            "  \"muhash\": \"hash\",       (string) The rolling UTXO set hash (muhash only)\n"
+            "  \"disk_size\": n,         (numeric) The estimated size of the chainstate on disk (hash_serialized_2 only)\n"
             "  \"total_amount\": x.xxx          (numeric) The total amount\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("gettxoutsetinfo", "")
+            + HelpExampleCli("gettxoutsetinfo", "\"muhash\" 1000")
             + HelpExampleRpc("gettxoutsetinfo", "")
         );
 
     UniValue ret(UniValue::VOBJ);
 
+    const std::string hash_type = request.params[0].isNull() ? "hash_serialized_2" : request.params[0].get_str();
+    if (hash_type == "muhash") {
+        if (!fUTXOSetHash) {
+            throw JSONRPCError(RPC_MISC_ERROR, "The UTXO set hash is not maintained. Use -utxohash to enable it.");
+        }
+        LOCK(cs_main);
+        const CBlockIndex* pindex = chainActive.Tip();
+        if (!request.params[1].isNull()) {
+            const std::string param = request.params[1].isNum() ? request.params[1].getValStr() : request.params[1].get_str();
+            if (param.size() == 64 && IsHex(param)) {
+                pindex = LookupBlockIndex(uint256S(param));
+                if (!pindex) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+                }
+            } else {
+                int nHeight;
+                if (!ParseInt32(param, &nHeight) || nHeight < 0 || nHeight > chainActive.Height()) {
+                    throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+                }
+                pindex = chainActive[nHeight];
+            }
+        }
+        CUTXOSetHash utxo_hash;
+        if (!pindex || !GetUTXOSetHash(pindex, utxo_hash)) {
+            throw JSONRPCError(RPC_MISC_ERROR, "No UTXO set hash for this block, it was not connected with -utxohash");
+        }
+        ret.pushKV("height", (int64_t)pindex->nHeight);
+        ret.pushKV("bestblock", pindex->GetBlockHash().GetHex());
+        ret.pushKV("txouts", (int64_t)utxo_hash.nTransactionOutputs);
+        ret.pushKV("bogosize", (int64_t)utxo_hash.nBogoSize);
+        ret.pushKV("muhash", utxo_hash.GetHash().GetHex());
+        ret.pushKV("total_amount", ValueFromAmount(utxo_hash.nTotalAmount));
+        return ret;
+    } else if (hash_type != "hash_serialized_2") {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown hash_type: " + hash_type);
+    } else if (!request.params[1].isNull()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "hash_or_height is only supported with hash_type \"muhash\"");
+    }
+
     CCoinsStats stats;
     FlushStateToDisk();
     if (GetUTXOStats(pcoinsdbview.get(), stats)) {
@@ -1387,6 +1549,20 @@ UniValue mempoolInfoToJSON()
     ret.pushKV("mempoolminfee", ValueFromAmount(std::max(mempool.GetMinFee(maxmempool), ::minRelayTxFee).GetFeePerK()));
     ret.pushKV("minrelaytxfee", ValueFromAmount(::minRelayTxFee.GetFeePerK()));
 
+    const MempoolMemoryUsage usage = mempool.GetMemoryUsageBreakdown();
+    UniValue usagedetails(UniValue::VOBJ);
+    usagedetails.pushKV("entries", (int64_t) usage.entries);
+    usagedetails.pushKV("txidindex", (int64_t) usage.txid_index);
+    usagedetails.pushKV("descendantscoreindex", (int64_t) usage.descendant_score_index);
+    usagedetails.pushKV("entrytimeindex", (int64_t) usage.entry_time_index);
+    usagedetails.pushKV("ancestorscoreindex", (int64_t) usage.ancestor_score_index);
+    usagedetails.pushKV("links", (int64_t) usage.links);
+    usagedetails.pushKV("spends", (int64_t) usage.spends);
+    usagedetails.pushKV("deltas", (int64_t) usage.deltas);
+    usagedetails.pushKV("wtxids", (int64_t) usage.wtxids);
+    usagedetails.pushKV("transactions", (int64_t) usage.transactions);
+    ret.pushKV("usagedetails", usagedetails);
+
     return ret;
 }
 
@@ -1404,6 +1580,18 @@ UniValue getmempoolinfo(const JSONRPCRequest& request)
             "  \"maxmempool\": xxxxx,         (numeric) Maximum memory usage for the mempool\n"
             "  \"mempoolminfee\": xxxxx       (numeric) Minimum fee rate in " + CURRENCY_UNIT + "/kB for tx to be accepted. Is the maximum of minrelaytxfee and minimum mempool fee\n"
             "  \"minrelaytxfee\": xxxxx       (numeric) Current minimum relay fee for transactions\n"
+            "  \"usagedetails\": {            (json object) Estimated memory usage in bytes, by data structure. Sums to usage\n"
+            "    \"entries\": xxxxx,            (numeric) Mempool entries\n"
+            "    \"txidindex\": xxxxx,          (numeric) Index by txid\n"
+            "    \"descendantscoreindex\": xxxxx, (numeric) Index by descendant feerate, used for eviction\n"
+            "    \"entrytimeindex\": xxxxx,     (numeric) Index by entry time, used for expiry\n"
+            "    \"ancestorscoreindex\": xxxxx, (numeric) Index by ancestor feerate, used for mining\n"
+            "    \"links\": xxxxx,              (numeric) In-mempool parent and child links\n"
+            "    \"spends\": xxxxx,             (numeric) Outpoints spent by mempool transactions\n"
+            "    \"deltas\": xxxxx,             (numeric) Fee deltas from prioritisetransaction\n"
+            "    \"wtxids\": xxxxx,             (numeric) Witness hashes used for compact blocks\n"
+            "    \"transactions\": xxxxx        (numeric) The transactions themselves\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getmempoolinfo", "")
@@ -1413,6 +1601,349 @@ UniValue getmempoolinfo(const JSONRPCRequest& request)
     return mempoolInfoToJSON();
 }
 
+static UniValue DBInfoToJSON(const CDBWrapper& db, bool verbose)
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("memoryusage", (uint64_t)db.DynamicMemoryUsage());
+    UniValue files(UniValue::VARR);
+    for (int level = 0; ; ++level) {
+        std::string value;
+        if (!db.GetProperty(strprintf("leveldb.num-files-at-level%d", level), value)) break;
+        files.push_back(atoi64(value));
+    }
+    ret.pushKV("levelfiles", files);
+
+    const CDBWrapper::Stats stats = db.GetStats();
+    ret.pushKV("writes", stats.writes);
+    ret.pushKV("writtenbytes", stats.written_bytes);
+    ret.pushKV("writetime", stats.write_time * 0.000001);
+    ret.pushKV("maxwritetime", stats.max_write_time * 0.000001);
+    ret.pushKV("pendingcompaction", stats.written_since_compaction);
+    ret.pushKV("compactions", stats.compactions);
+    ret.pushKV("compactiontime", stats.compaction_time * 0.000001);
+    ret.pushKV("lastcompaction", stats.last_compaction);
+
+    if (verbose) {
+        std::string value;
+        if (db.GetProperty("leveldb.stats", value)) ret.pushKV("stats", value);
+        if (db.GetProperty("leveldb.sstables", value)) ret.pushKV("sstables", value);
+    }
+    return ret;
+}
+
+UniValue getdbinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            "getdbinfo ( verbose )\n"
+            "\nReturns LevelDB statistics for the chainstate and block index databases.\n"
+            "\nArguments:\n"
+            "1. verbose           (boolean, optional, default=false) Include LevelDB's own stats and sstables reports\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"chainstate\": {          (json object) The UTXO set database\n"
+            "    \"memoryusage\": xxxxx,     (numeric) Approximate memory used by LevelDB in bytes\n"
+            "    \"levelfiles\": [ n, ... ], (array) Number of table files at each level. Writes stall once level 0 reaches 8 files\n"
+            "    \"writes\": xxxxx,          (numeric) Number of batches written since startup\n"
+            "    \"writtenbytes\": xxxxx,    (numeric) Estimated bytes written since startup\n"
+            "    \"writetime\": x.xxx,       (numeric) Seconds spent writing, including write stalls\n"
+            "    \"maxwritetime\": x.xxx,    (numeric) Longest single write in seconds\n"
+            "    \"pendingcompaction\": xxxxx, (numeric) Bytes written since the last background compaction\n"
+            "    \"compactions\": xxxxx,     (numeric) Number of background compactions (see -dbcompactidle)\n"
+            "    \"compactiontime\": x.xxx,  (numeric) Seconds spent in background compactions\n"
+            "    \"lastcompaction\": xxxxx,  (numeric) Time the last background compaction finished, in seconds since epoch, 0 if none\n"
+            "    \"stats\": \"...\",           (string) LevelDB's per level compaction report (verbose only)\n"
+            "    \"sstables\": \"...\"         (string) LevelDB's table file listing (verbose only)\n"
+            "  },\n"
+            "  \"blockindex\": {          (json object) The block index database, same fields as chainstate\n"
+            "    ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdbinfo", "")
+            + HelpExampleCli("getdbinfo", "true")
+            + HelpExampleRpc("getdbinfo", "")
+        );
+
+    const bool verbose = !request.params[0].isNull() && request.params[0].get_bool();
+
+    UniValue ret(UniValue::VOBJ);
+    if (pcoinsdbview) ret.pushKV("chainstate", DBInfoToJSON(pcoinsdbview->GetDB(), verbose));
+    if (pblocktree) ret.pushKV("blockindex", DBInfoToJSON(*pblocktree, verbose));
+    return ret;
+}
+
+static void IndexSummaryToJSON(const IndexSummary& summary, const std::string& index_name, UniValue& ret)
+{
+    if (!index_name.empty() && index_name != summary.name) return;
+
+    UniValue entry(UniValue::VOBJ);
+    entry.pushKV("synced", summary.synced);
+    entry.pushKV("best_block_height", summary.best_block_height);
+    ret.pushKV(summary.name, entry);
+}
+
+UniValue getindexinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            "getindexinfo ( \"index_name\" )\n"
+            "\nReturns the status of the enabled background indices, such as -txindex.\n"
+            "\nArguments:\n"
+            "1. \"index_name\"      (string, optional) Only return the status of this index\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"name\": {                (json object) An enabled index, keyed by name\n"
+            "    \"synced\": true|false,   (boolean) Whether the index has caught up with the block chain\n"
+            "    \"best_block_height\": xxxxx, (numeric) The height of the last block indexed, -1 if none\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getindexinfo", "")
+            + HelpExampleCli("getindexinfo", "\"txindex\"")
+            + HelpExampleRpc("getindexinfo", "")
+        );
+
+    const std::string index_name = request.params[0].isNull() ? "" : request.params[0].get_str();
+
+    UniValue ret(UniValue::VOBJ);
+    if (g_txindex) IndexSummaryToJSON(g_txindex->GetSummary(), index_name, ret);
+    if (g_addrindex) IndexSummaryToJSON(g_addrindex->GetSummary(), index_name, ret);
+    if (g_blockfilterindex) IndexSummaryToJSON(g_blockfilterindex->GetSummary(), index_name, ret);
+    return ret;
+}
+
+static const int DEFAULT_ADDRESS_QUERY_COUNT = 1000;
+static const int MAX_ADDRESS_QUERY_COUNT = 10000;
+
+static CScript AddressOrScriptFromValue(const UniValue& value)
+{
+    const std::string& str = value.get_str();
+    CTxDestination dest = DecodeDestination(str);
+    if (IsValidDestination(dest)) {
+        return GetScriptForDestination(dest);
+    }
+    if (!str.empty() && IsHex(str)) {
+        std::vector<unsigned char> data(ParseHex(str));
+        return CScript(data.begin(), data.end());
+    }
+    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address or scriptPubKey");
+}
+
+static void ParseAddressQueryRange(const UniValue& skip_value, const UniValue& count_value, size_t& skip, size_t& count)
+{
+    const int skip_int = skip_value.isNull() ? 0 : skip_value.get_int();
+    const int count_int = count_value.isNull() ? DEFAULT_ADDRESS_QUERY_COUNT : count_value.get_int();
+    if (skip_int < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative skip");
+    }
+    if (count_int < 1 || count_int > MAX_ADDRESS_QUERY_COUNT) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("count must be between 1 and %d", MAX_ADDRESS_QUERY_COUNT));
+    }
+    skip = skip_int;
+    count = count_int;
+}
+
+static void EnsureAddrIndexSynced()
+{
+    if (!g_addrindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "The address index is disabled. Use -addrindex to enable it");
+    }
+    // Wait for queued blocks before reading, without holding cs_main.
+    if (!g_addrindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, strprintf("The address index is still being built (at height %d)",
+                                                     g_addrindex->GetSummary().best_block_height));
+    }
+}
+
+UniValue getaddresshistory(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 4)
+        throw std::runtime_error(
+            "getaddresshistory \"address\" ( start_height skip count )\n"
+            "\nReturns the outputs paying to an address and the inputs spending them, oldest first.\n"
+            "Requires -addrindex. To page through a long history, pass the height of the last entry\n"
+            "returned as start_height and the number of entries already seen at that height as skip.\n"
+            "\nArguments:\n"
+            "1. \"address\"       (string, required) The address, or a hex encoded scriptPubKey\n"
+            "2. start_height    (numeric, optional, default=0) Only return entries from blocks at or above this height\n"
+            "3. skip            (numeric, optional, default=0) Skip this many entries from start_height on\n"
+            "4. count           (numeric, optional, default=" + std::to_string(DEFAULT_ADDRESS_QUERY_COUNT) + ") Return at most this many entries, up to " + std::to_string(MAX_ADDRESS_QUERY_COUNT) + "\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"txid\" : \"hash\",     (string) The transaction id\n"
+            "    \"height\" : n,        (numeric) The height of the block containing the transaction\n"
+            "    \"vout\" : n,          (numeric) For outputs paying to the address: the output index\n"
+            "    \"vin\" : n,           (numeric) For inputs spending from the address: the input index\n"
+            "    \"prevout\" : {        (json object) For inputs: the output spent\n"
+            "      \"txid\" : \"hash\",   (string) The transaction id\n"
+            "      \"vout\" : n         (numeric) The output index\n"
+            "    },\n"
+            "    \"amount\" : x.xxx,    (numeric) The value received (positive) or spent (negative) in " + CURRENCY_UNIT + "\n"
+            "  },\n"
+            "  ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddresshistory", "\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"")
+            + HelpExampleCli("getaddresshistory", "\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\" 500000 0 100")
+            + HelpExampleRpc("getaddresshistory", "\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\", 500000, 0, 100")
+        );
+
+    const CScript script = AddressOrScriptFromValue(request.params[0]);
+    const int start_height = request.params[1].isNull() ? 0 : request.params[1].get_int();
+    size_t skip, count;
+    ParseAddressQueryRange(request.params[2], request.params[3], skip, count);
+    EnsureAddrIndexSynced();
+
+    std::vector<AddressHistoryEntry> entries;
+    if (!g_addrindex->FindHistory(script, start_height, skip, count, entries)) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index");
+    }
+
+    UniValue ret(UniValue::VARR);
+    for (const AddressHistoryEntry& entry : entries) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("txid", entry.txid.GetHex());
+        obj.pushKV("height", entry.height);
+        if (entry.spend) {
+            obj.pushKV("vin", (int64_t)entry.index);
+            UniValue prevout(UniValue::VOBJ);
+            prevout.pushKV("txid", entry.prevout.hash.GetHex());
+            prevout.pushKV("vout", (int64_t)entry.prevout.n);
+            obj.pushKV("prevout", prevout);
+            obj.pushKV("amount", ValueFromAmount(-entry.amount));
+        } else {
+            obj.pushKV("vout", (int64_t)entry.index);
+            obj.pushKV("amount", ValueFromAmount(entry.amount));
+        }
+        ret.push_back(obj);
+    }
+    return ret;
+}
+
+UniValue getaddressutxos(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 3)
+        throw std::runtime_error(
+            "getaddressutxos \"address\" ( skip count )\n"
+            "\nReturns the unspent outputs paying to an address in the active chain, ordered by txid and output index.\n"
+            "Outputs spent by mempool transactions are included. Requires -addrindex.\n"
+            "\nArguments:\n"
+            "1. \"address\"       (string, required) The address, or a hex encoded scriptPubKey\n"
+            "2. skip            (numeric, optional, default=0) Skip this many outputs\n"
+            "3. count           (numeric, optional, default=" + std::to_string(DEFAULT_ADDRESS_QUERY_COUNT) + ") Return at most this many outputs, up to " + std::to_string(MAX_ADDRESS_QUERY_COUNT) + "\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"txid\" : \"hash\",     (string) The transaction id\n"
+            "    \"vout\" : n,          (numeric) The output index\n"
+            "    \"height\" : n,        (numeric) The height of the block containing the transaction\n"
+            "    \"coinbase\" : true|false, (boolean) Whether this is a coinbase output\n"
+            "    \"amount\" : x.xxx     (numeric) The value in " + CURRENCY_UNIT + "\n"
+            "  },\n"
+            "  ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddressutxos", "\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"")
+            + HelpExampleRpc("getaddressutxos", "\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\", 0, 100")
+        );
+
+    const CScript script = AddressOrScriptFromValue(request.params[0]);
+    size_t skip, count;
+    ParseAddressQueryRange(request.params[1], request.params[2], skip, count);
+    EnsureAddrIndexSynced();
+
+    std::vector<AddressUnspent> unspent;
+    if (!g_addrindex->FindUnspent(script, skip, count, unspent)) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index");
+    }
+
+    UniValue ret(UniValue::VARR);
+    for (const AddressUnspent& utxo : unspent) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("txid", utxo.outpoint.hash.GetHex());
+        obj.pushKV("vout", (int64_t)utxo.outpoint.n);
+        obj.pushKV("height", utxo.height);
+        obj.pushKV("coinbase", utxo.coinbase);
+        obj.pushKV("amount", ValueFromAmount(utxo.amount));
+        ret.push_back(obj);
+    }
+    return ret;
+}
+
+UniValue getblockfilter(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            "getblockfilter \"blockhash\" ( \"filtertype\" )\n"
+            "\nRetrieve a BIP 157 content filter for a particular block. Requires -blockfilterindex.\n"
+            "\nArguments:\n"
+            "1. \"blockhash\"     (string, required) The hash of the block\n"
+            "2. \"filtertype\"    (string, optional, default=basic) The type name of the filter\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"filter\" : \"hex\",   (string) the hex-encoded filter data\n"
+            "  \"header\" : \"hex\"    (string) the hex-encoded filter header\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\" \"basic\"")
+            + HelpExampleRpc("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\", \"basic\"")
+        );
+
+    const uint256 block_hash = ParseHashV(request.params[0], "blockhash");
+    BlockFilterType filter_type = BlockFilterType::BASIC;
+    if (!request.params[1].isNull()) {
+        if (!BlockFilterTypeByName(request.params[1].get_str(), filter_type)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown filtertype");
+        }
+    }
+
+    if (!g_blockfilterindex || g_blockfilterindex->GetFilterType() != filter_type) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Index is not enabled for filtertype " + BlockFilterTypeName(filter_type));
+    }
+
+    const CBlockIndex* block_index;
+    bool block_was_connected;
+    {
+        LOCK(cs_main);
+        block_index = LookupBlockIndex(block_hash);
+        if (!block_index) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        }
+        block_was_connected = block_index->IsValid(BLOCK_VALID_SCRIPTS);
+    }
+
+    bool index_ready = g_blockfilterindex->BlockUntilSyncedToCurrentChain();
+
+    BlockFilter filter;
+    uint256 filter_header;
+    if (!g_blockfilterindex->LookupFilter(block_index, filter) ||
+        !g_blockfilterindex->LookupFilterHeader(block_index, filter_header)) {
+        int err_code;
+        std::string errmsg = "Filter not found.";
+
+        if (!block_was_connected) {
+            err_code = RPC_INVALID_ADDRESS_OR_KEY;
+            errmsg += " Block was not connected to active chain.";
+        } else if (!index_ready) {
+            err_code = RPC_MISC_ERROR;
+            errmsg += " Block filters are still in the process of being indexed.";
+        } else {
+            err_code = RPC_INTERNAL_ERROR;
+            errmsg += " This error is unexpected and indicates index corruption.";
+        }
+
+        throw JSONRPCError(err_code, errmsg);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("filter", HexStr(filter.GetEncodedFilter()));
+    ret.pushKV("header", filter_header.GetHex());
+    return ret;
+}
+
 UniValue preciousblock(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -1632,6 +2163,11 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getblockhash",           &getblockhash,           {"height"} },
     { "blockchain",         "getblockheader",         &getblockheader,         {"blockhash","verbose"} },
     { "blockchain",         "getchaintips",           &getchaintips,           {} },
+    { "blockchain",         "getdbinfo",              &getdbinfo,              {"verbose"} },
+    { "blockchain",         "getindexinfo",           &getindexinfo,           {"index_name"} },
+    { "blockchain",         "getaddresshistory",      &getaddresshistory,      {"address","start_height","skip","count"} },
+    { "blockchain",         "getaddressutxos",        &getaddressutxos,        {"address","skip","count"} },
+    { "blockchain",         "getblockfilter",         &getblockfilter,         {"blockhash","filtertype"} },
     { "blockchain",         "getdifficulty",          &getdifficulty,          {} },
     { "blockchain",         "getmempoolancestors",    &getmempoolancestors,    {"txid","verbose"} },
     { "blockchain",         "getmempooldescendants",  &getmempooldescendants,  {"txid","verbose"} },
@@ -1639,7 +2175,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         {} },
     { "blockchain",         "getrawmempool",          &getrawmempool,          {"verbose"} },
     { "blockchain",         "gettxout",               &gettxout,               {"txid","n","include_mempool"} },
-    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {} },
+    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {"hash_type","hash_or_height"} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        {"height"} },
     { "blockchain",         "savemempool",            &savemempool,            {} },
     { "blockchain",         "verifychain",            &verifychain,            {"checklevel","nblocks"} },
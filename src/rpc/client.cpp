@@ -103,6 +103,10 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "signrawtransactionwithkey", 2, "prevtxs" },
     { "signrawtransactionwithwallet", 1, "prevtxs" },
     { "sendrawtransaction", 1, "allowhighfees" },
+    { "testmempoolaccept", 0, "rawtxs" },
+    { "testmempoolaccept", 1, "allowhighfees" },
+    { "submitpackage", 0, "rawtxs" },
+    { "submitpackage", 1, "allowhighfees" },
     { "combinerawtransaction", 0, "txs" },
     { "fundrawtransaction", 1, "options" },
     { "fundrawtransaction", 2, "iswitness" },
@@ -130,6 +134,12 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "setban", 2, "bantime" },
     { "setban", 3, "absolute" },
     { "setnetworkactive", 0, "state" },
+    { "getdbinfo", 0, "verbose" },
+    { "getaddresshistory", 1, "start_height" },
+    { "getaddresshistory", 2, "skip" },
+    { "getaddresshistory", 3, "count" },
+    { "getaddressutxos", 1, "skip" },
+    { "getaddressutxos", 2, "count" },
     { "getmempoolancestors", 1, "verbose" },
     { "getmempooldescendants", 1, "verbose" },
     { "bumpfee", 1, "options" },
@@ -7,6 +7,7 @@
 #include <coins.h>
 #include <consensus/validation.h>
 #include <core_io.h>
+#include <index/txindex.h>
 #include <init.h>
 #include <keystore.h>
 #include <validation.h>
@@ -140,8 +141,6 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
             + HelpExampleCli("getrawtransaction", "\"mytxid\" true \"myblockhash\"")
         );
 
-    LOCK(cs_main);
-
     bool in_active_chain = true;
     uint256 hash = ParseHashV(request.params[0], "parameter 1");
     CBlockIndex* blockindex = nullptr;
@@ -158,6 +157,8 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
     }
 
     if (!request.params[2].isNull()) {
+        LOCK(cs_main);
+
         uint256 blockhash = ParseHashV(request.params[2], "parameter 3");
         blockindex = LookupBlockIndex(blockhash);
         if (!blockindex) {
@@ -166,6 +167,14 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
         in_active_chain = chainActive.Contains(blockindex);
     }
 
+    // Let the transaction index catch up with the chain before taking cs_main.
+    bool f_txindex_ready = false;
+    if (g_txindex && !blockindex) {
+        f_txindex_ready = g_txindex->BlockUntilSyncedToCurrentChain();
+    }
+
+    LOCK(cs_main);
+
     CTransactionRef tx;
     uint256 hash_block;
     if (!GetTransaction(hash, tx, Params().GetConsensus(), hash_block, true, blockindex)) {
@@ -176,9 +185,13 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
             }
             errmsg = "No such transaction found in the provided block";
         } else {
-            errmsg = fTxIndex
-              ? "No such mempool or blockchain transaction"
-              : "No such mempool transaction. Use -txindex to enable blockchain transaction queries";
+            if (!g_txindex) {
+                errmsg = "No such mempool transaction. Use -txindex to enable blockchain transaction queries";
+            } else if (!f_txindex_ready) {
+                errmsg = "No such mempool transaction. Blockchain transactions are still in the process of being indexed";
+            } else {
+                errmsg = "No such mempool or blockchain transaction";
+            }
         }
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, errmsg + ". Use gettransaction for wallet transactions.");
     }
@@ -228,6 +241,11 @@ UniValue gettxoutproof(const JSONRPCRequest& request)
        oneTxid = hash;
     }
 
+    // Let the transaction index catch up with the chain before taking cs_main.
+    if (g_txindex && request.params[1].isNull()) {
+        g_txindex->BlockUntilSyncedToCurrentChain();
+    }
+
     LOCK(cs_main);
 
     CBlockIndex* pblockindex = nullptr;
@@ -1134,6 +1152,181 @@ UniValue sendrawtransaction(const JSONRPCRequest& request)
     return hashTx.GetHex();
 }
 
+UniValue testmempoolaccept(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            "testmempoolaccept [\"rawtx\",...] ( allowhighfees )\n"
+            "\nReturns whether each raw transaction (serialized, hex-encoded) would be accepted by mempool.\n"
+            "\nThis checks if the transactions violate the consensus or policy rules, without adding\n"
+            "them to the mempool or relaying them. Each transaction is checked against the current\n"
+            "mempool on its own, so a transaction spending another one in the array is reported as\n"
+            "missing inputs.\n"
+            "\nSee sendrawtransaction call.\n"
+            "\nArguments:\n"
+            "1. [\"rawtx\",...]    (array, required) An array of hex strings of raw transactions\n"
+            "2. allowhighfees    (boolean, optional, default=false) Allow high fees\n"
+            "\nResult:\n"
+            "[                   (array) The result of the mempool acceptance test for each raw transaction in the input array.\n"
+            "  {\n"
+            "    \"txid\"           (string) The transaction hash in hex\n"
+            "    \"allowed\"        (boolean) If the mempool allows this tx to be inserted\n"
+            "    \"reject-reason\"  (string) Rejection string (only present when 'allowed' is false)\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            "\nCreate a transaction\n"
+            + HelpExampleCli("createrawtransaction", "\"[{\\\"txid\\\" : \\\"mytxid\\\",\\\"vout\\\":0}]\" \"{\\\"myaddress\\\":0.01}\"") +
+            "Sign the transaction, and get back the hex\n"
+            + HelpExampleCli("signrawtransaction", "\"myhex\"") +
+            "\nTest acceptance of the transaction (signed hex)\n"
+            + HelpExampleCli("testmempoolaccept", "'[\"signedhex\"]'") +
+            "\nAs a json rpc call\n"
+            + HelpExampleRpc("testmempoolaccept", "[\"signedhex\"]")
+        );
+
+    ObserveSafeMode();
+
+    RPCTypeCheck(request.params, {UniValue::VARR, UniValue::VBOOL});
+
+    const UniValue& rawtxs = request.params[0].get_array();
+    std::vector<CTransactionRef> txs;
+    txs.reserve(rawtxs.size());
+    for (unsigned int idx = 0; idx < rawtxs.size(); idx++) {
+        CMutableTransaction mtx;
+        if (!DecodeHexTx(mtx, rawtxs[idx].get_str()))
+            throw JSONRPCError(RPC_DESERIALIZATION_ERROR, strprintf("TX decode failed for tx %d", idx));
+        txs.push_back(MakeTransactionRef(std::move(mtx)));
+    }
+
+    CAmount nMaxRawTxFee = maxTxFee;
+    if (!request.params[1].isNull() && request.params[1].get_bool())
+        nMaxRawTxFee = 0;
+
+    UniValue result(UniValue::VARR);
+
+    LOCK(cs_main);
+
+    // Verify the signatures of the whole array on the script check threads
+    // first. The checks below then find them in the signature cache, so only
+    // the cheap policy checks run one transaction at a time.
+    std::vector<COutPoint> coins_to_uncache;
+    if (nScriptCheckThreads && txs.size() > 1) {
+        LOCK(mempool.cs);
+        CCoinsViewMemPool viewMemPool(pcoinsTip.get(), mempool);
+        PrecheckTransactionScripts(txs, viewMemPool, STANDARD_SCRIPT_VERIFY_FLAGS, &coins_to_uncache);
+    }
+
+    for (const CTransactionRef& tx : txs) {
+        UniValue result_0(UniValue::VOBJ);
+        result_0.pushKV("txid", tx->GetHash().GetHex());
+
+        CValidationState state;
+        bool missing_inputs;
+        bool test_accept_res = AcceptToMemoryPool(mempool, state, tx, &missing_inputs,
+                                                  nullptr /* plTxnReplaced */, false /* bypass_limits */, nMaxRawTxFee, true /* test_accept */);
+        result_0.pushKV("allowed", test_accept_res);
+        if (!test_accept_res) {
+            if (state.IsInvalid()) {
+                result_0.pushKV("reject-reason", strprintf("%i: %s", state.GetRejectCode(), state.GetRejectReason()));
+            } else if (missing_inputs) {
+                result_0.pushKV("reject-reason", "missing-inputs");
+            } else {
+                result_0.pushKV("reject-reason", state.GetRejectReason());
+            }
+        }
+        result.push_back(result_0);
+    }
+
+    // Nothing was added to the mempool, so none of the coins the precheck
+    // pulled into the cache are needed any more.
+    for (const COutPoint& outpoint : coins_to_uncache) {
+        pcoinsTip->Uncache(outpoint);
+    }
+
+    return result;
+}
+
+UniValue submitpackage(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            "submitpackage [\"rawtx\",...] ( allowhighfees )\n"
+            "\nSubmits a package of raw transactions (serialized, hex-encoded) to local node and network.\n"
+            "\nThe package is accepted or rejected as a whole. Parents must come before their children,\n"
+            "and the mempool fee limits are checked against the feerate of the whole package, so a\n"
+            "child can pay for a parent whose own fee is too low to be accepted on its own. A package\n"
+            "that spends an output already spent by a mempool transaction is rejected.\n"
+            "\nArguments:\n"
+            "1. [\"rawtx\",...]    (array, required) An array of hex strings of raw transactions, at most " + std::to_string(MAX_PACKAGE_COUNT) + "\n"
+            "2. allowhighfees    (boolean, optional, default=false) Allow high fees\n"
+            "\nResult:\n"
+            "[                   (array) The transaction hashes in hex, in package order\n"
+            "  \"hex\",\n"
+            "  ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("submitpackage", "'[\"signedparenthex\", \"signedchildhex\"]'") +
+            HelpExampleRpc("submitpackage", "[\"signedparenthex\", \"signedchildhex\"]")
+        );
+
+    ObserveSafeMode();
+
+    std::promise<void> promise;
+
+    RPCTypeCheck(request.params, {UniValue::VARR, UniValue::VBOOL});
+
+    const UniValue& rawtxs = request.params[0].get_array();
+    if (rawtxs.size() == 0 || rawtxs.size() > MAX_PACKAGE_COUNT)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Package must contain between 1 and %u transactions", MAX_PACKAGE_COUNT));
+
+    std::vector<CTransactionRef> package;
+    package.reserve(rawtxs.size());
+    for (unsigned int idx = 0; idx < rawtxs.size(); idx++) {
+        CMutableTransaction mtx;
+        if (!DecodeHexTx(mtx, rawtxs[idx].get_str()))
+            throw JSONRPCError(RPC_DESERIALIZATION_ERROR, strprintf("TX decode failed for tx %d", idx));
+        package.push_back(MakeTransactionRef(std::move(mtx)));
+    }
+
+    CAmount nMaxRawTxFee = maxTxFee;
+    if (!request.params[1].isNull() && request.params[1].get_bool())
+        nMaxRawTxFee = 0;
+
+    { // cs_main scope
+    LOCK(cs_main);
+    CValidationState state;
+    if (!AcceptPackageToMemoryPool(mempool, state, package, nMaxRawTxFee)) {
+        if (state.IsInvalid()) {
+            throw JSONRPCError(RPC_TRANSACTION_REJECTED, FormatStateMessage(state));
+        }
+        throw JSONRPCError(RPC_TRANSACTION_ERROR, FormatStateMessage(state));
+    }
+    // As in sendrawtransaction, make sure the wallet has seen the package
+    // before returning.
+    CallFunctionInValidationInterfaceQueue([&promise] {
+        promise.set_value();
+    });
+    } // cs_main
+
+    promise.get_future().wait();
+
+    if(!g_connman)
+        throw JSONRPCError(RPC_CLIENT_P2P_DISABLED, "Error: Peer-to-peer functionality missing or disabled");
+
+    UniValue result(UniValue::VARR);
+    for (const CTransactionRef& tx : package) {
+        CInv inv(MSG_TX, tx->GetHash());
+        g_connman->ForEachNode([&inv](CNode* pnode)
+        {
+            pnode->PushInventory(inv);
+        });
+        result.push_back(tx->GetHash().GetHex());
+    }
+    return result;
+}
+
 static const CRPCCommand commands[] =
 { //  category              name                            actor (function)            argNames
   //  --------------------- ------------------------        -----------------------     ----------
@@ -1142,6 +1335,8 @@ static const CRPCCommand commands[] =
     { "rawtransactions",    "decoderawtransaction",         &decoderawtransaction,      {"hexstring","iswitness"} },
     { "rawtransactions",    "decodescript",                 &decodescript,              {"hexstring"} },
     { "rawtransactions",    "sendrawtransaction",           &sendrawtransaction,        {"hexstring","allowhighfees"} },
+    { "rawtransactions",    "testmempoolaccept",            &testmempoolaccept,         {"rawtxs","allowhighfees"} },
+    { "rawtransactions",    "submitpackage",                &submitpackage,             {"rawtxs","allowhighfees"} },
     { "rawtransactions",    "combinerawtransaction",        &combinerawtransaction,     {"txs"} },
     { "rawtransactions",    "signrawtransaction",           &signrawtransaction,        {"hexstring","prevtxs","privkeys","sighashtype"} }, /* uses wallet if enabled */
     { "rawtransactions",    "signrawtransactionwithkey",    &signrawtransactionwithkey, {"hexstring","privkeys","prevtxs","sighashtype"} },
@@ -10,8 +10,32 @@
 #include <script/interpreter.h>
 #include <version.h>
 
+#include <algorithm>
+#include <atomic>
+#include <system_error>
+#include <thread>
+#include <vector>
+
 namespace {
 
+/** Maximum number of threads bitcoinconsensus_verify_transaction uses. */
+static const unsigned int MAX_VERIFY_THREADS = 16;
+
+/** Joins the threads it holds when it goes out of scope, so that none is left
+ *  joinable (which would terminate the process) on any exit path. */
+class ThreadJoiner
+{
+public:
+    std::vector<std::thread> threads;
+
+    ~ThreadJoiner()
+    {
+        for (std::thread& thread : threads) {
+            if (thread.joinable()) thread.join();
+        }
+    }
+};
+
 /** A class that deserializes a single CTransaction one time. */
 class TxInputStream
 {
@@ -122,6 +146,68 @@ int bitcoinconsensus_verify_script(const unsigned char *scriptPubKey, unsigned i
     return ::verify_script(scriptPubKey, scriptPubKeyLen, am, txTo, txToLen, nIn, flags, err);
 }
 
+int bitcoinconsensus_verify_transaction(const unsigned char *txTo, unsigned int txToLen,
+                                    const bitcoinconsensus_spent_output *spentOutputs, unsigned int spentOutputsLen,
+                                    unsigned int flags, unsigned int nThreads, int *inputResults, bitcoinconsensus_error* err)
+{
+    if (!verify_flags(flags)) {
+        return set_error(err, bitcoinconsensus_ERR_INVALID_FLAGS);
+    }
+    try {
+        TxInputStream stream(SER_NETWORK, PROTOCOL_VERSION, txTo, txToLen);
+        const CTransaction tx(deserialize, stream);
+        if (GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION) != txToLen)
+            return set_error(err, bitcoinconsensus_ERR_TX_SIZE_MISMATCH);
+        if (spentOutputsLen != tx.vin.size() || (spentOutputsLen > 0 && spentOutputs == nullptr))
+            return set_error(err, bitcoinconsensus_ERR_SPENT_OUTPUTS_MISMATCH);
+
+        // Regardless of the verification result, the tx did not error.
+        set_error(err, bitcoinconsensus_ERR_OK);
+
+        const PrecomputedTransactionData txdata(tx);
+        std::vector<int> results(tx.vin.size(), 0);
+        std::atomic<unsigned int> next_input{0};
+        auto verify_inputs = [&] {
+            for (unsigned int nIn = next_input++; nIn < tx.vin.size(); nIn = next_input++) {
+                const bitcoinconsensus_spent_output& spent = spentOutputs[nIn];
+                try {
+                    results[nIn] = VerifyScript(tx.vin[nIn].scriptSig, CScript(spent.scriptPubKey, spent.scriptPubKey + spent.scriptPubKeyLen), &tx.vin[nIn].scriptWitness, flags, TransactionSignatureChecker(&tx, nIn, spent.amount, txdata), nullptr);
+                } catch (const std::exception&) {
+                    results[nIn] = 0;
+                }
+            }
+        };
+
+        // Inputs are handed out one at a time, so threads that get cheap
+        // inputs go on to pick up the remaining ones. Room for all threads is
+        // reserved up front, so that adding one never fails after others
+        // have started.
+        const unsigned int num_threads = std::min<size_t>(std::min(nThreads, MAX_VERIFY_THREADS), tx.vin.size());
+        {
+            ThreadJoiner joiner;
+            if (num_threads > 1) joiner.threads.reserve(num_threads - 1);
+            for (unsigned int i = 1; i < num_threads; ++i) {
+                try {
+                    joiner.threads.emplace_back(verify_inputs);
+                } catch (const std::system_error&) {
+                    // Make do with the threads we have.
+                    break;
+                }
+            }
+            verify_inputs();
+        }
+
+        int all_valid = 1;
+        for (unsigned int nIn = 0; nIn < results.size(); ++nIn) {
+            if (inputResults) inputResults[nIn] = results[nIn];
+            if (!results[nIn]) all_valid = 0;
+        }
+        return all_valid;
+    } catch (const std::exception&) {
+        return set_error(err, bitcoinconsensus_ERR_TX_DESERIALIZE); // Error deserializing
+    }
+}
+
 unsigned int bitcoinconsensus_version()
 {
     // Just use the API version for now
@@ -33,7 +33,7 @@
 extern "C" {
 #endif
 
-#define BITCOINCONSENSUS_API_VER 1
+#define BITCOINCONSENSUS_API_VER 2
 
 typedef enum bitcoinconsensus_error_t
 {
@@ -43,8 +43,17 @@ typedef enum bitcoinconsensus_error_t
     bitcoinconsensus_ERR_TX_DESERIALIZE,
     bitcoinconsensus_ERR_AMOUNT_REQUIRED,
     bitcoinconsensus_ERR_INVALID_FLAGS,
+    bitcoinconsensus_ERR_SPENT_OUTPUTS_MISMATCH,
 } bitcoinconsensus_error;
 
+/** An output spent by one of the inputs of a transaction */
+typedef struct bitcoinconsensus_spent_output
+{
+    const unsigned char *scriptPubKey;
+    unsigned int scriptPubKeyLen;
+    int64_t amount;
+} bitcoinconsensus_spent_output;
+
 /** Script verification flags */
 enum
 {
@@ -72,6 +81,19 @@ EXPORT_SYMBOL int bitcoinconsensus_verify_script_with_amount(const unsigned char
                                     const unsigned char *txTo        , unsigned int txToLen,
                                     unsigned int nIn, unsigned int flags, bitcoinconsensus_error* err);
 
+/// Returns 1 if every input of the serialized transaction pointed to by txTo
+/// correctly spends the corresponding entry of spentOutputs, which must hold
+/// exactly one output per input, under the additional constraints specified
+/// by flags. The transaction is deserialized and its signature hashes are
+/// precomputed once for all inputs, which are verified on up to nThreads
+/// threads, but no more than 16 (0 or 1 verifies them on the calling thread).
+/// If not nullptr, inputResults must have room for one entry per input and
+/// will contain the verification result of each input.
+/// If not nullptr, err will contain an error/success code for the operation
+EXPORT_SYMBOL int bitcoinconsensus_verify_transaction(const unsigned char *txTo, unsigned int txToLen,
+                                    const bitcoinconsensus_spent_output *spentOutputs, unsigned int spentOutputsLen,
+                                    unsigned int flags, unsigned int nThreads, int *inputResults, bitcoinconsensus_error* err);
+
 EXPORT_SYMBOL unsigned int bitcoinconsensus_version();
 
 #ifdef __cplusplus
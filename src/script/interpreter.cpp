@@ -5,13 +5,17 @@
 
 #include <script/interpreter.h>
 
+#include <crypto/common.h>
 #include <crypto/ripemd160.h>
 #include <crypto/sha1.h>
 #include <crypto/sha256.h>
 #include <pubkey.h>
 #include <script/script.h>
+#include <streams.h>
 #include <uint256.h>
 
+#include <limits>
+
 typedef std::vector<unsigned char> valtype;
 
 namespace {
@@ -225,33 +229,149 @@ bool static CheckPubKeyEncoding(const valtype &vchPubKey, unsigned int flags, co
     return true;
 }
 
-bool static CheckMinimalPush(const valtype& data, opcodetype opcode) {
+bool static CheckMinimalPush(CScript::const_iterator data, CScript::const_iterator data_end, opcodetype opcode) {
     // Excludes OP_1NEGATE, OP_1-16 since they are by definition minimal
     assert(0 <= opcode && opcode <= OP_PUSHDATA4);
-    if (data.size() == 0) {
+    const size_t size = data_end - data;
+    if (size == 0) {
         // Should have used OP_0.
         return opcode == OP_0;
-    } else if (data.size() == 1 && data[0] >= 1 && data[0] <= 16) {
+    } else if (size == 1 && data[0] >= 1 && data[0] <= 16) {
         // Should have used OP_1 .. OP_16.
         return false;
-    } else if (data.size() == 1 && data[0] == 0x81) {
+    } else if (size == 1 && data[0] == 0x81) {
         // Should have used OP_1NEGATE.
         return false;
-    } else if (data.size() <= 75) {
+    } else if (size <= 75) {
         // Must have used a direct push (opcode indicating number of bytes pushed + those bytes).
-        return opcode == data.size();
-    } else if (data.size() <= 255) {
+        return opcode == size;
+    } else if (size <= 255) {
         // Must have used OP_PUSHDATA.
         return opcode == OP_PUSHDATA1;
-    } else if (data.size() <= 65535) {
+    } else if (size <= 65535) {
         // Must have used OP_PUSHDATA2.
         return opcode == OP_PUSHDATA2;
     }
     return true;
 }
 
+namespace {
+/** The condition stack of EvalScript: one boolean per level of nested
+ * IF/NOTIF, telling whether that branch is executed.
+ *
+ * Execution only ever asks whether all levels are executed, so rather than
+ * storing the booleans this keeps the stack size and the position of the
+ * first false value, which makes every operation O(1) instead of scanning the
+ * stack before each opcode.
+ */
+class ConditionStack {
+private:
+    //! A constant for m_first_false_pos to indicate there are no falses.
+    static constexpr uint32_t NO_FALSE = std::numeric_limits<uint32_t>::max();
+
+    //! The size of the implied stack.
+    uint32_t m_stack_size = 0;
+    //! The position of the first false value on the implied stack, or NO_FALSE if all true.
+    uint32_t m_first_false_pos = NO_FALSE;
+
+public:
+    bool empty() const { return m_stack_size == 0; }
+    bool all_true() const { return m_first_false_pos == NO_FALSE; }
+    void push_back(bool f)
+    {
+        if (m_first_false_pos == NO_FALSE && !f) {
+            // The stack consists of all true values, and a false is added.
+            // The first false value will appear at the current size.
+            m_first_false_pos = m_stack_size;
+        }
+        ++m_stack_size;
+    }
+    void pop_back()
+    {
+        assert(m_stack_size > 0);
+        --m_stack_size;
+        if (m_first_false_pos == m_stack_size) {
+            // When popping off the first false value, everything becomes true.
+            m_first_false_pos = NO_FALSE;
+        }
+    }
+    void toggle_top()
+    {
+        assert(m_stack_size > 0);
+        if (m_first_false_pos == NO_FALSE) {
+            // The current stack is all true values; the first false will be the top.
+            m_first_false_pos = m_stack_size - 1;
+        } else if (m_first_false_pos == m_stack_size - 1) {
+            // The top is the first false value; toggling it will make everything true.
+            m_first_false_pos = NO_FALSE;
+        } else {
+            // There is a false value, but not on top. No action is needed as toggling
+            // anything but the first false value is unobservable.
+        }
+    }
+};
+} // namespace
+
+/**
+ * Execute OP_DUP OP_HASH160 <hash> OP_EQUALVERIFY OP_CHECKSIG on the stack
+ * directly. This is what EvalScript does for that script, opcode by opcode,
+ * down to which error is reported first; it only skips decoding the script and
+ * the intermediate stack entries.
+ */
+static bool EvalPayToPubKeyHash(std::vector<valtype>& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror)
+{
+    static const valtype vchFalse(0);
+    static const valtype vchTrue(1, 1);
+
+    // OP_DUP
+    if (stack.size() < 1)
+        return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
+    // OP_DUP and the push of <hash> each grow the stack by one.
+    if (stack.size() + 2 > MAX_STACK_SIZE)
+        return set_error(serror, SCRIPT_ERR_STACK_SIZE);
+
+    // OP_HASH160 <hash> OP_EQUALVERIFY
+    const valtype& vchTop = stacktop(-1);
+    unsigned char vchHash[CHash160::OUTPUT_SIZE];
+    CHash160().Write(vchTop.data(), vchTop.size()).Finalize(vchHash);
+    if (memcmp(vchHash, &script[3], sizeof(vchHash)) != 0)
+        return set_error(serror, SCRIPT_ERR_EQUALVERIFY);
+
+    // OP_CHECKSIG
+    if (stack.size() < 2)
+        return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
+
+    valtype& vchSig    = stacktop(-2);
+    valtype& vchPubKey = stacktop(-1);
+
+    CScript scriptCode(script);
+    if (sigversion == SIGVERSION_BASE) {
+        scriptCode.FindAndDelete(CScript(vchSig));
+    }
+
+    if (!CheckSignatureEncoding(vchSig, flags, serror) || !CheckPubKeyEncoding(vchPubKey, flags, sigversion, serror)) {
+        //serror is set
+        return false;
+    }
+    bool fSuccess = checker.CheckSig(vchSig, vchPubKey, scriptCode, sigversion);
+
+    if (!fSuccess && (flags & SCRIPT_VERIFY_NULLFAIL) && vchSig.size())
+        return set_error(serror, SCRIPT_ERR_SIG_NULLFAIL);
+
+    stack.pop_back();
+    stack.pop_back();
+    stack.push_back(fSuccess ? vchTrue : vchFalse);
+    return set_success(serror);
+}
+
 bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror)
 {
+    // Pay-to-pubkey-hash scripts, which P2WPKH programs also execute, are
+    // by far the most common and take a shortcut through the interpreter.
+    if (script.IsPayToPubKeyHash()) {
+        return EvalPayToPubKeyHash(stack, script, flags, checker, sigversion, serror);
+    }
+
     static const CScriptNum bnZero(0);
     static const CScriptNum bnOne(1);
     // static const CScriptNum bnFalse(0);
@@ -264,8 +384,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
     CScript::const_iterator pend = script.end();
     CScript::const_iterator pbegincodehash = script.begin();
     opcodetype opcode;
-    valtype vchPushValue;
-    std::vector<bool> vfExec;
+    CScript::const_iterator push_begin = pc;
+    ConditionStack vfExec;
     std::vector<valtype> altstack;
     set_error(serror, SCRIPT_ERR_UNKNOWN_ERROR);
     if (script.size() > MAX_SCRIPT_SIZE)
@@ -277,14 +397,15 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
     {
         while (pc < pend)
         {
-            bool fExec = !count(vfExec.begin(), vfExec.end(), false);
+            bool fExec = vfExec.all_true();
 
             //
-            // Read instruction
+            // Read instruction. Push data is left in the script and only
+            // copied when it is put on the stack.
             //
-            if (!script.GetOp(pc, opcode, vchPushValue))
+            if (!script.GetOp(pc, opcode, push_begin))
                 return set_error(serror, SCRIPT_ERR_BAD_OPCODE);
-            if (vchPushValue.size() > MAX_SCRIPT_ELEMENT_SIZE)
+            if (pc - push_begin > MAX_SCRIPT_ELEMENT_SIZE)
                 return set_error(serror, SCRIPT_ERR_PUSH_SIZE);
 
             // Note how OP_RESERVED does not count towards the opcode limit.
@@ -309,10 +430,10 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                 return set_error(serror, SCRIPT_ERR_DISABLED_OPCODE); // Disabled opcodes.
 
             if (fExec && 0 <= opcode && opcode <= OP_PUSHDATA4) {
-                if (fRequireMinimal && !CheckMinimalPush(vchPushValue, opcode)) {
+                if (fRequireMinimal && !CheckMinimalPush(push_begin, pc, opcode)) {
                     return set_error(serror, SCRIPT_ERR_MINIMALDATA);
                 }
-                stack.push_back(vchPushValue);
+                stack.emplace_back(push_begin, pc);
             } else if (fExec || (OP_IF <= opcode && opcode <= OP_ENDIF))
             switch (opcode)
             {
@@ -462,7 +583,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                 {
                     if (vfExec.empty())
                         return set_error(serror, SCRIPT_ERR_UNBALANCED_CONDITIONAL);
-                    vfExec.back() = !vfExec.back();
+                    vfExec.toggle_top();
                 }
                 break;
 
@@ -1141,6 +1262,12 @@ public:
     }
 };
 
+/** Minimum number of legacy inputs for which legacy signature hash midstates are cached */
+const size_t LEGACY_SIGHASH_CACHE_MIN_INPUTS = 16;
+
+/** Serialized size of an input whose script is blanked: prevout, empty script and nSequence */
+const size_t BLANKED_INPUT_SIZE = 36 + 1 + 4;
+
 uint256 GetPrevoutHash(const CTransaction& txTo) {
     CHashWriter ss(SER_GETHASH, 0);
     for (const auto& txin : txTo.vin) {
@@ -1176,6 +1303,29 @@ PrecomputedTransactionData::PrecomputedTransactionData(const CTransaction& txTo)
         hashOutputs = GetOutputsHash(txTo);
         ready = true;
     }
+
+    size_t legacy_inputs = 0;
+    for (const CTxIn& txin : txTo.vin) {
+        if (!txin.scriptSig.empty() && txin.scriptWitness.IsNull()) ++legacy_inputs;
+    }
+    if (legacy_inputs >= LEGACY_SIGHASH_CACHE_MIN_INPUTS) {
+        // The SIGHASH_ALL serialization for input i is this one with the
+        // scriptCode spliced in as the script of input i.
+        CVectorWriter writer(SER_GETHASH, 0, m_legacy_blanked_tx, 0);
+        writer << txTo.nVersion;
+        WriteCompactSize(writer, txTo.vin.size());
+        m_legacy_inputs_begin = m_legacy_blanked_tx.size();
+        m_legacy_midstates.reserve(txTo.vin.size());
+        CHash256 hasher;
+        size_t hashed = 0;
+        for (const CTxIn& txin : txTo.vin) {
+            hasher.Write(m_legacy_blanked_tx.data() + hashed, m_legacy_blanked_tx.size() - hashed);
+            hashed = m_legacy_blanked_tx.size();
+            m_legacy_midstates.push_back(hasher);
+            writer << txin.prevout << CScript() << txin.nSequence;
+        }
+        writer << txTo.vout << txTo.nLockTime;
+    }
 }
 
 uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const CAmount& amount, SigVersion sigversion, const PrecomputedTransactionData* cache)
@@ -1241,6 +1391,27 @@ uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsig
     // Wrapper to serialize only the necessary parts of the transaction being signed
     CTransactionSignatureSerializer txTmp(txTo, scriptCode, nIn, nHashType);
 
+    if (cache && !cache->m_legacy_midstates.empty() && !(nHashType & SIGHASH_ANYONECANPAY) &&
+        (nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE) {
+        // Resume from the midstate at the start of the input being signed,
+        // and hash the rest of the blanked serialization after it.
+        std::vector<unsigned char> input;
+        CVectorWriter writer(SER_GETHASH, 0, input, 0);
+        txTmp.SerializeInput(writer, nIn);
+        unsigned char hash_type[4];
+        WriteLE32(hash_type, nHashType);
+
+        const std::vector<unsigned char>& blanked_tx = cache->m_legacy_blanked_tx;
+        const size_t suffix_begin = cache->m_legacy_inputs_begin + (nIn + 1) * BLANKED_INPUT_SIZE;
+        CHash256 hasher = cache->m_legacy_midstates[nIn];
+        hasher.Write(input.data(), input.size());
+        hasher.Write(blanked_tx.data() + suffix_begin, blanked_tx.size() - suffix_begin);
+        hasher.Write(hash_type, sizeof(hash_type));
+        uint256 result;
+        hasher.Finalize(result.begin());
+        return result;
+    }
+
     // Serialize and hash
     CHashWriter ss(SER_GETHASH, 0);
     ss << txTmp << nHashType;
@@ -6,6 +6,7 @@
 #ifndef BITCOIN_SCRIPT_INTERPRETER_H
 #define BITCOIN_SCRIPT_INTERPRETER_H
 
+#include <hash.h>
 #include <script/script_error.h>
 #include <primitives/transaction.h>
 
@@ -120,6 +121,17 @@ struct PrecomputedTransactionData
     uint256 hashPrevouts, hashSequence, hashOutputs;
     bool ready = false;
 
+    /**
+     * Legacy SIGHASH_ALL signature hashes serialize the whole transaction for
+     * every input, which is quadratic in the number of inputs. For transactions
+     * with many legacy inputs this keeps the serialization with every input
+     * script blanked, and the hash midstate at the start of each input, so a
+     * signature hash only hashes the input being signed and what follows it.
+     */
+    std::vector<unsigned char> m_legacy_blanked_tx;
+    std::vector<CHash256> m_legacy_midstates;
+    size_t m_legacy_inputs_begin = 0;
+
     explicit PrecomputedTransactionData(const CTransaction& tx);
 };
 
@@ -520,6 +520,21 @@ public:
         return GetOp2(pc, opcodeRet, nullptr);
     }
 
+    /** Decode the opcode at pc without copying its push data, which is left
+     *  as the range [pushBeginRet, pc) of the script. */
+    bool GetOp(const_iterator& pc, opcodetype& opcodeRet, const_iterator& pushBeginRet) const
+    {
+        const_iterator pcStart = pc;
+        if (!GetOp2(pc, opcodeRet, nullptr))
+            return false;
+        pushBeginRet = pc;
+        if (opcodeRet <= OP_PUSHDATA4) {
+            const int header = opcodeRet == OP_PUSHDATA1 ? 1 : opcodeRet == OP_PUSHDATA2 ? 2 : opcodeRet == OP_PUSHDATA4 ? 4 : 0;
+            pushBeginRet = pcStart + 1 + header;
+        }
+        return true;
+    }
+
     bool GetOp2(const_iterator& pc, opcodetype& opcodeRet, std::vector<unsigned char>* pvchRet) const
     {
         opcodeRet = OP_INVALIDOPCODE;
@@ -640,6 +655,7 @@ public:
      */
     unsigned int GetSigOpCount(const CScript& scriptSig) const;
 
+    bool IsPayToPubKeyHash() const;
     bool IsPayToScriptHash() const;
     bool IsPayToWitnessScriptHash() const;
     bool IsWitnessProgram(int& version, std::vector<unsigned char>& program) const;
@@ -5,14 +5,15 @@
 
 #include <script/sigcache.h>
 
+#include <clientversion.h>
+#include <fs.h>
 #include <memusage.h>
 #include <pubkey.h>
 #include <random.h>
+#include <streams.h>
 #include <uint256.h>
 #include <util.h>
-
-#include <cuckoocache.h>
-#include <boost/thread.hpp>
+#include <utiltime.h>
 
 namespace {
 /**
@@ -25,9 +26,7 @@ class CSignatureCache
 private:
      //! Entries are SHA256(nonce || signature hash || public key || signature):
     uint256 nonce;
-    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
-    map_type setValid;
-    boost::shared_mutex cs_sigcache;
+    ShardedSignatureCache<SIGNATURE_CACHE_SHARDS> setValid;
 
 public:
     CSignatureCache()
@@ -44,19 +43,42 @@ public:
     bool
     Get(const uint256& entry, const bool erase)
     {
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
         return setValid.contains(entry, erase);
     }
 
     void Set(uint256& entry)
     {
-        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
         setValid.insert(entry);
     }
     uint32_t setup_bytes(size_t n)
     {
+        // setup_bytes does not clear the table, but no existing entry matches
+        // under a new nonce.
+        GetRandBytes(nonce.begin(), 32);
         return setValid.setup_bytes(n);
     }
+
+    template <typename Stream>
+    void Dump(Stream& s)
+    {
+        std::vector<uint256> entries;
+        setValid.for_each([&entries](const uint256& entry) { entries.push_back(entry); });
+        s << nonce << entries;
+    }
+
+    //! Replace the nonce with the dumped one and insert the dumped entries. Returns the number of entries read.
+    template <typename Stream>
+    size_t Load(Stream& s)
+    {
+        uint256 dumped_nonce;
+        std::vector<uint256> entries;
+        s >> dumped_nonce >> entries;
+        nonce = dumped_nonce;
+        for (const uint256& entry : entries) {
+            setValid.insert(entry);
+        }
+        return entries.size();
+    }
 };
 
 /* In previous versions of this code, signatureCache was a local static variable
@@ -77,8 +99,61 @@ void InitSignatureCache()
     // -maxsigcachesize=<n>：限制signature cache的大小为n MiB，默认值为32
     size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE) / 2), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
     size_t nElems = signatureCache.setup_bytes(nMaxCacheSize);
-    LogPrintf("Using %zu MiB out of %zu/2 requested for signature cache, able to store %zu elements\n",
-            (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
+    LogPrintf("Using %zu MiB out of %zu/2 requested for signature cache in %u shards, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, SIGNATURE_CACHE_SHARDS, nElems);
+}
+
+static const uint64_t SIG_CACHE_DUMP_VERSION = 1;
+
+bool DumpSignatureCache()
+{
+    int64_t start = GetTimeMicros();
+
+    try {
+        FILE* filestr = fsbridge::fopen(GetDataDir() / "sigcache.dat.new", "wb");
+        if (!filestr) {
+            return false;
+        }
+
+        CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+
+        uint64_t version = SIG_CACHE_DUMP_VERSION;
+        file << version;
+        signatureCache.Dump(file);
+
+        FileCommit(file.Get());
+        file.fclose();
+        RenameOver(GetDataDir() / "sigcache.dat.new", GetDataDir() / "sigcache.dat");
+        LogPrintf("Dumped signature cache: %.2fs\n", (GetTimeMicros() - start) * 0.000001);
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to dump signature cache: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+    return true;
+}
+
+bool LoadSignatureCache()
+{
+    FILE* filestr = fsbridge::fopen(GetDataDir() / "sigcache.dat", "rb");
+    CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        LogPrintf("Failed to open signature cache file from disk. Continuing anyway.\n");
+        return false;
+    }
+
+    try {
+        uint64_t version;
+        file >> version;
+        if (version != SIG_CACHE_DUMP_VERSION) {
+            return false;
+        }
+        size_t num_entries = signatureCache.Load(file);
+        LogPrintf("Loaded %u signature cache entries from disk\n", num_entries);
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to deserialize signature cache data on disk: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+    return true;
 }
 
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
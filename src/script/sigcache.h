@@ -6,16 +6,25 @@
 #ifndef BITCOIN_SCRIPT_SIGCACHE_H
 #define BITCOIN_SCRIPT_SIGCACHE_H
 
+#include <cuckoocache.h>
 #include <script/interpreter.h>
 
+#include <array>
 #include <vector>
 
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+
 // DoS prevention: limit cache size to 32MB (over 1000000 entries on 64-bit
 // systems). Due to how we count cache size, actual memory usage is slightly
 // more (~32.25 MB)
 static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
 // Maximum sig cache size allowed
 static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
+// Number of independently locked shards the signature cache is split into
+static const unsigned int SIGNATURE_CACHE_SHARDS = 16;
+// Default for -persistsigcache
+static const bool DEFAULT_PERSIST_SIG_CACHE = false;
 
 class CPubKey;
 
@@ -40,6 +49,66 @@ public:
     }
 };
 
+/**
+ * A cuckoo cache of signature cache entries split into independently locked
+ * shards, each sized to an equal part of the cache. Script verification
+ * threads looking up entries during block validation then rarely touch the
+ * same lock, instead of all sharing one.
+ *
+ * Entries are uniformly random, so the shard is picked by their first byte.
+ * That byte only lightly influences where the shard's hash functions place the
+ * entry, since those are dominated by the high bits of each 32-bit word.
+ */
+template <unsigned int NUM_SHARDS>
+class ShardedSignatureCache
+{
+private:
+    struct Shard {
+        CuckooCache::cache<uint256, SignatureCacheHasher> set;
+        boost::shared_mutex mutex;
+    };
+    std::array<Shard, NUM_SHARDS> m_shards;
+
+    Shard& GetShard(const uint256& entry) { return m_shards[*entry.begin() % NUM_SHARDS]; }
+
+public:
+    static_assert(NUM_SHARDS > 0, "ShardedSignatureCache needs at least one shard");
+
+    /** Size the cache to at most bytes in total. Returns the number of entries it can hold. */
+    uint32_t setup_bytes(size_t bytes)
+    {
+        uint32_t elements = 0;
+        for (Shard& shard : m_shards) {
+            boost::unique_lock<boost::shared_mutex> lock(shard.mutex);
+            elements += shard.set.setup_bytes(bytes / NUM_SHARDS);
+        }
+        return elements;
+    }
+
+    void insert(const uint256& entry)
+    {
+        Shard& shard = GetShard(entry);
+        boost::unique_lock<boost::shared_mutex> lock(shard.mutex);
+        shard.set.insert(entry);
+    }
+
+    bool contains(const uint256& entry, const bool erase)
+    {
+        Shard& shard = GetShard(entry);
+        boost::shared_lock<boost::shared_mutex> lock(shard.mutex);
+        return shard.set.contains(entry, erase);
+    }
+
+    template <typename F>
+    void for_each(F f)
+    {
+        for (Shard& shard : m_shards) {
+            boost::shared_lock<boost::shared_mutex> lock(shard.mutex);
+            shard.set.for_each(f);
+        }
+    }
+};
+
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
@@ -51,6 +120,13 @@ public:
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
 };
 
+/** Initializes the signature cache. Calling it again empties the cache. */
 void InitSignatureCache();
 
+/** Write the signature cache to sigcache.dat in the data directory */
+bool DumpSignatureCache();
+
+/** Fill the signature cache from sigcache.dat, taking over the nonce its entries were computed with */
+bool LoadSignatureCache();
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
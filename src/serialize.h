@@ -18,10 +18,12 @@
 #include <stdint.h>
 #include <string>
 #include <string.h>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 #include <prevector.h>
+#include <support/monotonicarena.h>
 
 static const unsigned int MAX_SIZE = 0x02000000;
 
@@ -77,6 +79,11 @@ template<typename Stream> inline void ser_writedata32(Stream &s, uint32_t obj)
     obj = htole32(obj);
     s.write((char*)&obj, 4);
 }
+template<typename Stream> inline void ser_writedata32be(Stream &s, uint32_t obj)
+{
+    obj = htobe32(obj);
+    s.write((char*)&obj, 4);
+}
 template<typename Stream> inline void ser_writedata64(Stream &s, uint64_t obj)
 {
     obj = htole64(obj);
@@ -100,6 +107,12 @@ template<typename Stream> inline uint32_t ser_readdata32(Stream &s)
     s.read((char*)&obj, 4);
     return le32toh(obj);
 }
+template<typename Stream> inline uint32_t ser_readdata32be(Stream &s)
+{
+    uint32_t obj;
+    s.read((char*)&obj, 4);
+    return be32toh(obj);
+}
 template<typename Stream> inline uint64_t ser_readdata64(Stream &s)
 {
     uint64_t obj;
@@ -139,6 +152,15 @@ inline float ser_uint32_to_float(uint32_t y)
 //
 
 class CSizeComputer;
+template<typename Stream> class ArenaStream;
+
+/**
+ * Whether every object of type T serializes to exactly sizeof(T) bytes, so that
+ * the size of a container of them follows from its length alone. This holds for
+ * the integer and floating point types; bool's size is implementation defined.
+ */
+template<typename T> struct IsFixedSizeSerializable : std::is_arithmetic<T> {};
+template<> struct IsFixedSizeSerializable<bool> : std::false_type {};
 
 enum
 {
@@ -508,6 +530,8 @@ template<typename Stream, unsigned int N, typename T> inline void Serialize(Stre
 template<typename Stream, unsigned int N, typename T> void Unserialize_impl(Stream& is, prevector<N, T>& v, const unsigned char&);
 template<typename Stream, unsigned int N, typename T, typename V> void Unserialize_impl(Stream& is, prevector<N, T>& v, const V&);
 template<typename Stream, unsigned int N, typename T> inline void Unserialize(Stream& is, prevector<N, T>& v);
+template<typename Stream, unsigned int N> void Unserialize(ArenaStream<Stream>& is, prevector<N, unsigned char>& v);
+template<unsigned int N, typename T> void Serialize(CSizeComputer& os, const prevector<N, T>& v);
 
 /**
  * vector
@@ -519,6 +543,7 @@ template<typename Stream, typename T, typename A> inline void Serialize(Stream&
 template<typename Stream, typename T, typename A> void Unserialize_impl(Stream& is, std::vector<T, A>& v, const unsigned char&);
 template<typename Stream, typename T, typename A, typename V> void Unserialize_impl(Stream& is, std::vector<T, A>& v, const V&);
 template<typename Stream, typename T, typename A> inline void Unserialize(Stream& is, std::vector<T, A>& v);
+template<typename T, typename A> void Serialize(CSizeComputer& os, const std::vector<T, A>& v);
 
 /**
  * pair
@@ -864,7 +889,9 @@ struct CSerActionUnserialize
  * If your Serialize or SerializationOp method has non-trivial overhead for
  * serialization, it may be worthwhile to implement a specialized version for
  * CSizeComputer, which uses the s.seek() method to record bytes that would
- * be written instead.
+ * be written instead. Vectors and prevectors of fixed size types (see
+ * IsFixedSizeSerializable) are counted this way, without visiting their
+ * elements.
  */
 class CSizeComputer
 {
@@ -902,6 +929,72 @@ public:
     int GetType() const { return nType; }
 };
 
+/**
+ * Wrapper around a stream that places byte prevectors read through it, such as
+ * scripts, in an arena instead of giving each its own allocation. The arena
+ * must outlive everything deserialized this way.
+ *
+ * It also keeps a copy of the bytes read since the last ClearRecorded(), so
+ * that an object can be hashed as it was read instead of serializing it again.
+ */
+template<typename Stream>
+class ArenaStream
+{
+    Stream* stream;
+    MonotonicArena& arena;
+    std::vector<unsigned char> recorded;
+
+public:
+    /** Larger blobs are read into allocations of their own. */
+    static const unsigned int MAX_ITEM_SIZE = 10000;
+
+    ArenaStream(Stream* stream_, MonotonicArena& arena_) : stream(stream_), arena(arena_) {}
+
+    template<typename T>
+    ArenaStream<Stream>& operator>>(T&& obj)
+    {
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+
+    void read(char* pch, size_t nSize)
+    {
+        stream->read(pch, nSize);
+        recorded.insert(recorded.end(), (const unsigned char*)pch, (const unsigned char*)pch + nSize);
+    }
+
+    const std::vector<unsigned char>& GetRecorded() const { return recorded; }
+    void ClearRecorded() { recorded.clear(); }
+
+    MonotonicArena& GetArena() { return arena; }
+    int GetVersion() const { return stream->GetVersion(); }
+    int GetType() const { return stream->GetType(); }
+};
+
+template<typename Stream, unsigned int N>
+void Unserialize(ArenaStream<Stream>& is, prevector<N, unsigned char>& v)
+{
+    unsigned int nSize = ReadCompactSize(is);
+    if (nSize > N && nSize <= ArenaStream<Stream>::MAX_ITEM_SIZE) {
+        char* data = static_cast<char*>(is.GetArena().Allocate(nSize, 1));
+        is.read(data, nSize);
+        v.assign_external(reinterpret_cast<unsigned char*>(data), nSize);
+        return;
+    }
+    // Blobs that fit in the prevector itself do not need the arena, and large
+    // ones are read in pieces so that a bogus size value won't cause out of
+    // memory, as for any other stream.
+    v.clear();
+    unsigned int i = 0;
+    while (i < nSize)
+    {
+        unsigned int blk = std::min(nSize - i, (unsigned int)5000000);
+        v.resize(i + blk);
+        is.read((char*)&v[i], blk);
+        i += blk;
+    }
+}
+
 template<typename Stream>
 void SerializeMany(Stream& s)
 {
@@ -949,6 +1042,28 @@ inline void WriteCompactSize(CSizeComputer &s, uint64_t nSize)
     s.seek(GetSizeOfCompactSize(nSize));
 }
 
+template<unsigned int N, typename T>
+void Serialize(CSizeComputer& s, const prevector<N, T>& v)
+{
+    if (IsFixedSizeSerializable<T>::value) {
+        WriteCompactSize(s, v.size());
+        s.seek(v.size() * sizeof(T));
+    } else {
+        Serialize_impl(s, v, T());
+    }
+}
+
+template<typename T, typename A>
+void Serialize(CSizeComputer& s, const std::vector<T, A>& v)
+{
+    if (IsFixedSizeSerializable<T>::value) {
+        WriteCompactSize(s, v.size());
+        s.seek(v.size() * sizeof(T));
+    } else {
+        Serialize_impl(s, v, T());
+    }
+}
+
 template <typename T>
 size_t GetSerializeSize(const T& t, int nType, int nVersion = 0)
 {
@@ -15,6 +15,7 @@
 #include <limits>
 #include <map>
 #include <set>
+#include <stdexcept>
 #include <stdint.h>
 #include <stdio.h>
 #include <string>
@@ -22,6 +23,43 @@
 #include <utility>
 #include <vector>
 
+/**
+ * XOR size bytes at data with a repeating key, starting at key byte
+ * key_offset. Key lengths that divide 8, such as the 8-byte database
+ * obfuscation key, are applied a 64-bit word at a time.
+ */
+inline void XorWithKey(unsigned char* data, size_t size, const unsigned char* key, size_t key_size, size_t key_offset = 0)
+{
+    if (key_size == 0) {
+        return;
+    }
+    key_offset %= key_size;
+
+    size_t i = 0;
+    if (8 % key_size == 0 && size >= 8) {
+        unsigned char pattern[8];
+        for (size_t j = 0; j < 8; j++) {
+            pattern[j] = key[(key_offset + j) % key_size];
+        }
+        uint64_t word_key;
+        memcpy(&word_key, pattern, 8);
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            memcpy(&word, data + i, 8);
+            word ^= word_key;
+            memcpy(data + i, &word, 8);
+        }
+        // i is now a multiple of the key size, so the tail starts at key_offset again
+    }
+
+    // Avoid a % per byte by wrapping j by hand
+    for (size_t j = key_offset; i != size; i++) {
+        data[i] ^= key[j++];
+        if (j == key_size)
+            j = 0;
+    }
+}
+
 template<typename Stream>
 class OverrideStream
 {
@@ -138,6 +176,91 @@ private:
     size_t nPos;
 };
 
+/** Minimal stream for reading from existing bytes by reference, without
+ * copying them. The bytes must outlive the reader.
+ */
+class SpanReader
+{
+private:
+    const int m_type;
+    const int m_version;
+    const unsigned char* const m_data;
+    const size_t m_size;
+    size_t m_pos = 0;
+    const std::vector<unsigned char>* m_xor_key = nullptr;
+
+public:
+
+/*
+ * @param[in]  type Serialization Type
+ * @param[in]  version Serialization Version (including any flags)
+ * @param[in]  data Start of the referenced bytes to read from
+ * @param[in]  size Number of referenced bytes
+ * @param[in]  pos Starting position. Index where reads should start.
+ */
+    SpanReader(int type, int version, const unsigned char* data, size_t size, size_t pos = 0)
+        : m_type(type), m_version(version), m_data(data), m_size(size), m_pos(pos)
+    {
+        if (m_pos > m_size) {
+            throw std::ios_base::failure("SpanReader(...): end of data (m_pos > m_size)");
+        }
+    }
+
+    SpanReader(int type, int version, const std::vector<unsigned char>& data, size_t pos)
+        : SpanReader(type, version, data.data(), data.size(), pos) {}
+
+    /**
+     * XOR everything read from now on with key, as CDataStream::Xor does for
+     * the whole buffer, so that obfuscated bytes can be read without first
+     * copying them. The key must outlive the reader.
+     */
+    void Xor(const std::vector<unsigned char>& key)
+    {
+        m_xor_key = &key;
+    }
+
+    template<typename T>
+    SpanReader& operator>>(T&& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+
+    int GetVersion() const { return m_version; }
+    int GetType() const { return m_type; }
+
+    size_t size() const { return m_size - m_pos; }
+    bool empty() const { return m_size == m_pos; }
+    size_t in_avail() const { return size(); }
+
+    void read(char* dst, size_t n)
+    {
+        if (n == 0) {
+            return;
+        }
+
+        // Read from the beginning of the buffer
+        size_t pos_next = m_pos + n;
+        if (pos_next > m_size) {
+            throw std::ios_base::failure("SpanReader::read(): end of data");
+        }
+        memcpy(dst, m_data + m_pos, n);
+        if (m_xor_key != nullptr) {
+            XorWithKey(reinterpret_cast<unsigned char*>(dst), n, m_xor_key->data(), m_xor_key->size(), m_pos);
+        }
+        m_pos = pos_next;
+    }
+
+    void ignore(size_t n)
+    {
+        if (n > m_size - m_pos) {
+            throw std::ios_base::failure("SpanReader::ignore(): end of data");
+        }
+        m_pos += n;
+    }
+};
+
 /** Double ended buffer combining vector and stream-like interfaces.
  *
  * >> and << read and write unformatted data using the above serialization templates.
@@ -418,31 +541,118 @@ public:
      */
     void Xor(const std::vector<unsigned char>& key)
     {
-        if (key.size() == 0) {
-            return;
+        XorWithKey(reinterpret_cast<unsigned char*>(vch.data()), vch.size(), key.data(), key.size());
+    }
+};
+
+
+
+
+
+
+
+
+
+
+template <typename IStream>
+class BitStreamReader
+{
+private:
+    IStream& m_istream;
+
+    /// Buffered byte read in from the input stream. A new byte is read into the
+    /// buffer when m_offset reaches 8.
+    uint8_t m_buffer{0};
+
+    /// Number of high order bits in m_buffer already returned by previous
+    /// Read() calls. The next bit to be returned is at this offset from the
+    /// most significant bit position.
+    int m_offset{8};
+
+public:
+    explicit BitStreamReader(IStream& istream) : m_istream(istream) {}
+
+    /** Read the specified number of bits from the stream. The data is returned
+     * in the nbits least significant bits of a 64-bit uint.
+     */
+    uint64_t Read(int nbits) {
+        if (nbits < 0 || nbits > 64) {
+            throw std::out_of_range("nbits must be between 0 and 64");
         }
 
-        for (size_type i = 0, j = 0; i != size(); i++) {
-            vch[i] ^= key[j++];
+        uint64_t data = 0;
+        while (nbits > 0) {
+            if (m_offset == 8) {
+                m_istream >> m_buffer;
+                m_offset = 0;
+            }
 
-            // This potentially acts on very many bytes of data, so it's
-            // important that we calculate `j`, i.e. the `key` index in this
-            // way instead of doing a %, which would effectively be a division
-            // for each byte Xor'd -- much slower than need be.
-            if (j == key.size())
-                j = 0;
+            int bits = std::min(8 - m_offset, nbits);
+            data <<= bits;
+            data |= static_cast<uint8_t>(m_buffer << m_offset) >> (8 - bits);
+            m_offset += bits;
+            nbits -= bits;
         }
+        return data;
     }
 };
 
+template <typename OStream>
+class BitStreamWriter
+{
+private:
+    OStream& m_ostream;
 
+    /// Buffered byte waiting to be written to the output stream. The byte is
+    /// written to the stream when m_offset reaches 8 or Flush() is called.
+    uint8_t m_buffer{0};
 
+    /// Number of high order bits in m_buffer already written by previous
+    /// Write() calls and not yet flushed to the stream. The next bit to be
+    /// written to is at this offset from the most significant bit position.
+    int m_offset{0};
 
+public:
+    explicit BitStreamWriter(OStream& ostream) : m_ostream(ostream) {}
+
+    ~BitStreamWriter()
+    {
+        Flush();
+    }
 
+    /** Write the nbits least significant bits of a 64-bit int to the output
+     * stream. Data is buffered until it completes an octet.
+     */
+    void Write(uint64_t data, int nbits) {
+        if (nbits < 0 || nbits > 64) {
+            throw std::out_of_range("nbits must be between 0 and 64");
+        }
 
+        while (nbits > 0) {
+            int bits = std::min(8 - m_offset, nbits);
+            m_buffer |= (data << (64 - nbits)) >> (64 - 8 + m_offset);
+            m_offset += bits;
+            nbits -= bits;
 
+            if (m_offset == 8) {
+                Flush();
+            }
+        }
+    }
 
+    /** Flush any unwritten bits to the output stream, padding with 0's to the
+     * next byte boundary.
+     */
+    void Flush() {
+        if (m_offset == 0) {
+            return;
+        }
 
+        m_ostream << m_buffer;
+        m_buffer = 0;
+        m_offset = 0;
+    }
+};
 
 /** Non-refcounted RAII wrapper for FILE*
  *
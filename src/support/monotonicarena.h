@@ -0,0 +1,101 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SUPPORT_MONOTONICARENA_H
+#define BITCOIN_SUPPORT_MONOTONICARENA_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+/**
+ * Hands out memory from a few large chunks, and frees all of it at once when
+ * destroyed. Objects made with Create are destroyed first, in reverse order of
+ * creation. Memory is never reused, so this suits many small allocations that
+ * all have the same lifetime, such as the contents of a block.
+ *
+ * Not thread safe.
+ */
+class MonotonicArena
+{
+public:
+    static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+    static const size_t MAX_CHUNK_SIZE = 1024 * 1024;
+
+    explicit MonotonicArena(size_t chunk_size = DEFAULT_CHUNK_SIZE) : m_next_chunk_size(chunk_size) {}
+
+    ~MonotonicArena()
+    {
+        for (Destructor* d = m_destructors; d != nullptr; d = d->next) {
+            d->destroy(d->object);
+        }
+    }
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    /** Allocate size bytes aligned to align, which must be a power of two no larger than alignof(max_align_t). */
+    void* Allocate(size_t size, size_t align = alignof(max_align_t))
+    {
+        assert(align != 0 && (align & (align - 1)) == 0 && align <= alignof(max_align_t));
+        size_t padding = (align - (reinterpret_cast<uintptr_t>(m_cur) & (align - 1))) & (align - 1);
+        if (m_cur == nullptr || padding + size > m_left) {
+            NewChunk(size);
+            padding = 0;
+        }
+        void* ret = m_cur + padding;
+        m_cur += padding + size;
+        m_left -= padding + size;
+        return ret;
+    }
+
+    /** Construct a T in the arena, to be destroyed along with it. */
+    template <typename T, typename... Args>
+    T* Create(Args&&... args)
+    {
+        Destructor* d = static_cast<Destructor*>(Allocate(sizeof(Destructor), alignof(Destructor)));
+        T* object = new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        d->destroy = [](void* p) { static_cast<T*>(p)->~T(); };
+        d->object = object;
+        d->next = m_destructors;
+        m_destructors = d;
+        return object;
+    }
+
+    /** Total size of the chunks allocated so far. */
+    size_t AllocatedBytes() const { return m_allocated; }
+
+private:
+    struct Destructor {
+        void (*destroy)(void*);
+        void* object;
+        Destructor* next;
+    };
+
+    void NewChunk(size_t min_size)
+    {
+        // Grow chunks geometrically so that large contents need few of them.
+        const size_t size = std::max(min_size, m_next_chunk_size);
+        m_chunks.emplace_back(new char[size]);
+        m_cur = m_chunks.back().get();
+        m_left = size;
+        m_allocated += size;
+        m_next_chunk_size = std::min(m_next_chunk_size * 2, MAX_CHUNK_SIZE);
+    }
+
+    std::vector<std::unique_ptr<char[]>> m_chunks;
+    char* m_cur = nullptr;
+    size_t m_left = 0;
+    size_t m_next_chunk_size;
+    size_t m_allocated = 0;
+    Destructor* m_destructors = nullptr;
+};
+
+#endif // BITCOIN_SUPPORT_MONOTONICARENA_H
@@ -0,0 +1,150 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <index/addrindex.h>
+#include <script/sign.h>
+#include <script/standard.h>
+#include <test/test_bitcoin.h>
+#include <txmempool.h>
+#include <utiltime.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(addrindex_tests)
+
+static bool HasUnspent(const AddrIndex& addrindex, const CScript& script, const COutPoint& outpoint)
+{
+    std::vector<AddressUnspent> unspent;
+    BOOST_REQUIRE(addrindex.FindUnspent(script, 0, 1000, unspent));
+    for (const AddressUnspent& utxo : unspent) {
+        if (utxo.outpoint == outpoint) return true;
+    }
+    return false;
+}
+
+BOOST_FIXTURE_TEST_CASE(addrindex_history_and_unspent, TestChain100Setup)
+{
+    const CScript coinbase_script = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CKey other_key;
+    other_key.MakeNewKey(true);
+    const CScript other_script = GetScriptForDestination(other_key.GetPubKey().GetID());
+
+    AddrIndex addrindex(1 << 20, true);
+    BOOST_REQUIRE(addrindex.Start());
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!addrindex.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // Every block paid its coinbase to the same script.
+    std::vector<AddressHistoryEntry> history;
+    std::vector<AddressUnspent> unspent;
+    BOOST_CHECK(addrindex.FindHistory(coinbase_script, 0, 0, 1000, history));
+    BOOST_CHECK(addrindex.FindUnspent(coinbase_script, 0, 1000, unspent));
+    BOOST_REQUIRE_EQUAL(history.size(), coinbaseTxns.size());
+    BOOST_CHECK_EQUAL(unspent.size(), coinbaseTxns.size());
+    for (size_t i = 0; i < history.size(); ++i) {
+        BOOST_CHECK_EQUAL(history[i].height, (int)i + 1);
+        BOOST_CHECK(history[i].txid == coinbaseTxns[i].GetHash());
+        BOOST_CHECK(!history[i].spend);
+        BOOST_CHECK_EQUAL(history[i].amount, coinbaseTxns[i].vout[0].nValue);
+    }
+    BOOST_CHECK(unspent[0].coinbase);
+
+    // Pages start at a height and skip entries from there.
+    history.clear();
+    BOOST_CHECK(addrindex.FindHistory(coinbase_script, 10, 5, 3, history));
+    BOOST_REQUIRE_EQUAL(history.size(), 3U);
+    BOOST_CHECK_EQUAL(history[0].height, 15);
+    BOOST_CHECK_EQUAL(history[2].height, 17);
+
+    // Spend the first coinbase to another script.
+    const COutPoint spent_outpoint(coinbaseTxns[0].GetHash(), 0);
+    CMutableTransaction spend;
+    spend.nVersion = 1;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = spent_outpoint;
+    spend.vout.resize(1);
+    spend.vout[0].nValue = coinbaseTxns[0].vout[0].nValue - CENT;
+    spend.vout[0].scriptPubKey = other_script;
+    std::vector<unsigned char> sig;
+    uint256 hash = SignatureHash(coinbase_script, spend, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    BOOST_REQUIRE(coinbaseKey.Sign(hash, sig));
+    sig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << sig;
+
+    CBlock block = CreateAndProcessBlock({spend}, coinbase_script);
+    BOOST_REQUIRE(chainActive.Tip()->GetBlockHash() == block.GetHash());
+    BOOST_REQUIRE(addrindex.BlockUntilSyncedToCurrentChain());
+    const int spend_height = chainActive.Height();
+
+    history.clear();
+    BOOST_CHECK(addrindex.FindHistory(coinbase_script, spend_height, 0, 1000, history));
+    BOOST_REQUIRE_EQUAL(history.size(), 2U);
+    BOOST_CHECK(!history[0].spend);
+    BOOST_CHECK(history[1].spend);
+    BOOST_CHECK(history[1].txid == spend.GetHash());
+    BOOST_CHECK_EQUAL(history[1].index, 0U);
+    BOOST_CHECK(history[1].prevout == spent_outpoint);
+    BOOST_CHECK_EQUAL(history[1].amount, coinbaseTxns[0].vout[0].nValue);
+    BOOST_CHECK(!HasUnspent(addrindex, coinbase_script, spent_outpoint));
+
+    history.clear();
+    unspent.clear();
+    BOOST_CHECK(addrindex.FindHistory(other_script, 0, 0, 1000, history));
+    BOOST_CHECK(addrindex.FindUnspent(other_script, 0, 1000, unspent));
+    BOOST_REQUIRE_EQUAL(history.size(), 1U);
+    BOOST_CHECK_EQUAL(history[0].height, spend_height);
+    BOOST_REQUIRE_EQUAL(unspent.size(), 1U);
+    BOOST_CHECK(unspent[0].outpoint == COutPoint(spend.GetHash(), 0));
+    BOOST_CHECK(!unspent[0].coinbase);
+    BOOST_CHECK_EQUAL(unspent[0].amount, spend.vout[0].nValue);
+
+    // Reorg the spend out: the index rewinds the block when the replacement
+    // is connected.
+    {
+        CValidationState state;
+        CBlockIndex* tip;
+        {
+            LOCK(cs_main);
+            tip = chainActive.Tip();
+        }
+        BOOST_REQUIRE(InvalidateBlock(state, Params(), tip));
+        BOOST_REQUIRE(ActivateBestChain(state, Params()));
+    }
+    // The disconnected spend went back to the mempool; drop it so the
+    // replacement coinbase does not claim its fee. Pay the replacement
+    // elsewhere, or it would be the invalidated block again.
+    mempool.clear();
+    CreateAndProcessBlock({}, CScript() << OP_TRUE);
+    BOOST_REQUIRE_EQUAL(chainActive.Height(), spend_height);
+    BOOST_REQUIRE(addrindex.BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK_EQUAL(addrindex.GetSummary().best_block_height, spend_height);
+
+    history.clear();
+    unspent.clear();
+    BOOST_CHECK(addrindex.FindHistory(other_script, 0, 0, 1000, history));
+    BOOST_CHECK(addrindex.FindUnspent(other_script, 0, 1000, unspent));
+    BOOST_CHECK(history.empty());
+    BOOST_CHECK(unspent.empty());
+    BOOST_CHECK(HasUnspent(addrindex, coinbase_script, spent_outpoint));
+
+    history.clear();
+    BOOST_CHECK(addrindex.FindHistory(coinbase_script, spend_height, 0, 1000, history));
+    BOOST_CHECK(history.empty());
+    history.clear();
+    BOOST_CHECK(addrindex.FindHistory(CScript() << OP_TRUE, 0, 0, 1000, history));
+    BOOST_REQUIRE_EQUAL(history.size(), 1U);
+    BOOST_CHECK_EQUAL(history[0].height, spend_height);
+
+    addrindex.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
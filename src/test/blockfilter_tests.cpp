@@ -0,0 +1,221 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockfilter.h>
+#include <chainparams.h>
+#include <coins.h>
+#include <index/blockfilterindex.h>
+#include <script/standard.h>
+#include <streams.h>
+#include <test/test_bitcoin.h>
+#include <undo.h>
+#include <utilstrencodings.h>
+#include <utiltime.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockfilter_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(gcsfilter_test)
+{
+    GCSFilter::ElementSet included_elements, excluded_elements;
+    for (int i = 0; i < 100; ++i) {
+        GCSFilter::Element element1(32);
+        element1[0] = i;
+        included_elements.insert(std::move(element1));
+
+        GCSFilter::Element element2(32);
+        element2[1] = i;
+        excluded_elements.insert(std::move(element2));
+    }
+
+    GCSFilter filter({0, 0, 10, 1 << 10}, included_elements);
+    for (const auto& element : included_elements) {
+        BOOST_CHECK(filter.Match(element));
+
+        auto insertion = excluded_elements.insert(element);
+        BOOST_CHECK(filter.MatchAny(excluded_elements));
+        excluded_elements.erase(insertion.first);
+    }
+
+    // A filter rebuilt from its encoding matches the same elements.
+    GCSFilter filter2(filter.GetParams(), filter.GetEncoded());
+    BOOST_CHECK_EQUAL(filter2.GetN(), 100U);
+    for (const auto& element : included_elements) {
+        BOOST_CHECK(filter2.Match(element));
+    }
+
+    // Encodings with missing or excess data are rejected.
+    std::vector<unsigned char> truncated(filter.GetEncoded().begin(), filter.GetEncoded().end() - 1);
+    BOOST_CHECK_THROW(GCSFilter(filter.GetParams(), truncated), std::ios_base::failure);
+    std::vector<unsigned char> padded(filter.GetEncoded());
+    padded.push_back(0);
+    BOOST_CHECK_THROW(GCSFilter(filter.GetParams(), padded), std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_CASE(gcsfilter_default_constructor)
+{
+    GCSFilter filter;
+    BOOST_CHECK_EQUAL(filter.GetN(), 0U);
+    BOOST_CHECK_EQUAL(filter.GetEncoded().size(), 1U);
+
+    const GCSFilter::Params& params = filter.GetParams();
+    BOOST_CHECK_EQUAL(params.m_siphash_k0, 0U);
+    BOOST_CHECK_EQUAL(params.m_siphash_k1, 0U);
+    BOOST_CHECK_EQUAL(params.m_P, 0);
+    BOOST_CHECK_EQUAL(params.m_M, 1U);
+}
+
+BOOST_AUTO_TEST_CASE(blockfilter_basic_test)
+{
+    CScript included_scripts[5], excluded_scripts[3];
+
+    // First two are outputs on a single transaction.
+    included_scripts[0] << std::vector<unsigned char>(0, 65) << OP_CHECKSIG;
+    included_scripts[1] << OP_DUP << OP_HASH160 << std::vector<unsigned char>(1, 20) << OP_EQUALVERIFY << OP_CHECKSIG;
+
+    // Third is an output on in a second transaction.
+    included_scripts[2] << OP_1 << std::vector<unsigned char>(2, 33) << OP_1 << OP_CHECKMULTISIG;
+
+    // Last two are spent by a single transaction.
+    included_scripts[3] << OP_0 << std::vector<unsigned char>(3, 32);
+    included_scripts[4] << OP_4 << OP_ADD << OP_8 << OP_EQUAL;
+
+    // OP_RETURN output is an output on the second transaction.
+    excluded_scripts[0] << OP_RETURN << std::vector<unsigned char>(4, 40);
+
+    // This script is not related to the block at all.
+    excluded_scripts[1] << std::vector<unsigned char>(5, 33) << OP_CHECKSIG;
+
+    // OP_RETURN is non-standard since it's not followed by a data push, but is still excluded from
+    // filter.
+    excluded_scripts[2] << OP_RETURN << OP_4 << OP_ADD << OP_8 << OP_EQUAL;
+
+    CMutableTransaction tx_1;
+    tx_1.vout.emplace_back(100, included_scripts[0]);
+    tx_1.vout.emplace_back(200, included_scripts[1]);
+    tx_1.vout.emplace_back(0, excluded_scripts[0]);
+
+    CMutableTransaction tx_2;
+    tx_2.vout.emplace_back(300, included_scripts[2]);
+    tx_2.vout.emplace_back(0, excluded_scripts[2]);
+    tx_2.vout.emplace_back(400, CScript()); // Empty script is excluded from the filter
+
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(tx_1));
+    block.vtx.push_back(MakeTransactionRef(tx_2));
+
+    CBlockUndo block_undo;
+    block_undo.vtxundo.emplace_back();
+    block_undo.vtxundo.back().vprevout.emplace_back(CTxOut(500, included_scripts[3]), 1000, true);
+    block_undo.vtxundo.back().vprevout.emplace_back(CTxOut(600, included_scripts[4]), 10000, false);
+    block_undo.vtxundo.back().vprevout.emplace_back(CTxOut(700, CScript()), 100000, false); // Empty script is excluded from the filter
+
+    BlockFilter block_filter(BlockFilterType::BASIC, block, block_undo);
+    const GCSFilter& filter = block_filter.GetFilter();
+
+    for (const CScript& script : included_scripts) {
+        BOOST_CHECK(filter.Match(GCSFilter::Element(script.begin(), script.end())));
+    }
+    for (const CScript& script : excluded_scripts) {
+        BOOST_CHECK(!filter.Match(GCSFilter::Element(script.begin(), script.end())));
+    }
+
+    // Test serialization/unserialization.
+    BlockFilter block_filter2;
+
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << block_filter;
+    stream >> block_filter2;
+
+    BOOST_CHECK(block_filter.GetFilterType() == block_filter2.GetFilterType());
+    BOOST_CHECK(block_filter.GetBlockHash() == block_filter2.GetBlockHash());
+    BOOST_CHECK(block_filter.GetEncodedFilter() == block_filter2.GetEncodedFilter());
+
+    // Reconstructing from parts gives the same filter.
+    BlockFilter block_filter3(BlockFilterType::BASIC, block.GetHash(), block_filter.GetEncodedFilter());
+    BOOST_CHECK(block_filter3.GetHash() == block_filter.GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(blockfilter_bip158_genesis)
+{
+    // Test vector from BIP 158 for the testnet genesis block, whose only
+    // output script is the pay-to-pubkey of the coinbase.
+    const auto testnet_params = CreateChainParams(CBaseChainParams::TESTNET);
+    const CBlock& genesis = testnet_params->GenesisBlock();
+    BOOST_REQUIRE_EQUAL(genesis.GetHash().GetHex(), "000000000933ea01ad0ee984209779baaec3ced90fa3f408719526f8d77f4943");
+
+    BlockFilter filter(BlockFilterType::BASIC, genesis, CBlockUndo());
+    BOOST_CHECK_EQUAL(HexStr(filter.GetEncodedFilter()), "019dfca8");
+    BOOST_CHECK_EQUAL(filter.ComputeHeader(uint256()).GetHex(),
+                      "21584579b7eb08997773e5aeff3a7f932700042d0ed2a6129012b7d7ae81b750");
+}
+
+BOOST_AUTO_TEST_CASE(blockfilter_type_names)
+{
+    BOOST_CHECK_EQUAL(BlockFilterTypeName(BlockFilterType::BASIC), "basic");
+    BOOST_CHECK_EQUAL(BlockFilterTypeName(static_cast<BlockFilterType>(255)), "");
+
+    BlockFilterType filter_type;
+    BOOST_CHECK(BlockFilterTypeByName("basic", filter_type));
+    BOOST_CHECK(filter_type == BlockFilterType::BASIC);
+
+    BOOST_CHECK(!BlockFilterTypeByName("unknown", filter_type));
+}
+
+BOOST_FIXTURE_TEST_CASE(blockfilter_index_initial_sync, TestChain100Setup)
+{
+    BlockFilterIndex filter_index(BlockFilterType::BASIC, 1 << 20, true);
+
+    BOOST_REQUIRE(filter_index.Start());
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!filter_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    const CScript coinbase_script = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const GCSFilter::Element coinbase_element(coinbase_script.begin(), coinbase_script.end());
+
+    // Every filter matches the coinbase script, and the headers chain up.
+    uint256 prev_header;
+    for (int height = 0; height <= chainActive.Height(); ++height) {
+        const CBlockIndex* pindex = chainActive[height];
+        BlockFilter filter;
+        uint256 header;
+        BOOST_REQUIRE(filter_index.LookupFilter(pindex, filter));
+        BOOST_REQUIRE(filter_index.LookupFilterHeader(pindex, header));
+        BOOST_CHECK(filter.GetBlockHash() == pindex->GetBlockHash());
+        BOOST_CHECK(header == filter.ComputeHeader(prev_header));
+        if (height > 0) BOOST_CHECK(filter.GetFilter().Match(coinbase_element));
+        prev_header = header;
+    }
+
+    std::vector<uint256> filter_hashes, filter_headers;
+    BOOST_REQUIRE(filter_index.LookupFilterHashRange(90, chainActive.Tip(), filter_hashes, filter_headers));
+    BOOST_REQUIRE_EQUAL(filter_headers.size(), 11U);
+    BOOST_CHECK(filter_headers.back() == prev_header);
+
+    // New blocks are indexed as they are connected.
+    CKey other_key;
+    other_key.MakeNewKey(true);
+    const CScript other_script = GetScriptForDestination(other_key.GetPubKey().GetID());
+    const CBlock block = CreateAndProcessBlock({}, other_script);
+    BOOST_REQUIRE(filter_index.BlockUntilSyncedToCurrentChain());
+
+    BlockFilter filter;
+    uint256 header;
+    BOOST_REQUIRE(filter_index.LookupFilter(chainActive.Tip(), filter));
+    BOOST_REQUIRE(filter_index.LookupFilterHeader(chainActive.Tip(), header));
+    BOOST_CHECK(filter.GetBlockHash() == block.GetHash());
+    BOOST_CHECK(header == filter.ComputeHeader(prev_header));
+    BOOST_CHECK(filter.GetFilter().Match(GCSFilter::Element(other_script.begin(), other_script.end())));
+
+    filter_index.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
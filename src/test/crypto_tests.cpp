@@ -4,6 +4,7 @@
 
 #include <crypto/aes.h>
 #include <crypto/chacha20.h>
+#include <crypto/muhash.h>
 #include <crypto/ripemd160.h>
 #include <crypto/sha1.h>
 #include <crypto/sha256.h>
@@ -11,6 +12,7 @@
 #include <crypto/hmac_sha256.h>
 #include <crypto/hmac_sha512.h>
 #include <random.h>
+#include <streams.h>
 #include <utilstrencodings.h>
 #include <test/test_bitcoin.h>
 
@@ -524,6 +526,63 @@ BOOST_AUTO_TEST_CASE(chacha20_testvector)
                  "fab78c9");
 }
 
+BOOST_AUTO_TEST_CASE(muhash_tests)
+{
+    // p - 1 is congruent to -1, so its square is one. Its product with
+    // itself exercises every carry and final reduction path.
+    Num3072 minus_one;
+    minus_one.limbs[0] = 0xFFFFFFFF - 1103717;
+    for (int i = 1; i < Num3072::LIMBS; ++i) minus_one.limbs[i] = 0xFFFFFFFF;
+    Num3072 square = minus_one;
+    square.Multiply(minus_one);
+    BOOST_CHECK(square.limbs[0] == 1);
+    for (int i = 1; i < Num3072::LIMBS; ++i) BOOST_CHECK(square.limbs[i] == 0);
+    Num3072 inverse = minus_one.GetInverse();
+    BOOST_CHECK(memcmp(inverse.limbs, minus_one.limbs, sizeof(inverse.limbs)) == 0);
+
+    // A random number times its inverse is one
+    Num3072 x;
+    for (int i = 0; i < Num3072::LIMBS; ++i) x.limbs[i] = InsecureRand32();
+    Num3072 one = x;
+    one.Divide(x);
+    BOOST_CHECK(one.limbs[0] == 1);
+    for (int i = 1; i < Num3072::LIMBS; ++i) BOOST_CHECK(one.limbs[i] == 0);
+
+    // The empty set hashes to the SHA256 of the number one
+    unsigned char out[32], expected[32];
+    unsigned char one_bytes[Num3072::BYTE_SIZE] = {1};
+    CSHA256().Write(one_bytes, sizeof(one_bytes)).Finalize(expected);
+    MuHash3072().Finalize(out);
+    BOOST_CHECK(memcmp(out, expected, 32) == 0);
+
+    // The hash only depends on the resulting multiset
+    const unsigned char a[] = {'a'}, b[] = {'b'}, c[] = {'c'};
+    unsigned char out2[32];
+    MuHash3072().Insert(a, 1).Insert(b, 1).Insert(c, 1).Remove(b, 1).Finalize(out);
+    MuHash3072().Remove(b, 1).Insert(c, 1).Insert(b, 1).Insert(a, 1).Finalize(out2);
+    BOOST_CHECK(memcmp(out, out2, 32) == 0);
+    MuHash3072().Insert(c, 1).Insert(a, 1).Finalize(out2);
+    BOOST_CHECK(memcmp(out, out2, 32) == 0);
+    MuHash3072().Insert(a, 1).Insert(a, 1).Insert(c, 1).Remove(a, 1).Finalize(out2);
+    BOOST_CHECK(memcmp(out, out2, 32) == 0);
+    MuHash3072().Insert(a, 1).Insert(b, 1).Finalize(out2);
+    BOOST_CHECK(memcmp(out, out2, 32) != 0);
+
+    // Combining sets, and a serialization round trip of the unfinalized state
+    MuHash3072 ac, bc;
+    ac.Insert(a, 1).Insert(c, 1);
+    bc.Insert(b, 1).Insert(c, 1);
+    ac *= bc;
+    ac /= MuHash3072().Insert(b, 1).Insert(c, 1);
+    CDataStream ss(SER_DISK, 0);
+    ss << ac;
+    BOOST_CHECK_EQUAL(ss.size(), 2 * Num3072::BYTE_SIZE);
+    MuHash3072 read;
+    ss >> read;
+    read.Finalize(out2);
+    BOOST_CHECK(memcmp(out, out2, 32) == 0);
+}
+
 BOOST_AUTO_TEST_CASE(countbits_tests)
 {
     FastRandomContext ctx;
@@ -377,4 +377,15 @@ BOOST_AUTO_TEST_CASE(cuckoocache_generations)
     test_cache_generations<CuckooCache::cache<uint256, SignatureCacheHasher>>();
 }
 
+BOOST_AUTO_TEST_CASE(sharded_signature_cache_ok)
+{
+    double HitRateThresh = 0.98;
+    size_t megabytes = 4;
+    for (double load = 0.1; load < 2; load *= 2) {
+        double hits = test_cache<ShardedSignatureCache<SIGNATURE_CACHE_SHARDS>>(megabytes, load);
+        BOOST_CHECK(normalize_hit_rate(hits, load) > HitRateThresh);
+    }
+    test_cache_erase<ShardedSignatureCache<SIGNATURE_CACHE_SHARDS>>(megabytes);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
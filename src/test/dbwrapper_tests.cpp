@@ -40,6 +40,126 @@ BOOST_AUTO_TEST_CASE(dbwrapper)
     }
 }
 
+// Test that tables written with one bloom filter setting read back under another
+BOOST_AUTO_TEST_CASE(dbwrapper_bloom_options)
+{
+    fs::path ph = fs::temp_directory_path() / fs::unique_path();
+    std::vector<uint256> keys;
+    for (int i = 0; i < 5000; i++) {
+        keys.push_back(InsecureRand256());
+    }
+
+    gArgs.ForceSetArg("-dbblocksize", "1024");
+    for (const char* bloom_bits : {"10", "0", "20"}) {
+        gArgs.ForceSetArg("-dbbloombits", bloom_bits);
+        // A small cache makes the writes spill into several tables on disk.
+        CDBWrapper dbw(ph, (1 << 16), false, false, true);
+        for (const uint256& key : keys) {
+            if (!dbw.Exists(key)) {
+                BOOST_CHECK(dbw.Write(key, key));
+            }
+        }
+        uint256 res;
+        for (const uint256& key : keys) {
+            BOOST_CHECK(dbw.Read(key, res));
+            BOOST_CHECK(res == key);
+        }
+        for (int i = 0; i < 1000; i++) {
+            BOOST_CHECK(!dbw.Exists(InsecureRand256()));
+        }
+    }
+    gArgs.ForceSetArg("-dbbloombits", std::to_string(DEFAULT_DB_BLOOM_BITS));
+    gArgs.ForceSetArg("-dbblocksize", std::to_string(DEFAULT_DB_BLOCK_SIZE));
+}
+
+// Test write statistics and background compaction
+BOOST_AUTO_TEST_CASE(dbwrapper_compact_if_idle)
+{
+    fs::path ph = fs::temp_directory_path() / fs::unique_path();
+    CDBWrapper dbw(ph, (1 << 20), true, false, false);
+    const auto never = [] { return false; };
+    auto level0_files = [&dbw] {
+        std::string value;
+        BOOST_REQUIRE(dbw.GetProperty("leveldb.num-files-at-level0", value));
+        return atoi(value);
+    };
+
+    // Nothing written yet, so there is nothing to compact
+    BOOST_CHECK(!dbw.CompactIfIdle(0, never, 1));
+
+    // Overwrite the same keys until flushes leave table files in level 0,
+    // which they do once the lower levels overlap them.
+    size_t written = 0;
+    for (int round = 0; round < 20 && level0_files() < 2; ++round) {
+        CDBBatch batch(dbw);
+        for (uint32_t i = 0; i < 10000; ++i) {
+            batch.Write(std::make_pair('c', i), InsecureRand256());
+        }
+        written += batch.SizeEstimate();
+        BOOST_CHECK(dbw.WriteBatch(batch));
+    }
+    BOOST_REQUIRE(level0_files() >= 2);
+
+    CDBWrapper::Stats stats = dbw.GetStats();
+    BOOST_CHECK_EQUAL(stats.written_bytes, written);
+    BOOST_CHECK_EQUAL(stats.written_since_compaction, written);
+    BOOST_CHECK(stats.max_write_time <= stats.write_time);
+
+    // Too few level 0 files, then not idle for long enough
+    BOOST_CHECK(!dbw.CompactIfIdle(0, never, 100));
+    BOOST_CHECK(!dbw.CompactIfIdle(1000000000, never, 1));
+    BOOST_CHECK_EQUAL(dbw.GetStats().compactions, 0U);
+
+    // Level 0 files span all keys written, so the first range drains them
+    BOOST_CHECK(dbw.CompactIfIdle(0, never, 1));
+    BOOST_CHECK_EQUAL(level0_files(), 0);
+    stats = dbw.GetStats();
+    BOOST_CHECK_EQUAL(stats.compactions, 1U);
+    BOOST_CHECK_EQUAL(stats.written_since_compaction, 0U);
+    BOOST_CHECK(stats.last_compaction > 0);
+    BOOST_CHECK(!dbw.CompactIfIdle(0, never, 1));
+
+    std::string value;
+    BOOST_CHECK(dbw.GetProperty("leveldb.stats", value));
+    BOOST_CHECK(dbw.GetProperty("leveldb.sstables", value));
+    BOOST_CHECK(!value.empty());
+    BOOST_CHECK(!dbw.GetProperty("leveldb.no-such-property", value));
+
+    uint256 res;
+    BOOST_CHECK(dbw.Read(std::make_pair('c', uint32_t(9999)), res));
+}
+
+// Test reads and iteration through a snapshot
+BOOST_AUTO_TEST_CASE(dbwrapper_snapshot)
+{
+    fs::path ph = fs::temp_directory_path() / fs::unique_path();
+    CDBWrapper dbw(ph, (1 << 20), true, false, true);
+
+    const uint256 in = InsecureRand256();
+    BOOST_CHECK(dbw.Write('a', in));
+    const CDBWrapper::Snapshot snapshot = dbw.GetSnapshot();
+
+    const uint256 in2 = InsecureRand256();
+    BOOST_CHECK(dbw.Write('a', in2));
+    BOOST_CHECK(dbw.Write('b', in2));
+
+    uint256 res;
+    BOOST_CHECK(dbw.Read('a', res, snapshot));
+    BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+    BOOST_CHECK(!dbw.Read('b', res, snapshot));
+    BOOST_CHECK(dbw.Read('a', res));
+    BOOST_CHECK_EQUAL(res.ToString(), in2.ToString());
+
+    std::unique_ptr<CDBIterator> it(dbw.NewIterator(snapshot));
+    it->Seek('a');
+    char key;
+    BOOST_CHECK(it->Valid() && it->GetKey(key) && key == 'a');
+    BOOST_CHECK(it->GetValue(res));
+    BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+    it->Next();
+    BOOST_CHECK(!it->Valid());
+}
+
 // Test batch operations
 BOOST_AUTO_TEST_CASE(dbwrapper_batch)
 {
@@ -571,4 +571,78 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolLinksTest)
+{
+    TestMemPoolEntryHelper entry;
+    CTxMemPool pool;
+
+    // Parent with two outputs, spent by two children; the second child also
+    // spends the first child.
+    CMutableTransaction txParent;
+    txParent.vin.resize(1);
+    txParent.vin[0].scriptSig = CScript() << OP_11;
+    txParent.vout.resize(2);
+    for (int i = 0; i < 2; i++) {
+        txParent.vout[i].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        txParent.vout[i].nValue = 10 * COIN;
+    }
+    CMutableTransaction txChild1;
+    txChild1.vin.resize(1);
+    txChild1.vin[0].prevout = COutPoint(txParent.GetHash(), 0);
+    txChild1.vout.resize(1);
+    txChild1.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txChild1.vout[0].nValue = 10 * COIN;
+    CMutableTransaction txChild2;
+    txChild2.vin.resize(2);
+    txChild2.vin[0].prevout = COutPoint(txParent.GetHash(), 1);
+    txChild2.vin[1].prevout = COutPoint(txChild1.GetHash(), 0);
+    txChild2.vout.resize(1);
+    txChild2.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txChild2.vout[0].nValue = 20 * COIN;
+
+    BOOST_CHECK_EQUAL(pool.GetMemoryUsageBreakdown().Total(), pool.DynamicMemoryUsage());
+    pool.addUnchecked(txParent.GetHash(), entry.FromTx(txParent));
+    pool.addUnchecked(txChild1.GetHash(), entry.FromTx(txChild1));
+    pool.addUnchecked(txChild2.GetHash(), entry.FromTx(txChild2));
+    BOOST_CHECK_EQUAL(pool.GetMemoryUsageBreakdown().Total(), pool.DynamicMemoryUsage());
+
+    CTxMemPool::txiter parent = pool.mapTx.find(txParent.GetHash());
+    CTxMemPool::txiter child1 = pool.mapTx.find(txChild1.GetHash());
+    CTxMemPool::txiter child2 = pool.mapTx.find(txChild2.GetHash());
+    BOOST_CHECK_EQUAL(pool.GetMemPoolParents(parent).size(), 0);
+    BOOST_CHECK_EQUAL(pool.GetMemPoolChildren(parent).size(), 2);
+    BOOST_CHECK_EQUAL(pool.GetMemPoolParents(child1).size(), 1);
+    BOOST_CHECK_EQUAL(pool.GetMemPoolChildren(child1).size(), 1);
+    BOOST_CHECK_EQUAL(pool.GetMemPoolParents(child2).size(), 2);
+    BOOST_CHECK_EQUAL(child2->GetCountWithAncestors(), 3);
+    BOOST_CHECK_EQUAL(parent->vTxHashesIdx, 0U);
+    BOOST_CHECK_EQUAL(child2->vTxHashesIdx, 2U);
+
+    // Confirming the parent must unlink it from both children, and the
+    // vTxHashes slot it frees is reused by the last entry.
+    std::vector<CTransactionRef> block;
+    block.push_back(MakeTransactionRef(txParent));
+    pool.removeForBlock(block, 1);
+    BOOST_CHECK_EQUAL(pool.size(), 2);
+    child1 = pool.mapTx.find(txChild1.GetHash());
+    child2 = pool.mapTx.find(txChild2.GetHash());
+    BOOST_CHECK_EQUAL(pool.GetMemPoolParents(child1).size(), 0);
+    BOOST_CHECK_EQUAL(pool.GetMemPoolChildren(child1).size(), 1);
+    BOOST_CHECK(pool.GetMemPoolChildren(child1)[0] == &*child2);
+    BOOST_CHECK_EQUAL(pool.GetMemPoolParents(child2).size(), 1);
+    BOOST_CHECK(pool.GetMemPoolParents(child2)[0] == &*child1);
+    BOOST_CHECK_EQUAL(child2->GetCountWithAncestors(), 2);
+    BOOST_CHECK_EQUAL(pool.vTxHashes.size(), 2U);
+    BOOST_CHECK_EQUAL(child2->vTxHashesIdx, 0U);
+    BOOST_CHECK(pool.vTxHashes[0].first == CTransaction(txChild2).GetWitnessHash());
+    BOOST_CHECK(pool.vTxHashes[0].second == child2);
+    BOOST_CHECK_EQUAL(child1->vTxHashesIdx, 1U);
+    BOOST_CHECK(pool.vTxHashes[1].second == child1);
+    BOOST_CHECK_EQUAL(pool.GetMemoryUsageBreakdown().Total(), pool.DynamicMemoryUsage());
+
+    pool.removeRecursive(txChild1);
+    BOOST_CHECK_EQUAL(pool.size(), 0);
+    BOOST_CHECK_EQUAL(pool.DynamicMemoryUsage(), pool.GetMemoryUsageBreakdown().Total());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
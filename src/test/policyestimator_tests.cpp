@@ -2,8 +2,11 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <clientversion.h>
+#include <fs.h>
 #include <policy/policy.h>
 #include <policy/fees.h>
+#include <streams.h>
 #include <txmempool.h>
 #include <uint256.h>
 #include <util.h>
@@ -179,4 +182,59 @@ BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
     }
 }
 
+BOOST_AUTO_TEST_CASE(BlockPolicyEstimatesLazyDecay)
+{
+    CBlockPolicyEstimator feeEst;
+    CTxMemPool mpool(&feeEst);
+    TestMemPoolEntryHelper entry;
+
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vout.resize(1);
+    tx.vout[0].nValue=0LL;
+
+    // Run long enough for the short horizon decay to be folded back into its
+    // averages at least once.
+    std::vector<CTransactionRef> block;
+    int blocknum = 0;
+    while (blocknum < 1300) {
+        for (int j = 0; j < 10; j++) {
+            tx.vin[0].prevout.n = 100*blocknum+j;
+            uint256 hash = tx.GetHash();
+            mpool.addUnchecked(hash, entry.Fee(1000 * (j+1)).Time(GetTime()).Height(blocknum).FromTx(tx));
+            // Confirm the higher feerate half in the next block
+            if (j >= 5) block.push_back(mpool.get(hash));
+        }
+        mpool.removeForBlock(block, ++blocknum);
+        block.clear();
+    }
+
+    // Repeated estimates are served from the cache and must not change.
+    FeeCalculation feeCalc1, feeCalc2;
+    CFeeRate estimate = feeEst.estimateSmartFee(2, &feeCalc1, false);
+    BOOST_CHECK(estimate != CFeeRate(0));
+    BOOST_CHECK(feeEst.estimateSmartFee(2, &feeCalc2, false) == estimate);
+    BOOST_CHECK(feeCalc1.reason == feeCalc2.reason);
+    BOOST_CHECK_EQUAL(feeCalc1.returnedTarget, feeCalc2.returnedTarget);
+
+    // The saved averages include the pending decay, so a reloaded estimator
+    // gives the same answers.
+    const fs::path path = fs::temp_directory_path() / fs::unique_path("fee_estimates_%%%%%%%%.dat");
+    {
+        CAutoFile fileout(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        BOOST_CHECK(feeEst.Write(fileout));
+    }
+    CBlockPolicyEstimator feeEstRead;
+    {
+        CAutoFile filein(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+        BOOST_CHECK(feeEstRead.Read(filein));
+    }
+    fs::remove(path);
+    for (FeeEstimateHorizon horizon : {FeeEstimateHorizon::SHORT_HALFLIFE, FeeEstimateHorizon::MED_HALFLIFE, FeeEstimateHorizon::LONG_HALFLIFE}) {
+        for (unsigned int i = 1; i <= feeEst.HighestTargetTracked(horizon); i++) {
+            BOOST_CHECK(feeEst.estimateRawFee(i, 0.85, horizon) == feeEstRead.estimateRawFee(i, 0.85, horizon));
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -264,4 +264,59 @@ BOOST_AUTO_TEST_CASE(PrevectorTestInt)
     }
 }
 
+BOOST_AUTO_TEST_CASE(PrevectorExternalStorage)
+{
+    std::vector<unsigned char> storage(40);
+    for (size_t i = 0; i < storage.size(); ++i) {
+        storage[i] = i;
+    }
+    const std::vector<unsigned char> original(storage);
+
+    prevector<28, unsigned char> v;
+    v.push_back(1);
+    v.assign_external(storage.data(), storage.size());
+    BOOST_CHECK_EQUAL(v.size(), 40U);
+    BOOST_CHECK(v.data() == storage.data());
+    BOOST_CHECK_EQUAL(v.allocated_memory(), 40U);
+
+    // Copies get storage of their own, moves keep referring to the original.
+    prevector<28, unsigned char> copy(v);
+    BOOST_CHECK(copy == v);
+    BOOST_CHECK(copy.data() != storage.data());
+    prevector<28, unsigned char> moved(std::move(v));
+    BOOST_CHECK(moved.data() == storage.data());
+
+    // Elements are modified in place, and erasing does not need more room...
+    moved[0] = 100;
+    BOOST_CHECK_EQUAL(storage[0], 100);
+    moved.erase(moved.begin() + 30, moved.end());
+    BOOST_CHECK(moved.data() == storage.data());
+    BOOST_CHECK_EQUAL(moved.size(), 30U);
+
+    // ...but growing copies the elements out first.
+    moved.push_back(200);
+    BOOST_CHECK(moved.data() != storage.data());
+    BOOST_CHECK_EQUAL(moved.size(), 31U);
+    BOOST_CHECK_EQUAL(moved[0], 100);
+    BOOST_CHECK_EQUAL(moved[30], 200);
+    BOOST_CHECK_EQUAL(storage[30], 30);
+
+    // So does switching to direct storage.
+    storage = original;
+    prevector<28, unsigned char> small;
+    small.assign_external(storage.data(), storage.size());
+    small.erase(small.begin() + 10, small.end());
+    small.shrink_to_fit();
+    BOOST_CHECK(small.data() != storage.data());
+    BOOST_CHECK(std::equal(small.begin(), small.end(), original.begin()));
+
+    // Assigning replaces the reference to the external storage.
+    prevector<28, unsigned char> assigned;
+    assigned.assign_external(storage.data(), storage.size());
+    assigned = copy;
+    BOOST_CHECK(assigned == copy);
+    BOOST_CHECK(assigned.data() != storage.data());
+    BOOST_CHECK(storage == original);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
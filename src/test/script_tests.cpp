@@ -5,6 +5,7 @@
 #include <test/data/script_tests.json.h>
 
 #include <core_io.h>
+#include <crypto/sha256.h>
 #include <key.h>
 #include <keystore.h>
 #include <script/script.h>
@@ -1479,4 +1480,217 @@ BOOST_AUTO_TEST_CASE(script_can_append_self)
     BOOST_CHECK(s == d);
 }
 
+BOOST_AUTO_TEST_CASE(script_IsPayToPubKeyHash)
+{
+    const CScript p2pkh = GetScriptForDestination(CKeyID(uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"))));
+    BOOST_CHECK(p2pkh.IsPayToPubKeyHash());
+
+    // Any other opcode, push size or script length is not the template.
+    for (size_t i : {0, 1, 2, 23, 24}) {
+        CScript modified = p2pkh;
+        modified[i] = OP_NOP;
+        BOOST_CHECK(!modified.IsPayToPubKeyHash());
+    }
+    BOOST_CHECK(!CScript(p2pkh.begin(), p2pkh.end() - 1).IsPayToPubKeyHash());
+    BOOST_CHECK(!(CScript(p2pkh) << OP_NOP).IsPayToPubKeyHash());
+    BOOST_CHECK(!((CScript() << OP_CODESEPARATOR) + p2pkh).IsPayToPubKeyHash());
+    BOOST_CHECK(!(CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(21, 1) << OP_EQUALVERIFY << OP_CHECKSIG).IsPayToPubKeyHash());
+}
+
+typedef std::vector<unsigned char> valtype;
+
+enum class PayToPubKeyHashSpend { BARE, P2SH, WITNESS, P2SH_WITNESS };
+
+/**
+ * Verify a spend of a pay-to-pubkey-hash script, which EvalScript evaluates
+ * without its generic loop, against the same spend of that script preceded by
+ * OP_CODESEPARATOR, which goes through the generic loop. Both sign the same
+ * script code, so the outcome and error must be identical. For witness spends
+ * the reference is the P2WSH equivalent of the P2WPKH program.
+ */
+static void CheckPayToPubKeyHashSpend(const CScript& p2pkh, PayToPubKeyHashSpend spend, const std::vector<valtype>& items, unsigned int flags, const BaseSignatureChecker& checker)
+{
+    const CScript reference = (CScript() << OP_CODESEPARATOR) + p2pkh;
+    BOOST_REQUIRE(p2pkh.IsPayToPubKeyHash() && !reference.IsPayToPubKeyHash());
+
+    CScript script_sig, reference_script_sig, script_pubkey, reference_script_pubkey;
+    CScriptWitness witness, reference_witness;
+    if (spend == PayToPubKeyHashSpend::BARE || spend == PayToPubKeyHashSpend::P2SH) {
+        for (const valtype& item : items) {
+            script_sig << item;
+        }
+        reference_script_sig = script_sig;
+        if (spend == PayToPubKeyHashSpend::BARE) {
+            script_pubkey = p2pkh;
+            reference_script_pubkey = reference;
+        } else {
+            script_sig << ToByteVector(p2pkh);
+            reference_script_sig << ToByteVector(reference);
+            script_pubkey = GetScriptForDestination(CScriptID(p2pkh));
+            reference_script_pubkey = GetScriptForDestination(CScriptID(reference));
+        }
+    } else {
+        witness.stack = items;
+        reference_witness.stack = items;
+        reference_witness.stack.push_back(ToByteVector(reference));
+        CScript program = CScript() << OP_0 << valtype(p2pkh.begin() + 3, p2pkh.begin() + 23);
+        uint256 reference_hash;
+        CSHA256().Write(reference.data(), reference.size()).Finalize(reference_hash.begin());
+        CScript reference_program = CScript() << OP_0 << ToByteVector(reference_hash);
+        if (spend == PayToPubKeyHashSpend::WITNESS) {
+            script_pubkey = program;
+            reference_script_pubkey = reference_program;
+        } else {
+            script_sig << ToByteVector(program);
+            reference_script_sig << ToByteVector(reference_program);
+            script_pubkey = GetScriptForDestination(CScriptID(program));
+            reference_script_pubkey = GetScriptForDestination(CScriptID(reference_program));
+        }
+    }
+
+    ScriptError err, reference_err;
+    bool result = VerifyScript(script_sig, script_pubkey, &witness, flags, checker, &err);
+    bool reference_result = VerifyScript(reference_script_sig, reference_script_pubkey, &reference_witness, flags, checker, &reference_err);
+    BOOST_CHECK_MESSAGE(result == reference_result && err == reference_err,
+        strprintf("spend %d flags %08x: %s (%s) vs %s (%s)", static_cast<int>(spend), flags,
+            result, ScriptErrorString(err), reference_result, ScriptErrorString(reference_err)));
+}
+
+BOOST_AUTO_TEST_CASE(script_p2pkh_shortcut_matches_interpreter)
+{
+    for (bool compressed : {true, false}) {
+        CKey key, other_key;
+        key.MakeNewKey(compressed);
+        other_key.MakeNewKey(!compressed);
+        const CPubKey pubkey = key.GetPubKey();
+        const CScript p2pkh = GetScriptForDestination(pubkey.GetID());
+        const CAmount amount = 1000;
+
+        CMutableTransaction tx = BuildSpendingTransaction(CScript(), CScriptWitness(), BuildCreditingTransaction(p2pkh, amount));
+        const MutableTransactionSignatureChecker checker(&tx, 0, amount);
+
+        // Stack items to build spends from: good and bad signatures for
+        // either signature version, matching and mismatching public keys,
+        // and some odd sizes.
+        std::vector<valtype> items;
+        for (SigVersion sigversion : {SIGVERSION_BASE, SIGVERSION_WITNESS_V0}) {
+            for (int hash_type : {int{SIGHASH_ALL}, SIGHASH_NONE | SIGHASH_ANYONECANPAY}) {
+                valtype sig;
+                BOOST_REQUIRE(key.Sign(SignatureHash(p2pkh, tx, 0, hash_type, amount, sigversion), sig));
+                sig.push_back(hash_type);
+                items.push_back(sig);
+                sig.back() = 0;
+                items.push_back(sig);
+                sig[10] ^= 1;
+                sig.back() = hash_type;
+                items.push_back(sig);
+            }
+        }
+        items.push_back(ToByteVector(pubkey));
+        items.push_back(ToByteVector(other_key.GetPubKey()));
+        items.push_back(valtype());
+        items.push_back(valtype(1, 1));
+        items.push_back(valtype{0x30, 0x01, SIGHASH_ALL});
+        items.push_back(valtype(MAX_SCRIPT_ELEMENT_SIZE + 1, 0));
+
+        const std::vector<PayToPubKeyHashSpend> spends{PayToPubKeyHashSpend::BARE, PayToPubKeyHashSpend::P2SH, PayToPubKeyHashSpend::WITNESS, PayToPubKeyHashSpend::P2SH_WITNESS};
+        for (int i = 0; i < 1000; ++i) {
+            unsigned int flags = InsecureRandBits(16);
+            if (flags & SCRIPT_VERIFY_WITNESS) flags |= SCRIPT_VERIFY_P2SH;
+            if (flags & SCRIPT_VERIFY_CLEANSTACK) flags |= SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS;
+
+            const PayToPubKeyHashSpend spend = spends[InsecureRandRange(spends.size())];
+            // Witness programs only run the script for a two item witness;
+            // P2WPKH rejects any other count before getting that far.
+            const size_t num_items = spend == PayToPubKeyHashSpend::BARE || spend == PayToPubKeyHashSpend::P2SH ? InsecureRandRange(5) : 2;
+            std::vector<valtype> stack;
+            for (size_t j = 0; j < num_items; ++j) {
+                stack.push_back(items[InsecureRandRange(items.size())]);
+            }
+            // Mostly pair up a signature with the right public key.
+            if (num_items >= 2 && InsecureRandBool()) stack.back() = ToByteVector(pubkey);
+            CheckPayToPubKeyHashSpend(p2pkh, spend, stack, flags, checker);
+        }
+
+        // Stacks at the size limit, with the script pushing two more items.
+        for (size_t num_items : {997, 998, 999, 1000}) {
+            std::vector<valtype> stack(num_items - 2, valtype(1, 1));
+            stack.push_back(items[0]);
+            stack.push_back(ToByteVector(pubkey));
+            CheckPayToPubKeyHashSpend(p2pkh, PayToPubKeyHashSpend::BARE, stack, SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC, checker);
+            CheckPayToPubKeyHashSpend(p2pkh, PayToPubKeyHashSpend::P2SH, stack, SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC, checker);
+        }
+    }
+}
+
+#if defined(HAVE_CONSENSUS_LIB)
+BOOST_AUTO_TEST_CASE(bitcoinconsensus_verify_transaction_batch)
+{
+    CBasicKeyStore keystore;
+    CKey key;
+    key.MakeNewKey(true);
+    BOOST_REQUIRE(keystore.AddKey(key));
+    const CScript p2pkh = GetScriptForDestination(key.GetPubKey().GetID());
+    const CScript p2wpkh = GetScriptForWitness(p2pkh);
+    BOOST_REQUIRE(keystore.AddCScript(p2wpkh));
+    const std::vector<CScript> templates{p2pkh, p2wpkh, GetScriptForDestination(CScriptID(p2wpkh))};
+
+    // Spend three outputs of each type in one transaction.
+    CMutableTransaction tx;
+    std::vector<CTxOut> spent;
+    for (unsigned int i = 0; i < 9; ++i) {
+        tx.vin.emplace_back(COutPoint(InsecureRand256(), i));
+        spent.emplace_back(1000 * (i + 1), templates[i % templates.size()]);
+    }
+    tx.vout.emplace_back(1000, p2pkh);
+    for (unsigned int i = 0; i < tx.vin.size(); ++i) {
+        BOOST_REQUIRE(SignSignature(keystore, spent[i].scriptPubKey, tx, i, spent[i].nValue, SIGHASH_ALL));
+    }
+
+    std::vector<bitcoinconsensus_spent_output> spent_outputs;
+    for (const CTxOut& out : spent) {
+        spent_outputs.push_back({out.scriptPubKey.data(), static_cast<unsigned int>(out.scriptPubKey.size()), out.nValue});
+    }
+    const unsigned int flags = bitcoinconsensus_SCRIPT_FLAGS_VERIFY_ALL;
+
+    // Every input verifies, and gives the same result as verifying it alone.
+    auto check_batch = [&](const CMutableTransaction& tx_to, int expected, unsigned int invalid_input) {
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        stream << tx_to;
+        // More threads than inputs, or than the library uses, are capped.
+        for (unsigned int threads : {0U, 1U, 4U, 1000000U}) {
+            std::vector<int> results(tx_to.vin.size(), -1);
+            bitcoinconsensus_error err;
+            BOOST_CHECK_EQUAL(bitcoinconsensus_verify_transaction((const unsigned char*)stream.data(), stream.size(), spent_outputs.data(), spent_outputs.size(), flags, threads, results.data(), &err), expected);
+            BOOST_CHECK_EQUAL(err, bitcoinconsensus_ERR_OK);
+            for (unsigned int i = 0; i < tx_to.vin.size(); ++i) {
+                BOOST_CHECK_EQUAL(results[i], i == invalid_input ? 0 : 1);
+                BOOST_CHECK_EQUAL(results[i], bitcoinconsensus_verify_script_with_amount(spent_outputs[i].scriptPubKey, spent_outputs[i].scriptPubKeyLen, spent_outputs[i].amount, (const unsigned char*)stream.data(), stream.size(), i, flags, nullptr));
+            }
+        }
+    };
+    check_batch(tx, 1, tx.vin.size());
+
+    // A bad signature on one witness input fails only that input.
+    CMutableTransaction tx_invalid(tx);
+    tx_invalid.vin[4].scriptWitness.stack[0][10] ^= 1;
+    check_batch(tx_invalid, 0, 4);
+
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << tx;
+    bitcoinconsensus_error err;
+    BOOST_CHECK_EQUAL(bitcoinconsensus_verify_transaction((const unsigned char*)stream.data(), stream.size(), spent_outputs.data(), spent_outputs.size() - 1, flags, 1, nullptr, &err), 0);
+    BOOST_CHECK_EQUAL(err, bitcoinconsensus_ERR_SPENT_OUTPUTS_MISMATCH);
+    BOOST_CHECK_EQUAL(bitcoinconsensus_verify_transaction((const unsigned char*)stream.data(), stream.size(), nullptr, spent_outputs.size(), flags, 1, nullptr, &err), 0);
+    BOOST_CHECK_EQUAL(err, bitcoinconsensus_ERR_SPENT_OUTPUTS_MISMATCH);
+    BOOST_CHECK_EQUAL(bitcoinconsensus_verify_transaction((const unsigned char*)stream.data(), stream.size(), spent_outputs.data(), spent_outputs.size(), flags | SCRIPT_VERIFY_STRICTENC, 1, nullptr, &err), 0);
+    BOOST_CHECK_EQUAL(err, bitcoinconsensus_ERR_INVALID_FLAGS);
+    BOOST_CHECK_EQUAL(bitcoinconsensus_verify_transaction((const unsigned char*)stream.data(), stream.size() - 1, spent_outputs.data(), spent_outputs.size(), flags, 1, nullptr, &err), 0);
+    BOOST_CHECK_EQUAL(err, bitcoinconsensus_ERR_TX_DESERIALIZE);
+    stream << uint8_t{0};
+    BOOST_CHECK_EQUAL(bitcoinconsensus_verify_transaction((const unsigned char*)stream.data(), stream.size(), spent_outputs.data(), spent_outputs.size(), flags, 1, nullptr, &err), 0);
+    BOOST_CHECK_EQUAL(err, bitcoinconsensus_ERR_TX_SIZE_MISMATCH);
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
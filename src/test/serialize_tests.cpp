@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <primitives/block.h>
 #include <serialize.h>
 #include <streams.h>
 #include <hash.h>
@@ -88,6 +89,32 @@ BOOST_AUTO_TEST_CASE(sizes)
     BOOST_CHECK_EQUAL(GetSerializeSize(bool(0), 0), 1);
 }
 
+template <typename T>
+static void CheckContainerSize(const T& obj)
+{
+    CDataStream ss(SER_DISK, 0);
+    ss << obj;
+    BOOST_CHECK_EQUAL(GetSerializeSize(obj, SER_DISK, 0), ss.size());
+}
+
+BOOST_AUTO_TEST_CASE(container_sizes)
+{
+    // Containers of fixed size types are counted without visiting their
+    // elements; this must agree with actually serializing them.
+    for (size_t len : {0, 1, 252, 253, 70000}) {
+        CheckContainerSize(std::vector<unsigned char>(len, 1));
+        CheckContainerSize(std::vector<char>(len, 1));
+        CheckContainerSize(std::vector<uint16_t>(len, 1));
+        CheckContainerSize(std::vector<int32_t>(len, 1));
+        CheckContainerSize(std::vector<uint64_t>(len, 1));
+        CheckContainerSize(std::vector<double>(len, 1));
+        CheckContainerSize(prevector<28, unsigned char>(len, 1));
+        CheckContainerSize(prevector<8, int64_t>(len, 1));
+        CheckContainerSize(std::vector<std::vector<uint32_t>>(len % 300, std::vector<uint32_t>(len % 7, 1)));
+        CheckContainerSize(std::vector<std::string>(len % 300, "abc"));
+    }
+}
+
 BOOST_AUTO_TEST_CASE(floats_conversion)
 {
     // Choose values that map unambiguously to binary floating point to avoid
@@ -365,4 +392,112 @@ BOOST_AUTO_TEST_CASE(class_methods)
     BOOST_CHECK(methodtest3 == methodtest4);
 }
 
+BOOST_AUTO_TEST_CASE(block_transactions_in_arena)
+{
+    // Scripts that fit in a CScript, that go in the arena and that are too
+    // large for it.
+    auto make_script = [](size_t size, opcodetype op) {
+        const std::vector<unsigned char> bytes(size, op);
+        return CScript(bytes.begin(), bytes.end());
+    };
+    CBlock block;
+    for (size_t script_size : {10, 29, 500, 20000}) {
+        CMutableTransaction mtx;
+        mtx.vin.resize(2);
+        mtx.vin[0].scriptSig = make_script(script_size, OP_1);
+        mtx.vin[1].scriptWitness.stack.emplace_back(script_size, 1);
+        mtx.vout.emplace_back(script_size, make_script(script_size, OP_2));
+        block.vtx.push_back(MakeTransactionRef(std::move(mtx)));
+    }
+    // And one without witnesses, whose txid covers all of its bytes.
+    CMutableTransaction no_witness;
+    no_witness.vin.resize(1);
+    no_witness.vin[0].scriptSig = make_script(100, OP_1);
+    no_witness.vout.emplace_back(1, make_script(25, OP_2));
+    block.vtx.push_back(MakeTransactionRef(std::move(no_witness)));
+
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << block;
+    const std::string serialized = stream.str();
+    CBlock block2;
+    stream >> block2;
+    BOOST_CHECK(stream.empty());
+    BOOST_REQUIRE_EQUAL(block2.vtx.size(), block.vtx.size());
+    for (size_t i = 0; i < block.vtx.size(); ++i) {
+        BOOST_CHECK(block2.vtx[i]->GetHash() == block.vtx[i]->GetHash());
+        BOOST_CHECK(block2.vtx[i]->GetWitnessHash() == block.vtx[i]->GetWitnessHash());
+        BOOST_CHECK_EQUAL(block2.vtx[i]->GetTotalSize(), block.vtx[i]->GetTotalSize());
+        BOOST_CHECK_EQUAL(GetSerializeSize(*block2.vtx[i], SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS),
+                          GetSerializeSize(*block.vtx[i], SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS));
+    }
+    // Scripts in the arena count towards memory usage all the same.
+    BOOST_CHECK_EQUAL(block2.vtx[0]->vin[0].scriptSig.allocated_memory(), 0U);
+    BOOST_CHECK_EQUAL(block2.vtx[2]->vin[0].scriptSig.allocated_memory(), 500U);
+    BOOST_CHECK_GE(block2.vtx[3]->vin[0].scriptSig.allocated_memory(), 20000U);
+
+    // Transactions keep working after the block is gone, and so do copies.
+    CTransactionRef tx = block2.vtx[2];
+    CTransactionRef tx_copy = MakeTransactionRef(*tx);
+    BOOST_CHECK_GE(tx_copy->vout[0].scriptPubKey.allocated_memory(), 500U);
+    block2.SetNull();
+    BOOST_CHECK(tx->vout[0].scriptPubKey == make_script(500, OP_2));
+    BOOST_CHECK(tx->vin[1].scriptWitness.stack[0] == std::vector<unsigned char>(500, 1));
+    BOOST_CHECK(*tx == *block.vtx[2]);
+    BOOST_CHECK(*tx_copy == *block.vtx[2]);
+
+    // Reading a block again replaces its transactions.
+    stream << block;
+    stream >> block2;
+    stream << block2;
+    BOOST_CHECK(stream.str() == serialized);
+
+    // Truncated data is rejected.
+    stream.clear();
+    stream.write(serialized.data(), serialized.size() - 1);
+    BOOST_CHECK_THROW(stream >> block2, std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_CASE(block_transactions_in_arena_hash)
+{
+    CMutableTransaction mtx;
+    mtx.vin.resize(2);
+    mtx.vin[0].scriptSig = CScript() << OP_1;
+    mtx.vout.emplace_back(1, CScript() << OP_2);
+    const CTransaction tx(mtx);
+
+    // The extended format with an empty witness for every input is accepted,
+    // but the transaction is serialized again without them.
+    CDataStream stripped(SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS);
+    stripped << tx;
+    std::string extended = stripped.str();
+    extended.insert(extended.size() - 4, std::string(tx.vin.size(), '\0'));
+    extended.insert(4, std::string("\0\1", 2));
+
+    CBlock block;
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << static_cast<const CBlockHeader&>(block);
+    WriteCompactSize(stream, 2);
+    stream.write(extended.data(), extended.size());
+    stream.write(stripped.str().data(), stripped.size());
+    stream >> block;
+    BOOST_REQUIRE_EQUAL(block.vtx.size(), 2U);
+    for (const CTransactionRef& block_tx : block.vtx) {
+        BOOST_CHECK(block_tx->GetHash() == tx.GetHash());
+        BOOST_CHECK_EQUAL(block_tx->GetTotalSize(), tx.GetTotalSize());
+    }
+
+    // Without witnesses allowed, an empty vin is not taken for the dummy.
+    CBlock block2;
+    mtx.vin.clear();
+    mtx.vout.resize(2);
+    block2.vtx.push_back(MakeTransactionRef(mtx));
+    CDataStream stream2(SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS);
+    stream2 << block2;
+    CBlock block3;
+    stream2 >> block3;
+    BOOST_REQUIRE_EQUAL(block3.vtx.size(), 1U);
+    BOOST_CHECK(block3.vtx[0]->GetHash() == block2.vtx[0]->GetHash());
+    BOOST_CHECK_EQUAL(block3.vtx[0]->GetTotalSize(), block2.vtx[0]->GetTotalSize());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -161,6 +161,34 @@ BOOST_AUTO_TEST_CASE(sighash_test)
     #endif
 }
 
+BOOST_AUTO_TEST_CASE(sighash_legacy_cache)
+{
+    SeedInsecureRand(false);
+
+    for (int i = 0; i < 20; i++) {
+        CMutableTransaction txTo;
+        RandomTransaction(txTo, false);
+        // Enough inputs with a scriptSig for the midstates to be cached.
+        txTo.vin.resize(16 + InsecureRandRange(16));
+        for (CTxIn& txin : txTo.vin) {
+            txin.prevout.hash = InsecureRand256();
+            txin.scriptSig = CScript() << OP_1;
+        }
+        const CTransaction tx(txTo);
+        const PrecomputedTransactionData txdata(tx);
+        BOOST_CHECK_EQUAL(txdata.m_legacy_midstates.size(), tx.vin.size());
+
+        for (unsigned int nIn = 0; nIn < tx.vin.size(); nIn++) {
+            int nHashType = InsecureRand32();
+            if (InsecureRandBool()) nHashType = SIGHASH_ALL;
+            CScript scriptCode;
+            RandomScript(scriptCode);
+            BOOST_CHECK(SignatureHash(scriptCode, tx, nIn, nHashType, 0, SIGVERSION_BASE, &txdata) ==
+                        SignatureHashOld(scriptCode, tx, nIn, nHashType));
+        }
+    }
+}
+
 // Goal: check that SignatureHash generates correct hash
 BOOST_AUTO_TEST_CASE(sighash_from_data)
 {
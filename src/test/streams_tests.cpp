@@ -120,4 +120,85 @@ BOOST_AUTO_TEST_CASE(streams_serializedata_xor)
             std::string(ds.begin(), ds.end()));  
 }         
 
+BOOST_AUTO_TEST_CASE(streams_xor_with_key)
+{
+    // Compare the word-at-a-time XOR against a plain byte loop for key sizes
+    // that do and do not divide the word size, all key offsets, and lengths
+    // around the word boundaries.
+    for (size_t key_size = 1; key_size <= 9; ++key_size) {
+        std::vector<unsigned char> key(key_size);
+        for (unsigned char& c : key) c = InsecureRandBits(8);
+        for (size_t offset = 0; offset < key_size + 2; ++offset) {
+            for (size_t size = 0; size <= 41; ++size) {
+                std::vector<unsigned char> data(size);
+                for (unsigned char& c : data) c = InsecureRandBits(8);
+                std::vector<unsigned char> expected(data);
+                for (size_t i = 0; i < size; ++i) {
+                    expected[i] ^= key[(offset + i) % key_size];
+                }
+                XorWithKey(data.data(), data.size(), key.data(), key.size(), offset);
+                BOOST_CHECK(data == expected);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(streams_span_reader)
+{
+    std::vector<unsigned char> vch = {1, 255, 3, 4, 5, 6};
+
+    SpanReader reader(SER_NETWORK, INIT_PROTO_VERSION, vch, 0);
+    BOOST_CHECK_EQUAL(reader.size(), 6U);
+    BOOST_CHECK(!reader.empty());
+
+    // Read a single byte as an unsigned char then a signed char.
+    unsigned char a;
+    reader >> a;
+    BOOST_CHECK_EQUAL(a, 1);
+    BOOST_CHECK_EQUAL(reader.size(), 5U);
+    signed char b;
+    reader >> b;
+    BOOST_CHECK_EQUAL(b, -1);
+
+    // Skip a byte, then read the rest as a little endian uint16_t.
+    reader.ignore(1);
+    uint16_t c;
+    reader >> c;
+    BOOST_CHECK_EQUAL(c, 0x0504);
+    BOOST_CHECK_EQUAL(reader.size(), 1U);
+    BOOST_CHECK_THROW(reader >> c, std::ios_base::failure);
+    BOOST_CHECK_THROW(reader.ignore(2), std::ios_base::failure);
+    reader >> a;
+    BOOST_CHECK_EQUAL(a, 6);
+    BOOST_CHECK(reader.empty());
+
+    // Starting positions past the end are rejected.
+    BOOST_CHECK_THROW(SpanReader(SER_NETWORK, INIT_PROTO_VERSION, vch, 7), std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_CASE(streams_span_reader_xor)
+{
+    // Reading obfuscated bytes through the reader must give the same values
+    // as XORing a CDataStream copy of them first.
+    const std::vector<unsigned char> key = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88};
+    CDataStream plain(SER_DISK, 0);
+    plain << uint8_t{0xab} << std::vector<unsigned char>(40, 0x5a) << uint64_t{0x0123456789abcdef} << std::string("obfuscated");
+    CDataStream obfuscated(plain);
+    obfuscated.Xor(key);
+    const std::vector<unsigned char> bytes(obfuscated.begin(), obfuscated.end());
+
+    SpanReader reader(SER_DISK, 0, bytes.data(), bytes.size());
+    reader.Xor(key);
+    uint8_t a;
+    std::vector<unsigned char> b;
+    uint64_t c;
+    std::string d;
+    reader >> a >> b >> c >> d;
+    BOOST_CHECK(reader.empty());
+    BOOST_CHECK_EQUAL(a, 0xab);
+    BOOST_CHECK(b == std::vector<unsigned char>(40, 0x5a));
+    BOOST_CHECK_EQUAL(c, 0x0123456789abcdefULL);
+    BOOST_CHECK_EQUAL(d, "obfuscated");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
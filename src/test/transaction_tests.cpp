@@ -759,4 +759,41 @@ BOOST_AUTO_TEST_CASE(test_IsStandard)
     BOOST_CHECK(!IsStandardTx(t, reason));
 }
 
+BOOST_AUTO_TEST_CASE(test_cached_sizes)
+{
+    CMutableTransaction mtx;
+    mtx.vin.resize(2);
+    mtx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(71, 0x30);
+    mtx.vout.resize(3);
+    mtx.vout[2].scriptPubKey = CScript() << OP_RETURN << std::vector<unsigned char>(300, 1);
+
+    for (bool witness : {false, true}) {
+        if (witness) {
+            mtx.vin[1].scriptWitness.stack = {std::vector<unsigned char>(72, 1), std::vector<unsigned char>(33, 2)};
+        }
+        const CTransaction tx(mtx);
+        BOOST_CHECK_EQUAL(tx.HasWitness(), witness);
+
+        // The cached sizes match what actually gets serialized.
+        CDataStream full(SER_NETWORK, PROTOCOL_VERSION);
+        full << mtx;
+        CDataStream stripped(SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS);
+        stripped << mtx;
+        BOOST_CHECK_EQUAL(tx.GetTotalSize(), full.size());
+        BOOST_CHECK_EQUAL(::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION), full.size());
+        BOOST_CHECK_EQUAL(::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS), stripped.size());
+        BOOST_CHECK_EQUAL(GetTransactionWeight(tx), (int64_t)(stripped.size() * (WITNESS_SCALE_FACTOR - 1) + full.size()));
+        BOOST_CHECK_EQUAL(full.size() > stripped.size(), witness);
+
+        // Copies, including ones made through CMutableTransaction, agree.
+        const CTransaction copy(tx);
+        BOOST_CHECK_EQUAL(copy.GetTotalSize(), tx.GetTotalSize());
+        BOOST_CHECK_EQUAL(CTransaction(CMutableTransaction(tx)).GetTotalSize(), tx.GetTotalSize());
+    }
+
+    const CTransaction empty;
+    BOOST_CHECK_EQUAL(empty.GetTotalSize(), 10U);
+    BOOST_CHECK(!empty.HasWitness());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,126 @@
+// Copyright (c) 2017-2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <index/txindex.h>
+#include <script/standard.h>
+#include <test/test_bitcoin.h>
+#include <txdb.h>
+#include <util.h>
+#include <utiltime.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(txindex_tests)
+
+BOOST_FIXTURE_TEST_CASE(txindex_initial_sync, TestChain100Setup)
+{
+    TxIndex txindex(1 << 20, true);
+
+    CTransactionRef tx_disk;
+    uint256 block_hash;
+
+    // Transaction should not be found in the index before it is started.
+    for (const auto& txn : coinbaseTxns) {
+        BOOST_CHECK(!txindex.FindTx(txn.GetHash(), block_hash, tx_disk));
+    }
+
+    // BlockUntilSyncedToCurrentChain should return false before txindex is started.
+    BOOST_CHECK(!txindex.BlockUntilSyncedToCurrentChain());
+
+    BOOST_REQUIRE(txindex.Start());
+
+    // Allow tx index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!txindex.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    IndexSummary summary = txindex.GetSummary();
+    BOOST_CHECK_EQUAL(summary.name, "txindex");
+    BOOST_CHECK(summary.synced);
+    BOOST_CHECK_EQUAL(summary.best_block_height, chainActive.Height());
+
+    // Check that txindex has all txs that were in the chain before it started.
+    for (const auto& txn : coinbaseTxns) {
+        if (!txindex.FindTx(txn.GetHash(), block_hash, tx_disk)) {
+            BOOST_ERROR("FindTx failed");
+        } else if (tx_disk->GetHash() != txn.GetHash()) {
+            BOOST_ERROR("Read incorrect tx");
+        }
+    }
+
+    // Check that new transactions in new blocks make it into the index.
+    for (int i = 0; i < 10; i++) {
+        CScript coinbase_script_pub_key = GetScriptForDestination(coinbaseKey.GetPubKey().GetID());
+        std::vector<CMutableTransaction> no_txns;
+        const CBlock& block = CreateAndProcessBlock(no_txns, coinbase_script_pub_key);
+        const CTransaction& txn = *block.vtx[0];
+
+        BOOST_CHECK(txindex.BlockUntilSyncedToCurrentChain());
+        if (!txindex.FindTx(txn.GetHash(), block_hash, tx_disk)) {
+            BOOST_ERROR("FindTx failed");
+        } else if (tx_disk->GetHash() != txn.GetHash()) {
+            BOOST_ERROR("Read incorrect tx");
+        } else {
+            BOOST_CHECK(block_hash == block.GetHash());
+        }
+    }
+    BOOST_CHECK_EQUAL(txindex.GetSummary().best_block_height, chainActive.Height());
+
+    txindex.Stop();
+}
+
+BOOST_FIXTURE_TEST_CASE(txindex_migration, TestChain100Setup)
+{
+    // Write the coinbase transactions the way the old synchronous txindex
+    // did: keyed by txid in the block tree database, under the txindex flag.
+    {
+        LOCK(cs_main);
+        CDBBatch batch(*pblocktree);
+        for (int height = 1; height <= chainActive.Height(); ++height) {
+            const CBlockIndex* pindex = chainActive[height];
+            CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(1));
+            batch.Write(std::make_pair('t', coinbaseTxns[height - 1].GetHash()), pos);
+        }
+        BOOST_REQUIRE(pblocktree->WriteBatch(batch, true));
+        BOOST_REQUIRE(pblocktree->WriteFlag("txindex", true));
+    }
+
+    TxIndex txindex(1 << 20, true);
+    BOOST_REQUIRE(txindex.Start());
+
+    // The migration runs before Start returns and leaves nothing behind.
+    bool f_legacy_flag = true;
+    BOOST_CHECK(pblocktree->ReadFlag("txindex", f_legacy_flag));
+    BOOST_CHECK(!f_legacy_flag);
+    BOOST_CHECK(!pblocktree->Exists('T'));
+    for (const auto& txn : coinbaseTxns) {
+        BOOST_CHECK(!pblocktree->Exists(std::make_pair('t', txn.GetHash())));
+    }
+
+    IndexSummary summary = txindex.GetSummary();
+    BOOST_CHECK(summary.synced);
+    BOOST_CHECK_EQUAL(summary.best_block_height, chainActive.Height());
+
+    CTransactionRef tx_disk;
+    uint256 block_hash;
+    for (int height = 1; height <= chainActive.Height(); ++height) {
+        const CTransaction& txn = coinbaseTxns[height - 1];
+        if (!txindex.FindTx(txn.GetHash(), block_hash, tx_disk)) {
+            BOOST_ERROR("FindTx failed");
+        } else if (tx_disk->GetHash() != txn.GetHash()) {
+            BOOST_ERROR("Read incorrect tx");
+        } else {
+            BOOST_CHECK(block_hash == chainActive[height]->GetBlockHash());
+        }
+    }
+
+    txindex.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -8,6 +8,7 @@
 #include <consensus/validation.h>
 #include <primitives/transaction.h>
 #include <script/script.h>
+#include <script/sign.h>
 #include <test/test_bitcoin.h>
 
 #include <boost/test/unit_test.hpp>
@@ -58,4 +59,109 @@ BOOST_FIXTURE_TEST_CASE(tx_mempool_reject_coinbase, TestChain100Setup)
     BOOST_CHECK_EQUAL(nDoS, 100);
 }
 
+static CMutableTransaction CreateSpend(const CTransaction& prev, const CKey& key, const CScript& scriptPubKey, CAmount nFee)
+{
+    CMutableTransaction tx;
+    tx.nVersion = 1;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(prev.GetHash(), 0);
+    tx.vout.resize(1);
+    tx.vout[0].nValue = prev.vout[0].nValue - nFee;
+    tx.vout[0].scriptPubKey = scriptPubKey;
+
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(prev.vout[0].scriptPubKey, tx, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    BOOST_CHECK(key.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    tx.vin[0].scriptSig << vchSig;
+    return tx;
+}
+
+/**
+ * Ensure that a child can pay for a parent below the relay fee when they are
+ * submitted together, and that packages are accepted or rejected as a whole.
+ */
+BOOST_FIXTURE_TEST_CASE(tx_mempool_accept_package, TestChain100Setup)
+{
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CTransactionRef parent = MakeTransactionRef(CreateSpend(coinbaseTxns[0], coinbaseKey, scriptPubKey, 0));
+    CTransactionRef child = MakeTransactionRef(CreateSpend(*parent, coinbaseKey, scriptPubKey, 10000));
+
+    LOCK(cs_main);
+    unsigned int initialPoolSize = mempool.size();
+
+    // The parent pays no fee, so it is rejected on its own.
+    CValidationState state;
+    BOOST_CHECK(!AcceptToMemoryPool(mempool, state, parent, nullptr /* pfMissingInputs */,
+                                    nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "min relay fee not met");
+
+    // Children must come after their parents.
+    state = CValidationState();
+    BOOST_CHECK(!AcceptPackageToMemoryPool(mempool, state, {child, parent}, 0 /* nAbsurdFee */));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "package-missing-inputs");
+    BOOST_CHECK_EQUAL(mempool.size(), initialPoolSize);
+
+    // A package paying less than the relay fee in total is rejected as a whole.
+    CTransactionRef cheap_child = MakeTransactionRef(CreateSpend(*parent, coinbaseKey, scriptPubKey, 1));
+    state = CValidationState();
+    BOOST_CHECK(!AcceptPackageToMemoryPool(mempool, state, {parent, cheap_child}, 0 /* nAbsurdFee */));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "min relay fee not met");
+    BOOST_CHECK_EQUAL(mempool.size(), initialPoolSize);
+
+    // A failure in the second transaction must not leave the first behind.
+    CMutableTransaction bad_child = CreateSpend(*parent, coinbaseKey, scriptPubKey, 10000);
+    bad_child.vin[0].scriptSig = CScript() << OP_0;
+    state = CValidationState();
+    BOOST_CHECK(!AcceptPackageToMemoryPool(mempool, state, {parent, MakeTransactionRef(bad_child)}, 0 /* nAbsurdFee */));
+    BOOST_CHECK(state.IsInvalid());
+    BOOST_CHECK_EQUAL(mempool.size(), initialPoolSize);
+
+    state = CValidationState();
+    BOOST_CHECK(AcceptPackageToMemoryPool(mempool, state, {parent, child}, 0 /* nAbsurdFee */));
+    BOOST_CHECK(state.IsValid());
+    BOOST_CHECK_EQUAL(mempool.size(), initialPoolSize + 2);
+    BOOST_CHECK(mempool.exists(parent->GetHash()));
+    BOOST_CHECK(mempool.exists(child->GetHash()));
+
+    // Packages never replace mempool transactions, even when they pay more.
+    CTransactionRef conflict = MakeTransactionRef(CreateSpend(coinbaseTxns[0], coinbaseKey, scriptPubKey, 50000));
+    CTransactionRef conflict_child = MakeTransactionRef(CreateSpend(*conflict, coinbaseKey, scriptPubKey, 50000));
+    state = CValidationState();
+    BOOST_CHECK(!AcceptPackageToMemoryPool(mempool, state, {conflict, conflict_child}, 0 /* nAbsurdFee */));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "txn-mempool-conflict");
+    BOOST_CHECK_EQUAL(mempool.size(), initialPoolSize + 2);
+    BOOST_CHECK(mempool.exists(parent->GetHash()));
+}
+
+/**
+ * Ensure that a test-only acceptance runs the checks without adding to the mempool.
+ */
+BOOST_FIXTURE_TEST_CASE(tx_mempool_test_accept, TestChain100Setup)
+{
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CTransactionRef tx = MakeTransactionRef(CreateSpend(coinbaseTxns[0], coinbaseKey, scriptPubKey, 10000));
+    CMutableTransaction bad_tx = CreateSpend(coinbaseTxns[1], coinbaseKey, scriptPubKey, 10000);
+    bad_tx.vin[0].scriptSig = CScript() << OP_0;
+
+    LOCK(cs_main);
+    unsigned int initialPoolSize = mempool.size();
+
+    CValidationState state;
+    BOOST_CHECK(AcceptToMemoryPool(mempool, state, tx, nullptr /* pfMissingInputs */,
+                                   nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */, true /* test_accept */));
+    BOOST_CHECK_EQUAL(mempool.size(), initialPoolSize);
+
+    BOOST_CHECK(!AcceptToMemoryPool(mempool, state, MakeTransactionRef(bad_tx), nullptr /* pfMissingInputs */,
+                                    nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */, true /* test_accept */));
+    BOOST_CHECK(state.IsInvalid());
+    BOOST_CHECK_EQUAL(mempool.size(), initialPoolSize);
+
+    // The same transaction is still accepted for real afterwards.
+    state = CValidationState();
+    BOOST_CHECK(AcceptToMemoryPool(mempool, state, tx, nullptr /* pfMissingInputs */,
+                                   nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */));
+    BOOST_CHECK_EQUAL(mempool.size(), initialPoolSize + 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
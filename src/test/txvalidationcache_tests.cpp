@@ -16,6 +16,7 @@
 #include <core_io.h>
 #include <keystore.h>
 #include <policy/policy.h>
+#include <script/sigcache.h>
 
 #include <boost/test/unit_test.hpp>
 
@@ -368,4 +369,51 @@ BOOST_FIXTURE_TEST_CASE(checkinputs_test, TestChain100Setup)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(script_execution_cache_persisted, TestChain100Setup)
+{
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    CMutableTransaction spend_tx;
+    spend_tx.nVersion = 1;
+    spend_tx.vin.resize(1);
+    spend_tx.vin[0].prevout.hash = coinbaseTxns[0].GetHash();
+    spend_tx.vin[0].prevout.n = 0;
+    spend_tx.vout.resize(1);
+    spend_tx.vout[0].nValue = 11*CENT;
+    spend_tx.vout[0].scriptPubKey = scriptPubKey;
+
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPubKey, spend_tx, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend_tx.vin[0].scriptSig << vchSig;
+
+    const CTransaction tx(spend_tx);
+    PrecomputedTransactionData txdata(tx);
+    LOCK(cs_main);
+
+    // Validating the transaction caches its script execution.
+    CValidationState state;
+    BOOST_CHECK(CheckInputs(tx, state, pcoinsTip.get(), true, SCRIPT_VERIFY_P2SH, true, true, txdata, nullptr));
+
+    BOOST_CHECK(DumpSignatureCache());
+    BOOST_CHECK(DumpScriptExecutionCache());
+
+    // Emptying the caches also draws new nonces, so the transaction is a miss
+    // and its script check is queued instead of skipped.
+    InitSignatureCache();
+    InitScriptExecutionCache();
+    std::vector<CScriptCheck> scriptchecks;
+    BOOST_CHECK(CheckInputs(tx, state, pcoinsTip.get(), true, SCRIPT_VERIFY_P2SH, true, true, txdata, &scriptchecks));
+    BOOST_CHECK_EQUAL(scriptchecks.size(), 1U);
+
+    // The reloaded entry is keyed with the dumped nonce, so it is a hit again
+    // and no script checks are queued.
+    BOOST_CHECK(LoadSignatureCache());
+    BOOST_CHECK(LoadScriptExecutionCache());
+    scriptchecks.clear();
+    BOOST_CHECK(CheckInputs(tx, state, pcoinsTip.get(), true, SCRIPT_VERIFY_P2SH, true, true, txdata, &scriptchecks));
+    BOOST_CHECK(scriptchecks.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
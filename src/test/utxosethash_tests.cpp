@@ -0,0 +1,116 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <script/script.h>
+#include <script/sign.h>
+#include <test/test_bitcoin.h>
+#include <txdb.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(utxosethash_tests)
+
+//! Hash the flushed UTXO set from scratch
+static CUTXOSetHash ScanUTXOSet()
+{
+    FlushStateToDisk();
+    CUTXOSetHash utxo_hash;
+    std::unique_ptr<CCoinsViewCursor> pcursor(pcoinsdbview->Cursor());
+    for (; pcursor->Valid(); pcursor->Next()) {
+        COutPoint key;
+        Coin coin;
+        BOOST_REQUIRE(pcursor->GetKey(key) && pcursor->GetValue(coin));
+        utxo_hash.Add(key, coin);
+    }
+    return utxo_hash;
+}
+
+static void CheckTipHash()
+{
+    const CUTXOSetHash scanned = ScanUTXOSet();
+    LOCK(cs_main);
+    CUTXOSetHash utxo_hash;
+    BOOST_REQUIRE(GetUTXOSetHash(chainActive.Tip(), utxo_hash));
+    BOOST_CHECK_EQUAL(utxo_hash.GetHash().ToString(), scanned.GetHash().ToString());
+    BOOST_CHECK_EQUAL(utxo_hash.nTransactionOutputs, scanned.nTransactionOutputs);
+    BOOST_CHECK_EQUAL(utxo_hash.nBogoSize, scanned.nBogoSize);
+    BOOST_CHECK_EQUAL(utxo_hash.nTotalAmount, scanned.nTotalAmount);
+}
+
+BOOST_FIXTURE_TEST_CASE(utxosethash_connect_disconnect, TestChain100Setup)
+{
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    // A block connected before -utxohash was enabled has no hash, nor has its parent
+    CreateAndProcessBlock({}, scriptPubKey);
+    CBlockIndex* pindex_first;
+    {
+        LOCK(cs_main);
+        pindex_first = chainActive.Tip();
+    }
+    fUTXOSetHash = true;
+    BOOST_CHECK(InitUTXOSetHash());
+    CheckTipHash();
+    {
+        LOCK(cs_main);
+        CUTXOSetHash utxo_hash;
+        BOOST_CHECK(!GetUTXOSetHash(pindex_first->pprev, utxo_hash));
+    }
+
+    // Disconnecting derives the parent's hash from the undo data
+    CValidationState state;
+    BOOST_CHECK(InvalidateBlock(state, Params(), pindex_first));
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+    CheckTipHash();
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(ResetBlockFailureFlags(pindex_first));
+    }
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+    CheckTipHash();
+
+    // Spend a coinbase into a regular and an unspendable output
+    CMutableTransaction spend;
+    spend.nVersion = 1;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = COutPoint(coinbaseTxns[0].GetHash(), 0);
+    spend.vout.resize(2);
+    spend.vout[0].nValue = coinbaseTxns[0].vout[0].nValue - 10000 - CENT;
+    spend.vout[0].scriptPubKey = scriptPubKey;
+    spend.vout[1].nValue = CENT;
+    spend.vout[1].scriptPubKey = CScript() << OP_RETURN;
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(coinbaseTxns[0].vout[0].scriptPubKey, spend, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+
+    CreateAndProcessBlock({spend}, scriptPubKey);
+    CheckTipHash();
+
+    fUTXOSetHash = false;
+}
+
+BOOST_FIXTURE_TEST_CASE(utxosethash_verifydb, TestChain100Setup)
+{
+    // On the first start with -utxohash no block has a hash yet. Startup
+    // computes the tip's before VerifyDB, whose reconnect step at level 4
+    // needs the hashes of the blocks it disconnected.
+    fUTXOSetHash = true;
+    BOOST_CHECK(InitUTXOSetHash());
+    BOOST_CHECK(CVerifyDB().VerifyDB(Params(), pcoinsdbview.get(), 4, 10));
+    CheckTipHash();
+    {
+        LOCK(cs_main);
+        CUTXOSetHash utxo_hash;
+        BOOST_CHECK(GetUTXOSetHash(chainActive[chainActive.Height() - 9], utxo_hash));
+    }
+
+    fUTXOSetHash = false;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
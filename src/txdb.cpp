@@ -15,14 +15,15 @@
 #include <init.h>
 
 #include <stdint.h>
+#include <thread>
 
 #include <boost/thread.hpp>
 
 static const char DB_COIN = 'C';
 static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
-static const char DB_TXINDEX = 't';
 static const char DB_BLOCK_INDEX = 'b';
+static const char DB_UTXO_SET_HASH = 'u';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_HEAD_BLOCKS = 'H';
@@ -54,6 +55,47 @@ struct CoinEntry {
 
 }
 
+static void SerializeUTXOSetHashElement(CDataStream& ss, const COutPoint& outpoint, const Coin& coin)
+{
+    ss << outpoint;
+    ss << static_cast<uint32_t>(coin.nHeight * 2 + coin.fCoinBase);
+    ss << coin.out;
+}
+
+//! The size the UTXO set statistics count for an output, as gettxoutsetinfo's bogosize
+static uint64_t GetBogoSize(const CScript& scriptPubKey)
+{
+    return 32 /* txid */ + 4 /* vout index */ + 4 /* height + coinbase */ + 8 /* amount */ +
+           2 /* scriptPubKey len */ + scriptPubKey.size() /* scriptPubKey */;
+}
+
+void CUTXOSetHash::Add(const COutPoint& outpoint, const Coin& coin)
+{
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    SerializeUTXOSetHashElement(ss, outpoint, coin);
+    muhash.Insert((const unsigned char*)ss.data(), ss.size());
+    nTransactionOutputs++;
+    nBogoSize += GetBogoSize(coin.out.scriptPubKey);
+    nTotalAmount += coin.out.nValue;
+}
+
+void CUTXOSetHash::Remove(const COutPoint& outpoint, const Coin& coin)
+{
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    SerializeUTXOSetHashElement(ss, outpoint, coin);
+    muhash.Remove((const unsigned char*)ss.data(), ss.size());
+    nTransactionOutputs--;
+    nBogoSize -= GetBogoSize(coin.out.scriptPubKey);
+    nTotalAmount -= coin.out.nValue;
+}
+
+uint256 CUTXOSetHash::GetHash() const
+{
+    uint256 hash;
+    muhash.Finalize(hash.begin());
+    return hash;
+}
+
 CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true) 
 {
 }
@@ -67,8 +109,12 @@ bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
+    return GetBestBlock(nullptr);
+}
+
+uint256 CCoinsViewDB::GetBestBlock(const CDBWrapper::Snapshot& snapshot) const {
     uint256 hashBestChain;
-    if (!db.Read(DB_BEST_BLOCK, hashBestChain))
+    if (!db.Read(DB_BEST_BLOCK, hashBestChain, snapshot))
         return uint256();
     return hashBestChain;
 }
@@ -172,11 +218,16 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
 
 CCoinsViewCursor *CCoinsViewDB::Cursor() const
 {
-    CCoinsViewDBCursor *i = new CCoinsViewDBCursor(const_cast<CDBWrapper&>(db).NewIterator(), GetBestBlock());
+    return Cursor(db.GetSnapshot(), 0);
+}
+
+CCoinsViewCursor *CCoinsViewDB::Cursor(const CDBWrapper::Snapshot& snapshot, unsigned char first_byte) const
+{
+    CCoinsViewDBCursor *i = new CCoinsViewDBCursor(const_cast<CDBWrapper&>(db).NewIterator(snapshot), GetBestBlock(snapshot), snapshot);
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
        that restriction.  */
-    i->pcursor->Seek(DB_COIN);
+    i->pcursor->Seek(std::make_pair(DB_COIN, first_byte));
     // Cache key of first record
     if (i->pcursor->Valid()) {
         CoinEntry entry(&i->keyTmp.second);
@@ -236,14 +287,15 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     return WriteBatch(batch, true);
 }
 
-bool CBlockTreeDB::ReadTxIndex(const uint256 &txid, CDiskTxPos &pos) {
-    return Read(std::make_pair(DB_TXINDEX, txid), pos);
+bool CBlockTreeDB::ReadUTXOSetHash(const uint256 &hashBlock, CUTXOSetHash &utxo_hash) {
+    return Read(std::make_pair(DB_UTXO_SET_HASH, hashBlock), utxo_hash);
 }
 
-bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> >&vect) {
+bool CBlockTreeDB::WriteUTXOSetHashes(const std::map<uint256, CUTXOSetHash> &mapUTXOSetHash) {
     CDBBatch batch(*this);
-    for (std::vector<std::pair<uint256,CDiskTxPos> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Write(std::make_pair(DB_TXINDEX, it->first), it->second);
+    for (const auto& entry : mapUTXOSetHash) {
+        batch.Write(std::make_pair(DB_UTXO_SET_HASH, entry.first), entry.second);
+    }
     return WriteBatch(batch);
 }
 
@@ -259,43 +311,139 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
+//! Number of block index entries LoadBlockIndexGuts reads and verifies at a time
+static const size_t BLOCK_INDEX_LOAD_BATCH = 16384;
+//! Maximum number of threads LoadBlockIndexGuts verifies headers with
+static const int MAX_BLOCK_INDEX_LOAD_THREADS = 8;
+
+//! Name of the flag recording that every stored block index entry has been verified
+static const std::string BLOCK_INDEX_VERIFIED_FLAG = "blockindexverified";
+
+/**
+ * Compute the hashes of the headers in entries[begin, end), check them against
+ * the hashes they are stored under and check their proof of work. Returns the
+ * position of the first entry that fails, or end.
+ */
+static size_t VerifyBlockIndexEntries(const std::vector<CDiskBlockIndex>& entries, const std::vector<uint256>& hashes,
+                                      size_t begin, size_t end, const Consensus::Params& consensusParams)
+{
+    for (size_t i = begin; i < end; ++i) {
+        const uint256 hash = entries[i].GetBlockHash();
+        if (hash != hashes[i] || !CheckProofOfWork(hash, entries[i].nBits, consensusParams)) {
+            return i;
+        }
+    }
+    return end;
+}
+
 bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
 {
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
     pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
 
+    // Every header is checked before its entry is first written, so once all
+    // stored entries have been verified on load the flag below is set and
+    // later startups trust the hashes the entries are stored under. Entries
+    // damaged on disk are still caught by the database's checksums.
+    bool already_verified = false;
+    ReadFlag(BLOCK_INDEX_VERIFIED_FLAG, already_verified);
+
+    // Entries are read in batches. Reading the database is sequential, but
+    // hashing the headers to check their proof of work is spread over
+    // several threads; linking the entries into mapBlockIndex is sequential
+    // again.
+    const int num_threads = std::max(1, std::min(GetNumCores(), MAX_BLOCK_INDEX_LOAD_THREADS));
+    std::vector<CDiskBlockIndex> entries;
+    std::vector<uint256> hashes;
+    entries.reserve(BLOCK_INDEX_LOAD_BATCH);
+    hashes.reserve(BLOCK_INDEX_LOAD_BATCH);
+    size_t num_entries = 0;
+    int64_t time_read = 0, time_verify = 0, time_link = 0;
+
     // Load mapBlockIndex
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight        = diskindex.nHeight;
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nTx            = diskindex.nTx;
-
-                if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, consensusParams))
-                    return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
-
-                pcursor->Next();
-            } else {
+    bool done = false;
+    while (!done) {
+        int64_t time_start = GetTimeMicros();
+        entries.clear();
+        hashes.clear();
+        while (entries.size() < BLOCK_INDEX_LOAD_BATCH) {
+            boost::this_thread::interruption_point();
+            std::pair<char, uint256> key;
+            if (!pcursor->Valid() || !pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX) {
+                done = true;
+                break;
+            }
+            entries.emplace_back();
+            if (!pcursor->GetValue(entries.back())) {
                 return error("%s: failed to read value", __func__);
             }
-        } else {
-            break;
+            hashes.push_back(key.second);
+            pcursor->Next();
+        }
+        int64_t time_read_done = GetTimeMicros();
+        time_read += time_read_done - time_start;
+
+        if (!already_verified) {
+            const size_t batch_threads = std::min<size_t>(num_threads, (entries.size() + 1023) / 1024);
+            std::vector<size_t> failed(std::max<size_t>(batch_threads, 1), entries.size());
+            if (batch_threads <= 1) {
+                failed[0] = VerifyBlockIndexEntries(entries, hashes, 0, entries.size(), consensusParams);
+            } else {
+                std::vector<std::thread> threads;
+                const size_t chunk = (entries.size() + batch_threads - 1) / batch_threads;
+                for (size_t t = 0; t < batch_threads; ++t) {
+                    const size_t begin = std::min(t * chunk, entries.size());
+                    const size_t end = std::min(begin + chunk, entries.size());
+                    threads.emplace_back([&, t, begin, end] {
+                        const size_t failed_pos = VerifyBlockIndexEntries(entries, hashes, begin, end, consensusParams);
+                        if (failed_pos != end) failed[t] = failed_pos;
+                    });
+                }
+                for (std::thread& thread : threads) {
+                    thread.join();
+                }
+            }
+            for (size_t failed_pos : failed) {
+                if (failed_pos != entries.size()) {
+                    return error("%s: CheckProofOfWork failed: %s", __func__, entries[failed_pos].ToString());
+                }
+            }
+        }
+        int64_t time_verify_done = GetTimeMicros();
+        time_verify += time_verify_done - time_read_done;
+
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const CDiskBlockIndex& diskindex = entries[i];
+            // Construct block index object
+            CBlockIndex* pindexNew = insertBlockIndex(hashes[i]);
+            pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
+            pindexNew->nHeight        = diskindex.nHeight;
+            pindexNew->nFile          = diskindex.nFile;
+            pindexNew->nDataPos       = diskindex.nDataPos;
+            pindexNew->nUndoPos       = diskindex.nUndoPos;
+            pindexNew->nVersion       = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->nTime          = diskindex.nTime;
+            pindexNew->nBits          = diskindex.nBits;
+            pindexNew->nNonce         = diskindex.nNonce;
+            pindexNew->nStatus        = diskindex.nStatus;
+            pindexNew->nTx            = diskindex.nTx;
+        }
+        num_entries += entries.size();
+        time_link += GetTimeMicros() - time_verify_done;
+    }
+
+    if (already_verified) {
+        LogPrintf("%s: loaded %u block index entries in %.2fs (read %.2fs, verify skipped, link %.2fs)\n",
+                  __func__, num_entries, (time_read + time_link) * 0.000001,
+                  time_read * 0.000001, time_link * 0.000001);
+    } else {
+        LogPrintf("%s: loaded %u block index entries in %.2fs (read %.2fs, verify %.2fs with %d threads, link %.2fs)\n",
+                  __func__, num_entries, (time_read + time_verify + time_link) * 0.000001,
+                  time_read * 0.000001, time_verify * 0.000001, num_threads, time_link * 0.000001);
+        if (num_entries > 0 && !WriteFlag(BLOCK_INDEX_VERIFIED_FLAG, true)) {
+            return error("%s: failed to record the block index as verified", __func__);
         }
     }
 
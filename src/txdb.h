@@ -7,6 +7,7 @@
 #define BITCOIN_TXDB_H
 
 #include <coins.h>
+#include <crypto/muhash.h>
 #include <dbwrapper.h>
 #include <chain.h>
 
@@ -29,12 +30,16 @@ static const int64_t nDefaultDbBatchSize = 16 << 20;
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache (MiB)
 static const int64_t nMinDbCache = 4;
-//! Max memory allocated to block tree DB specific cache, if no -txindex (MiB)
+//! Max memory allocated to block tree DB specific cache (MiB)
 static const int64_t nMaxBlockDBCache = 2;
-//! Max memory allocated to block tree DB specific cache, if -txindex (MiB)
+//! Max memory allocated to tx index DB specific cache (MiB)
 // Unlike for the UTXO database, for the txindex scenario the leveldb cache make
 // a meaningful difference: https://github.com/bitcoin/bitcoin/pull/8273#issuecomment-229601991
-static const int64_t nMaxBlockDBAndTxIndexCache = 1024;
+static const int64_t nMaxTxIndexCache = 1024;
+//! Max memory allocated to address index DB specific cache (MiB)
+static const int64_t nMaxAddrIndexCache = 1024;
+//! Max memory allocated to block filter index DB specific cache (MiB)
+static const int64_t nMaxBlockFilterIndexCache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
 
@@ -63,6 +68,31 @@ struct CDiskTxPos : public CDiskBlockPos
     }
 };
 
+/** Order-independent hash and totals of the UTXO set as of one block, kept with -utxohash */
+struct CUTXOSetHash
+{
+    MuHash3072 muhash;
+    uint64_t nTransactionOutputs;
+    uint64_t nBogoSize;
+    CAmount nTotalAmount;
+
+    CUTXOSetHash() : nTransactionOutputs(0), nBogoSize(0), nTotalAmount(0) {}
+
+    void Add(const COutPoint& outpoint, const Coin& coin);
+    void Remove(const COutPoint& outpoint, const Coin& coin);
+    uint256 GetHash() const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(muhash);
+        READWRITE(VARINT(nTransactionOutputs));
+        READWRITE(VARINT(nBogoSize));
+        READWRITE(nTotalAmount);
+    }
+};
+
 /** CCoinsView backed by the coin database (chainstate/) */
 class CCoinsViewDB final : public CCoinsView
 {
@@ -74,9 +104,19 @@ public:
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
     uint256 GetBestBlock() const override;
+    uint256 GetBestBlock(const CDBWrapper::Snapshot& snapshot) const;
     std::vector<uint256> GetHeadBlocks() const override;
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     CCoinsViewCursor *Cursor() const override;
+    /**
+     * Cursor over the coins in snapshot, starting at the first txid whose
+     * leading serialized byte is at least first_byte. Cursors over the same
+     * snapshot can split the coins between threads.
+     */
+    CCoinsViewCursor *Cursor(const CDBWrapper::Snapshot& snapshot, unsigned char first_byte) const;
+
+    //! The underlying database, for statistics and background compaction
+    CDBWrapper& GetDB() { return db; }
 
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
@@ -97,8 +137,9 @@ public:
     void Next() override;
 
 private:
-    CCoinsViewDBCursor(CDBIterator* pcursorIn, const uint256 &hashBlockIn):
-        CCoinsViewCursor(hashBlockIn), pcursor(pcursorIn) {}
+    CCoinsViewDBCursor(CDBIterator* pcursorIn, const uint256 &hashBlockIn, const CDBWrapper::Snapshot& snapshotIn):
+        CCoinsViewCursor(hashBlockIn), snapshot(snapshotIn), pcursor(pcursorIn) {}
+    CDBWrapper::Snapshot snapshot;
     std::unique_ptr<CDBIterator> pcursor;
     std::pair<char, COutPoint> keyTmp;
 
@@ -119,8 +160,8 @@ public:
     bool ReadLastBlockFile(int &nFile);
     bool WriteReindexing(bool fReindexing);
     bool ReadReindexing(bool &fReindexing);
-    bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos);
-    bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &vect);
+    bool ReadUTXOSetHash(const uint256 &hashBlock, CUTXOSetHash &utxo_hash);
+    bool WriteUTXOSetHashes(const std::map<uint256, CUTXOSetHash> &mapUTXOSetHash);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
     bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
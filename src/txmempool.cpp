@@ -21,8 +21,8 @@
 CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                                  int64_t _nTime, unsigned int _entryHeight,
                                  bool _spendsCoinbase, int64_t _sigOpsCost, LockPoints lp):
-    tx(_tx), nFee(_nFee), nTime(_nTime), entryHeight(_entryHeight),
-    spendsCoinbase(_spendsCoinbase), sigOpCost(_sigOpsCost), lockPoints(lp)
+    tx(_tx), nFee(_nFee), nTime(_nTime), lockPoints(lp),
+    sigOpCost(_sigOpsCost), entryHeight(_entryHeight), spendsCoinbase(_spendsCoinbase)
 {
     nTxWeight = GetTransactionWeight(*tx);
     nUsageSize = RecursiveDynamicUsage(tx);
@@ -61,15 +61,18 @@ size_t CTxMemPoolEntry::GetTxSize() const
 // descendants.
 void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendants, const std::set<uint256> &setExclude)
 {
-    setEntries stageEntries, setAllDescendants;
-    stageEntries = GetMemPoolChildren(updateIt);
+    setEntries setAllDescendants;
+    setEntries stageEntries;
+    for (const CTxMemPoolEntry* child : GetMemPoolChildren(updateIt)) {
+        stageEntries.insert(mapTx.iterator_to(*child));
+    }
 
     while (!stageEntries.empty()) {
         const txiter cit = *stageEntries.begin();
         setAllDescendants.insert(cit);
         stageEntries.erase(cit);
-        const setEntries &setChildren = GetMemPoolChildren(cit);
-        for (const txiter childEntry : setChildren) {
+        for (const CTxMemPoolEntry* child : GetMemPoolChildren(cit)) {
+            const txiter childEntry = mapTx.iterator_to(*child);
             cacheMap::iterator cacheIt = cachedDescendants.find(childEntry);
             if (cacheIt != cachedDescendants.end()) {
                 // We've already calculated this one, just add the entries for this set
@@ -174,7 +177,9 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
         // If we're not searching for parents, we require this to be an
         // entry in the mempool already.
         txiter it = mapTx.iterator_to(entry);
-        parentHashes = GetMemPoolParents(it);
+        for (const CTxMemPoolEntry* parent : GetMemPoolParents(it)) {
+            parentHashes.insert(mapTx.iterator_to(*parent));
+        }
     }
 
     size_t totalSizeWithAncestors = entry.GetTxSize();
@@ -197,8 +202,8 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
             return false;
         }
 
-        const setEntries & setMemPoolParents = GetMemPoolParents(stageit);
-        for (const txiter &phash : setMemPoolParents) {
+        for (const CTxMemPoolEntry* parent : GetMemPoolParents(stageit)) {
+            const txiter phash = mapTx.iterator_to(*parent);
             // If this is a new ancestor, add it.
             if (setAncestors.count(phash) == 0) {
                 parentHashes.insert(phash);
@@ -215,10 +220,9 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
 
 void CTxMemPool::UpdateAncestorsOf(bool add, txiter it, setEntries &setAncestors)
 {
-    setEntries parentIters = GetMemPoolParents(it);
     // add or remove this tx as a child of each parent
-    for (txiter piter : parentIters) {
-        UpdateChild(piter, it, add);
+    for (const CTxMemPoolEntry* parent : GetMemPoolParents(it)) {
+        UpdateChild(mapTx.iterator_to(*parent), it, add);
     }
     const int64_t updateCount = (add ? 1 : -1);
     const int64_t updateSize = updateCount * it->GetTxSize();
@@ -244,9 +248,8 @@ void CTxMemPool::UpdateEntryForAncestors(txiter it, const setEntries &setAncesto
 
 void CTxMemPool::UpdateChildrenForRemoval(txiter it)
 {
-    const setEntries &setMemPoolChildren = GetMemPoolChildren(it);
-    for (txiter updateIt : setMemPoolChildren) {
-        UpdateParent(updateIt, it, false);
+    for (const CTxMemPoolEntry* child : GetMemPoolChildren(it)) {
+        UpdateParent(mapTx.iterator_to(*child), it, false);
     }
 }
 
@@ -259,7 +262,7 @@ void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, b
         // updateDescendants should be true whenever we're not recursively
         // removing a tx and all its descendants, eg when a transaction is
         // confirmed in a block.
-        // Here we only update statistics and not data in mapLinks (which
+        // Here we only update statistics and not the entries' links (which
         // we need to preserve until we're finished with all operations that
         // need to traverse the mempool).
         for (txiter removeIt : entriesToRemove) {
@@ -284,16 +287,16 @@ void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, b
         // should be a bit faster.
         // However, if we happen to be in the middle of processing a reorg, then
         // the mempool can be in an inconsistent state.  In this case, the set
-        // of ancestors reachable via mapLinks will be the same as the set of 
+        // of ancestors reachable via the links will be the same as the set of 
         // ancestors whose packages include this transaction, because when we
         // add a new transaction to the mempool in addUnchecked(), we assume it
         // has no children, and in the case of a reorg where that assumption is
         // false, the in-mempool children aren't linked to the in-block tx's
         // until UpdateTransactionsFromBlock() is called.
         // So if we're being called during a reorg, ie before
-        // UpdateTransactionsFromBlock() has been called, then mapLinks[] will
+        // UpdateTransactionsFromBlock() has been called, then the links will
         // differ from the set of mempool parents we'd calculate by searching,
-        // and it's important that we use the mapLinks[] notion of ancestor
+        // and it's important that we use the links' notion of ancestor
         // transactions as the set of things to update for removal.
         CalculateMemPoolAncestors(entry, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
         // Note that UpdateAncestorsOf severs the child links that point to
@@ -365,7 +368,9 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     // all the appropriate checks.
     LOCK(cs);
     indexed_transaction_set::iterator newit = mapTx.insert(entry).first;
-    mapLinks.insert(make_pair(newit, TxLinks()));
+    const CTransaction& tx = newit->GetTx();
+    vTxHashes.emplace_back(tx.GetWitnessHash(), newit);
+    newit->vTxHashesIdx = vTxHashes.size() - 1;
 
     // Update transaction for any feeDelta created by PrioritiseTransaction
     // TODO: refactor so that the fee delta is calculated before inserting
@@ -383,7 +388,6 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     // further updated.)
     cachedInnerUsage += entry.DynamicMemoryUsage();
 
-    const CTransaction& tx = newit->GetTx();
     std::set<uint256> setParentTransactions;
     for (unsigned int i = 0; i < tx.vin.size(); i++) {
         mapNextTx.insert(std::make_pair(&tx.vin[i].prevout, &tx));
@@ -410,9 +414,6 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     totalTxSize += entry.GetTxSize();
     if (minerPolicyEstimator) {minerPolicyEstimator->processTransaction(entry, validFeeEstimate);}
 
-    vTxHashes.emplace_back(tx.GetWitnessHash(), newit);
-    newit->vTxHashesIdx = vTxHashes.size() - 1;
-
     return true;
 }
 
@@ -434,8 +435,7 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 
     totalTxSize -= it->GetTxSize();
     cachedInnerUsage -= it->DynamicMemoryUsage();
-    cachedInnerUsage -= memusage::DynamicUsage(mapLinks[it].parents) + memusage::DynamicUsage(mapLinks[it].children);
-    mapLinks.erase(it);
+    cachedInnerUsage -= memusage::DynamicUsage(it->vMemPoolParents) + memusage::DynamicUsage(it->vMemPoolChildren);
     mapTx.erase(it);
     nTransactionsUpdated++;
     if (minerPolicyEstimator) {minerPolicyEstimator->removeTx(hash, false);}
@@ -461,8 +461,8 @@ void CTxMemPool::CalculateDescendants(txiter entryit, setEntries &setDescendants
         setDescendants.insert(it);
         stage.erase(it);
 
-        const setEntries &setChildren = GetMemPoolChildren(it);
-        for (const txiter &childiter : setChildren) {
+        for (const CTxMemPoolEntry* child : GetMemPoolChildren(it)) {
+            const txiter childiter = mapTx.iterator_to(*child);
             if (!setDescendants.count(childiter)) {
                 stage.insert(childiter);
             }
@@ -590,7 +590,7 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
 
 void CTxMemPool::_clear()
 {
-    mapLinks.clear();
+    vTxHashes.clear();
     mapTx.clear();
     mapNextTx.clear();
     totalTxSize = 0;
@@ -639,10 +639,7 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
         checkTotal += it->GetTxSize();
         innerUsage += it->DynamicMemoryUsage();
         const CTransaction& tx = it->GetTx();
-        txlinksMap::const_iterator linksiter = mapLinks.find(it);
-        assert(linksiter != mapLinks.end());
-        const TxLinks &links = linksiter->second;
-        innerUsage += memusage::DynamicUsage(links.parents) + memusage::DynamicUsage(links.children);
+        innerUsage += memusage::DynamicUsage(it->vMemPoolParents) + memusage::DynamicUsage(it->vMemPoolChildren);
         bool fDependsWait = false;
         setEntries setParentCheck;
         int64_t parentSizes = 0;
@@ -668,7 +665,10 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
             assert(it3->second == &tx);
             i++;
         }
-        assert(setParentCheck == GetMemPoolParents(it));
+        assert(setParentCheck.size() == it->vMemPoolParents.size());
+        for (const CTxMemPoolEntry* parent : it->vMemPoolParents) {
+            assert(setParentCheck.count(mapTx.iterator_to(*parent)));
+        }
         // Verify ancestor state is correct.
         setEntries setAncestors;
         uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
@@ -701,7 +701,10 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
                 childSizes += childit->GetTxSize();
             }
         }
-        assert(setChildrenCheck == GetMemPoolChildren(it));
+        assert(setChildrenCheck.size() == it->vMemPoolChildren.size());
+        for (const CTxMemPoolEntry* child : it->vMemPoolChildren) {
+            assert(setChildrenCheck.count(mapTx.iterator_to(*child)));
+        }
         // Also check to make sure size is greater than sum with immediate children.
         // just a sanity check, not definitive that this calc is correct...
         assert(it->GetSizeWithDescendants() >= childSizes + it->GetTxSize());
@@ -904,10 +907,42 @@ bool CCoinsViewMemPool::GetCoin(const COutPoint &outpoint, Coin &coin) const {
     return base->GetCoin(outpoint, coin);
 }
 
+// Estimate the overhead of mapTx to be 12 pointers + an allocation per entry, as
+// no exact formula for boost::multi_index_contained is implemented: the hashed
+// txid index uses two pointers per node plus a bucket, and each of the three
+// ordered indexes uses three pointers per node.
+static const size_t MAPTX_HASHED_INDEX_POINTERS = 3;
+static const size_t MAPTX_ORDERED_INDEX_POINTERS = 3;
+static const size_t MAPTX_NODE_POINTERS = MAPTX_HASHED_INDEX_POINTERS + 3 * MAPTX_ORDERED_INDEX_POINTERS;
+
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
-    // Estimate the overhead of mapTx to be 12 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 12 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + MAPTX_NODE_POINTERS * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
+}
+
+MempoolMemoryUsage CTxMemPool::GetMemoryUsageBreakdown() const {
+    LOCK(cs);
+    MempoolMemoryUsage usage;
+    const size_t count = mapTx.size();
+    const size_t hashed_index = MAPTX_HASHED_INDEX_POINTERS * sizeof(void*) * count;
+    const size_t ordered_index = MAPTX_ORDERED_INDEX_POINTERS * sizeof(void*) * count;
+    usage.txid_index = hashed_index;
+    usage.descendant_score_index = ordered_index;
+    usage.entry_time_index = ordered_index;
+    usage.ancestor_score_index = ordered_index;
+    const size_t links_inline = 2 * sizeof(CTxMemPoolEntry::Links) * count;
+    usage.entries = memusage::MallocUsage(sizeof(CTxMemPoolEntry) + MAPTX_NODE_POINTERS * sizeof(void*)) * count - hashed_index - 3 * ordered_index - links_inline;
+
+    size_t links_inner = 0;
+    for (const CTxMemPoolEntry& entry : mapTx) {
+        links_inner += memusage::DynamicUsage(entry.vMemPoolParents) + memusage::DynamicUsage(entry.vMemPoolChildren);
+    }
+    usage.links = links_inline + links_inner;
+    usage.spends = memusage::DynamicUsage(mapNextTx);
+    usage.deltas = memusage::DynamicUsage(mapDeltas);
+    usage.wtxids = memusage::DynamicUsage(vTxHashes);
+    usage.transactions = cachedInnerUsage - links_inner;
+    return usage;
 }
 
 void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPoolRemovalReason reason) {
@@ -944,40 +979,44 @@ bool CTxMemPool::addUnchecked(const uint256&hash, const CTxMemPoolEntry &entry,
     return addUnchecked(hash, entry, setAncestors, validFeeEstimate);
 }
 
-void CTxMemPool::UpdateChild(txiter entry, txiter child, bool add)
+void CTxMemPool::UpdateLink(CTxMemPoolEntry::Links& links, const CTxMemPoolEntry& other, bool add)
 {
-    setEntries s;
-    if (add && mapLinks[entry].children.insert(child).second) {
-        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
-    } else if (!add && mapLinks[entry].children.erase(child)) {
-        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
+    CTxMemPoolEntry::Links::iterator pos = std::find(links.begin(), links.end(), &other);
+    if (add == (pos != links.end())) {
+        return;
+    }
+    cachedInnerUsage -= memusage::DynamicUsage(links);
+    if (add) {
+        links.push_back(&other);
+    } else {
+        *pos = links.back();
+        links.pop_back();
+        if (links.size() * 2 < links.capacity())
+            links.shrink_to_fit();
     }
+    cachedInnerUsage += memusage::DynamicUsage(links);
+}
+
+void CTxMemPool::UpdateChild(txiter entry, txiter child, bool add)
+{
+    UpdateLink(entry->vMemPoolChildren, *child, add);
 }
 
 void CTxMemPool::UpdateParent(txiter entry, txiter parent, bool add)
 {
-    setEntries s;
-    if (add && mapLinks[entry].parents.insert(parent).second) {
-        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
-    } else if (!add && mapLinks[entry].parents.erase(parent)) {
-        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
-    }
+    UpdateLink(entry->vMemPoolParents, *parent, add);
 }
 
-const CTxMemPool::setEntries & CTxMemPool::GetMemPoolParents(txiter entry) const
+const CTxMemPoolEntry::Links & CTxMemPool::GetMemPoolParents(txiter entry) const
 {
     assert (entry != mapTx.end());
-    txlinksMap::const_iterator it = mapLinks.find(entry);
-    assert(it != mapLinks.end());
-    return it->second.parents;
+    return entry->vMemPoolParents;
 }
 
-const CTxMemPool::setEntries & CTxMemPool::GetMemPoolChildren(txiter entry) const
+const CTxMemPoolEntry::Links & CTxMemPool::GetMemPoolChildren(txiter entry) const
 {
     assert (entry != mapTx.end());
-    txlinksMap::const_iterator it = mapLinks.find(entry);
-    assert(it != mapLinks.end());
-    return it->second.children;
+    return entry->vMemPoolChildren;
 }
 
 CFeeRate CTxMemPool::GetMinFee(size_t sizelimit) const {
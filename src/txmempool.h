@@ -64,15 +64,17 @@ class CTxMemPool;
 
 class CTxMemPoolEntry
 {
+public:
+    /** In-mempool parents or children of an entry. These are usually very few,
+     *  so an unordered vector is both smaller and faster than a set. */
+    typedef std::vector<const CTxMemPoolEntry*> Links;
+
 private:
+    // Fields are ordered by size to keep padding small; the 32-bit fields
+    // hold values that are bounded by consensus limits.
     CTransactionRef tx;	// 交易引用
     CAmount nFee;              //!< Cached to avoid expensive parent-transaction lookups 交易费用
-    size_t nTxWeight;          //!< ... and avoid recomputing tx weight (also used for GetTxSize())
-    size_t nUsageSize;         //!< ... and total memory usage 大小
     int64_t nTime;             //!< Local time when entering the mempool 时间戳
-    unsigned int entryHeight;  //!< Chain height when entering the mempool 区块高度
-    bool spendsCoinbase;       //!< keep track of transactions that spend a coinbase 前一个交易是否是 coinbase
-    int64_t sigOpCost;         //!< Total sigop cost
     int64_t feeDelta;          //!< Used for determining the priority of the transaction for mining in a block 调整交易的优先级
     LockPoints lockPoints;     //!< Track the height and time at which tx was final 交易最后的所在区块高度和打包的时间
 
@@ -93,6 +95,12 @@ private:
     CAmount nModFeesWithAncestors;
     int64_t nSigOpCostWithAncestors;
 
+    uint32_t nTxWeight;        //!< Cached to avoid recomputing tx weight (also used for GetTxSize())
+    uint32_t nUsageSize;       //!< ... and total memory usage 大小
+    int32_t sigOpCost;         //!< Total sigop cost
+    unsigned int entryHeight;  //!< Chain height when entering the mempool 区块高度
+    bool spendsCoinbase;       //!< keep track of transactions that spend a coinbase 前一个交易是否是 coinbase
+
 public:
     CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                     int64_t _nTime, unsigned int _entryHeight,
@@ -139,7 +147,9 @@ public:
     CAmount GetModFeesWithAncestors() const { return nModFeesWithAncestors; }
     int64_t GetSigOpCostWithAncestors() const { return nSigOpCostWithAncestors; }
 
-    mutable size_t vTxHashesIdx; //!< Index in mempool's vTxHashes
+    mutable uint32_t vTxHashesIdx; //!< Index in mempool's vTxHashes
+    mutable Links vMemPoolParents;  //!< Direct in-mempool parents, maintained by CTxMemPool
+    mutable Links vMemPoolChildren; //!< Direct in-mempool children, maintained by CTxMemPool
 };
 
 // Helpers for modifying CTxMemPool::mapTx, which is a boost multi_index.
@@ -350,6 +360,31 @@ struct TxMempoolInfo
     int64_t nFeeDelta;
 };
 
+/**
+ * Memory usage of a mempool, split by the data structure the bytes belong to.
+ * The mapTx index overheads are estimates, as no exact formula for
+ * boost::multi_index_container is implemented.
+ */
+struct MempoolMemoryUsage
+{
+    size_t entries;                //!< CTxMemPoolEntry objects and their allocation overhead
+    size_t txid_index;             //!< mapTx hashed txid index nodes and buckets
+    size_t descendant_score_index; //!< mapTx descendant_score index nodes
+    size_t entry_time_index;       //!< mapTx entry_time index nodes
+    size_t ancestor_score_index;   //!< mapTx ancestor_score index nodes
+    size_t links;                  //!< in-mempool parent/child links
+    size_t spends;                 //!< mapNextTx
+    size_t deltas;                 //!< mapDeltas
+    size_t wtxids;                 //!< vTxHashes
+    size_t transactions;           //!< transactions referenced by the entries
+
+    size_t Total() const
+    {
+        return entries + txid_index + descendant_score_index + entry_time_index + ancestor_score_index +
+               links + spends + deltas + wtxids + transactions;
+    }
+};
+
 /** Reason why a transaction was removed from the mempool,
  * this is passed to the notification signal.
  */
@@ -404,7 +439,7 @@ public:
  *
  * In order for the feerate sort to remain correct, we must update transactions
  * in the mempool when new descendants arrive.  To facilitate this, we track
- * the set of in-mempool direct parents and direct children in mapLinks.  Within
+ * the in-mempool direct parents and direct children in each entry.  Within
  * each CTxMemPoolEntry, we track the size and fees of all descendants.
  *
  * Usually when a new transaction is added to the mempool, it has no in-mempool
@@ -437,7 +472,7 @@ public:
  * state, to account for in-mempool, out-of-block descendants for all the
  * in-block transactions by calling UpdateTransactionsFromBlock().  Note that
  * until this is called, the mempool state is not consistent, and in particular
- * mapLinks may not be correct (and therefore functions like
+ * the entries' links may not be correct (and therefore functions like
  * CalculateMemPoolAncestors() and CalculateDescendants() that rely
  * on them to walk the mempool are not generally safe to use).
  *
@@ -528,21 +563,14 @@ public:
     };
     typedef std::set<txiter, CompareIteratorByHash> setEntries;
 
-    const setEntries & GetMemPoolParents(txiter entry) const;
-    const setEntries & GetMemPoolChildren(txiter entry) const;
+    const CTxMemPoolEntry::Links & GetMemPoolParents(txiter entry) const;
+    const CTxMemPoolEntry::Links & GetMemPoolChildren(txiter entry) const;
 private:
     typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
 
-    struct TxLinks {
-        setEntries parents;
-        setEntries children;
-    };
-
-    typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
-    txlinksMap mapLinks;
-
     void UpdateParent(txiter entry, txiter parent, bool add);
     void UpdateChild(txiter entry, txiter child, bool add);
+    void UpdateLink(CTxMemPoolEntry::Links& links, const CTxMemPoolEntry& other, bool add);
 
     std::vector<indexed_transaction_set::const_iterator> GetSortedDepthAndScore() const;
 
@@ -647,7 +675,7 @@ public:
      *  limitDescendantSize = max size of descendants any ancestor can have
      *  errString = populated with error reason if any limits are hit
      *  fSearchForParents = whether to search a tx's vin for in-mempool parents, or
-     *    look up parents from mapLinks. Must be true for entries not in the mempool
+     *    look up parents from the entry's links. Must be true for entries not in the mempool
      *
      *    计算 mempool 中所有 entry 的祖先
      *    limitAncestorCount = 最大祖先数量
@@ -655,7 +683,7 @@ public:
      *    limitDescendantCount = 任意祖先的最大子孙数量
      *    limitDescendantSize = 任意祖先的最大子孙大小
      *    errString = 超过了任何 limit 限制的错误提示
-     *    fSearchForParents = 是否在 mempool 中搜索交易的输入或者从 mapLinks 中查找，对于不在　mempool 中的 entry 必须设为 true
+     *    fSearchForParents = 是否在 mempool 中搜索交易的输入或者从 entry 的 vMemPoolParents 中查找，对于不在　mempool 中的 entry 必须设为 true
      */
     bool CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntries &setAncestors, uint64_t limitAncestorCount, uint64_t limitAncestorSize, uint64_t limitDescendantCount, uint64_t limitDescendantSize, std::string &errString, bool fSearchForParents = true) const;
 
@@ -717,6 +745,8 @@ public:
     std::vector<TxMempoolInfo> infoAll() const;
 
     size_t DynamicMemoryUsage() const;
+    /** DynamicMemoryUsage() split by data structure, for getmempoolinfo */
+    MempoolMemoryUsage GetMemoryUsageBreakdown() const;
 
     boost::signals2::signal<void (CTransactionRef)> NotifyEntryAdded;
     boost::signals2::signal<void (CTransactionRef, MemPoolRemovalReason)> NotifyEntryRemoved;
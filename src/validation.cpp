@@ -16,7 +16,9 @@
 #include <consensus/validation.h>
 #include <cuckoocache.h>
 #include <hash.h>
+#include <index/txindex.h>
 #include <init.h>
+#include <memusage.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <policy/rbf.h>
@@ -146,6 +148,8 @@ private:
 
 public:
     CChain chainActive;
+    //! Owns the entries of mapBlockIndex
+    CBlockIndexArena m_block_index_arena;
     BlockMap mapBlockIndex;
     std::multimap<CBlockIndex*, CBlockIndex*> mapBlocksUnlinked;
     CBlockIndex *pindexBestInvalid = nullptr;
@@ -207,7 +211,7 @@ CConditionVariable cvBlockChange;
 int nScriptCheckThreads = 0;
 std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
-bool fTxIndex = false;
+bool fUTXOSetHash = DEFAULT_UTXOSETHASH;
 bool fHavePruned = false;
 bool fPruneMode = false;
 bool fIsBareMultisigStd = DEFAULT_PERMIT_BAREMULTISIG;
@@ -344,7 +348,8 @@ bool TestLockPointValidity(const LockPoints* lp)
     return true;
 }
 
-bool CheckSequenceLocks(const CTransaction &tx, int flags, LockPoints* lp, bool useExistingLockPoints)
+bool CheckSequenceLocks(const CTransaction &tx, int flags, LockPoints* lp, bool useExistingLockPoints,
+                        const CCoinsView* coins_view)
 {
     AssertLockHeld(cs_main);
     AssertLockHeld(mempool.cs);
@@ -371,12 +376,13 @@ bool CheckSequenceLocks(const CTransaction &tx, int flags, LockPoints* lp, bool
     else {
         // pcoinsTip contains the UTXO set for chainActive.Tip()
         CCoinsViewMemPool viewMemPool(pcoinsTip.get(), mempool);
+        const CCoinsView& view = coins_view ? *coins_view : viewMemPool;
         std::vector<int> prevheights;
         prevheights.resize(tx.vin.size());
         for (size_t txinIndex = 0; txinIndex < tx.vin.size(); txinIndex++) {
             const CTxIn& txin = tx.vin[txinIndex];
             Coin coin;
-            if (!viewMemPool.GetCoin(txin.prevout, coin)) {
+            if (!view.GetCoin(txin.prevout, coin)) {
                 return error("%s: Missing input", __func__);
             }
             if (coin.nHeight == MEMPOOL_HEIGHT) {
@@ -507,7 +513,7 @@ void UpdateMempoolForReorg(DisconnectedBlockTransactions &disconnectpool, bool f
 // Used to avoid mempool polluting consensus critical paths if CCoinsViewMempool
 // were somehow broken and returning the wrong scriptPubKeys
 static bool CheckInputsFromMempoolAndCache(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &view, CTxMemPool& pool,
-                 unsigned int flags, bool cacheSigStore, PrecomputedTransactionData& txdata) {
+                 const CCoinsViewCache& coins_tip, unsigned int flags, bool cacheSigStore, PrecomputedTransactionData& txdata) {
     AssertLockHeld(cs_main);
 
     // pool.cs should be locked already, but go ahead and re-take the lock here
@@ -531,7 +537,7 @@ static bool CheckInputsFromMempoolAndCache(const CTransaction& tx, CValidationSt
             assert(txFrom->vout.size() > txin.prevout.n);
             assert(txFrom->vout[txin.prevout.n] == coin.out);
         } else {
-            const Coin& coinFromDisk = pcoinsTip->AccessCoin(txin.prevout);
+            const Coin& coinFromDisk = coins_tip.AccessCoin(txin.prevout);
             assert(!coinFromDisk.IsSpent());
             assert(coinFromDisk.out == coin.out);
         }
@@ -542,12 +548,13 @@ static bool CheckInputsFromMempoolAndCache(const CTransaction& tx, CValidationSt
 
 static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool& pool, CValidationState& state, const CTransactionRef& ptx,
                               bool* pfMissingInputs, int64_t nAcceptTime, std::list<CTransactionRef>* plTxnReplaced,
-                              bool bypass_limits, const CAmount& nAbsurdFee, std::vector<COutPoint>& coins_to_uncache)
+                              bool bypass_limits, const CAmount& nAbsurdFee, std::vector<COutPoint>& coins_to_uncache, bool test_accept,
+                              CCoinsViewCache* package_coins = nullptr)
 {
     const CTransaction& tx = *ptx;
     const uint256 hash = tx.GetHash();
     AssertLockHeld(cs_main);
-    LOCK(pool.cs); // mempool "read lock" (held through GetMainSignals().TransactionAddedToMempool())
+    LOCK(pool.cs); // mempool "read lock"
     if (pfMissingInputs) {
         *pfMissingInputs = false;
     }
@@ -628,8 +635,12 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
         CCoinsView dummy;
         CCoinsViewCache view(&dummy);
 
+        // A package checks its transactions against the chain tip plus the
+        // outputs of the package transactions before them.
+        CCoinsViewCache& coins_tip = package_coins ? *package_coins : *pcoinsTip;
+
         LockPoints lp;
-        CCoinsViewMemPool viewMemPool(pcoinsTip.get(), pool);
+        CCoinsViewMemPool viewMemPool(&coins_tip, pool);
         view.SetBackend(viewMemPool);
 
         // do all inputs exist?
@@ -662,9 +673,8 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
         // Only accept BIP68 sequence locked transactions that can be mined in the next
         // block; we don't want our mempool filled up with transactions that can't
         // be mined yet.
-        // Must keep pool.cs for this unless we change CheckSequenceLocks to take a
-        // CoinsViewCache instead of create its own
-        if (!CheckSequenceLocks(tx, STANDARD_LOCKTIME_VERIFY_FLAGS, &lp))
+        // Must keep pool.cs for this, as viewMemPool reads the mempool
+        if (!CheckSequenceLocks(tx, STANDARD_LOCKTIME_VERIFY_FLAGS, &lp, false, &viewMemPool))
             return state.DoS(0, false, REJECT_NONSTANDARD, "non-BIP68-final");
 
         CAmount nFees = 0;
@@ -916,7 +926,7 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
         // invalid blocks (using TestBlockValidity), however allowing such
         // transactions into the mempool can be exploited as a DoS attack.
         unsigned int currentBlockScriptVerifyFlags = GetBlockScriptFlags(chainActive.Tip(), Params().GetConsensus());
-        if (!CheckInputsFromMempoolAndCache(tx, state, view, pool, currentBlockScriptVerifyFlags, true, txdata))
+        if (!CheckInputsFromMempoolAndCache(tx, state, view, pool, coins_tip, currentBlockScriptVerifyFlags, true, txdata))
         {
             // If we're using promiscuousmempoolflags, we may hit this normally
             // Check if current block has some flags that scriptVerifyFlags
@@ -934,6 +944,11 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
             }
         }
 
+        if (test_accept) {
+            // Tx was accepted, but not added
+            return true;
+        }
+
         // Remove conflicting transactions from the mempool
         for (const CTxMemPool::txiter it : allConflicting)
         {
@@ -965,19 +980,20 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
         }
     }
 
-    GetMainSignals().TransactionAddedToMempool(ptx);
-
     return true;
 }
 
 /** (try to) add transaction to memory pool with a specified acceptance time **/
 static bool AcceptToMemoryPoolWithTime(const CChainParams& chainparams, CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx,
                         bool* pfMissingInputs, int64_t nAcceptTime, std::list<CTransactionRef>* plTxnReplaced,
-                        bool bypass_limits, const CAmount nAbsurdFee)
+                        bool bypass_limits, const CAmount nAbsurdFee, bool test_accept)
 {
     std::vector<COutPoint> coins_to_uncache;
-    bool res = AcceptToMemoryPoolWorker(chainparams, pool, state, tx, pfMissingInputs, nAcceptTime, plTxnReplaced, bypass_limits, nAbsurdFee, coins_to_uncache);
-    if (!res) {
+    bool res = AcceptToMemoryPoolWorker(chainparams, pool, state, tx, pfMissingInputs, nAcceptTime, plTxnReplaced, bypass_limits, nAbsurdFee, coins_to_uncache, test_accept);
+    if (res && !test_accept) {
+        GetMainSignals().TransactionAddedToMempool(tx);
+    }
+    if (!res || test_accept) {
         for (const COutPoint& hashTx : coins_to_uncache)
             pcoinsTip->Uncache(hashTx);
     }
@@ -989,10 +1005,167 @@ static bool AcceptToMemoryPoolWithTime(const CChainParams& chainparams, CTxMemPo
 
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx,
                         bool* pfMissingInputs, std::list<CTransactionRef>* plTxnReplaced,
-                        bool bypass_limits, const CAmount nAbsurdFee)
+                        bool bypass_limits, const CAmount nAbsurdFee, bool test_accept)
+{
+    const CChainParams& chainparams = Params();
+    return AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, pfMissingInputs, GetTime(), plTxnReplaced, bypass_limits, nAbsurdFee, test_accept);
+}
+
+static bool AcceptPackageToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool& pool, CValidationState& state,
+                                            const std::vector<CTransactionRef>& package, int64_t nAcceptTime,
+                                            const CAmount& nAbsurdFee, std::vector<COutPoint>& coins_to_uncache)
+{
+    AssertLockHeld(cs_main);
+    LOCK(pool.cs);
+
+    if (package.empty() || package.size() > MAX_PACKAGE_COUNT) {
+        return state.DoS(0, false, REJECT_INVALID, "bad-package-size");
+    }
+
+    // Check the whole package before changing the mempool. Each transaction
+    // goes through the full AcceptToMemoryPool checks in test_accept mode,
+    // against one view of the chain and mempool to which the outputs of the
+    // earlier package transactions are added as they are seen. A package
+    // that is not topologically sorted, or that spends the same output twice,
+    // fails here.
+    CTxMemPool::setEntries setAncestors;
+    std::set<uint256> setPackageTxids;
+    CAmount nPackageFees = 0;
+    int64_t nPackageSize = 0;
+    {
+        CCoinsViewMemPool viewMemPool(pcoinsTip.get(), pool);
+        CCoinsViewCache view(&viewMemPool);
+        for (const CTransactionRef& ptx : package) {
+            const CTransaction& tx = *ptx;
+            const uint256& hash = tx.GetHash();
+            if (!CheckTransaction(tx, state))
+                return false; // state filled in by CheckTransaction
+            if (tx.IsCoinBase())
+                return state.DoS(100, false, REJECT_INVALID, "coinbase");
+            if (pool.exists(hash))
+                return state.Invalid(false, REJECT_DUPLICATE, "txn-already-in-mempool");
+            if (!setPackageTxids.insert(hash).second)
+                return state.DoS(0, false, REJECT_INVALID, "package-contains-duplicates");
+
+            for (const CTxIn& txin : tx.vin) {
+                // Replacing mempool transactions could not be undone if a
+                // later package transaction failed.
+                if (pool.mapNextTx.count(txin.prevout)) {
+                    return state.Invalid(false, REJECT_DUPLICATE, "txn-mempool-conflict");
+                }
+                if (!pcoinsTip->HaveCoinInCache(txin.prevout)) {
+                    coins_to_uncache.push_back(txin.prevout);
+                }
+                if (!view.HaveCoin(txin.prevout)) {
+                    return state.Invalid(false, REJECT_INVALID, "package-missing-inputs",
+                                         strprintf("%s spends missing or spent output %s", hash.ToString(), txin.prevout.ToString()));
+                }
+                CTxMemPool::txiter parent = pool.mapTx.find(txin.prevout.hash);
+                if (parent != pool.mapTx.end() && setAncestors.insert(parent).second) {
+                    uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+                    std::string dummy;
+                    pool.CalculateMemPoolAncestors(*parent, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
+                }
+            }
+
+            // The fee limits are checked against the package below. Only the
+            // package as a whole has to pay the relay fee, so that a child
+            // can pay for a parent that pays nothing.
+            if (!AcceptToMemoryPoolWorker(chainparams, pool, state, ptx, nullptr /* pfMissingInputs */, nAcceptTime, nullptr /* plTxnReplaced */,
+                                          true /* bypass_limits */, nAbsurdFee, coins_to_uncache, true /* test_accept */, &view)) {
+                return false; // state filled in by AcceptToMemoryPoolWorker
+            }
+
+            CAmount nFees = view.GetValueIn(tx) - tx.GetValueOut();
+            pool.ApplyDelta(hash, nFees);
+            nPackageFees += nFees;
+            nPackageSize += GetVirtualTransactionSize(GetTransactionWeight(tx), GetTransactionSigOpCost(tx, view, STANDARD_SCRIPT_VERIFY_FLAGS));
+            UpdateCoins(tx, view, MEMPOOL_HEIGHT);
+        }
+    }
+
+    // The package is checked against the ancestor and descendant limits once,
+    // as if it were a single chain hanging off all of its in-mempool
+    // ancestors, so that adding it transaction by transaction cannot fail.
+    size_t nLimitAncestors = gArgs.GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT);
+    size_t nLimitAncestorSize = gArgs.GetArg("-limitancestorsize", DEFAULT_ANCESTOR_SIZE_LIMIT)*1000;
+    size_t nLimitDescendants = gArgs.GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT);
+    size_t nLimitDescendantSize = gArgs.GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT)*1000;
+    int64_t nAncestorsSize = nPackageSize;
+    for (CTxMemPool::txiter ancestorIt : setAncestors) {
+        nAncestorsSize += ancestorIt->GetTxSize();
+        if (ancestorIt->GetCountWithDescendants() + package.size() > nLimitDescendants ||
+            (uint64_t)(ancestorIt->GetSizeWithDescendants() + nPackageSize) > nLimitDescendantSize) {
+            return state.DoS(0, false, REJECT_NONSTANDARD, "too-long-mempool-chain", false,
+                             strprintf("package exceeds descendant limit of %s", ancestorIt->GetTx().GetHash().ToString()));
+        }
+    }
+    if (setAncestors.size() + package.size() > nLimitAncestors) {
+        return state.DoS(0, false, REJECT_NONSTANDARD, "too-long-mempool-chain", false,
+                         strprintf("package has too many ancestors [limit: %u]", nLimitAncestors));
+    }
+    if ((uint64_t)nAncestorsSize > nLimitAncestorSize) {
+        return state.DoS(0, false, REJECT_NONSTANDARD, "too-long-mempool-chain", false,
+                         strprintf("package exceeds ancestor size limit [limit: %u]", nLimitAncestorSize));
+    }
+
+    // Fee floors apply to the package feerate rather than to each transaction.
+    CAmount mempoolRejectFee = pool.GetMinFee(gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000).GetFee(nPackageSize);
+    if (mempoolRejectFee > 0 && nPackageFees < mempoolRejectFee) {
+        return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool min fee not met", false, strprintf("package %d < %d", nPackageFees, mempoolRejectFee));
+    }
+    if (nPackageFees < ::minRelayTxFee.GetFee(nPackageSize)) {
+        return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "min relay fee not met", false, strprintf("package %d < %d", nPackageFees, ::minRelayTxFee.GetFee(nPackageSize)));
+    }
+
+    // Every transaction has now passed, so adding them can only fail on a
+    // bug. The mempool is trimmed once the whole package is in, so that a
+    // parent is not evicted before the child paying for it arrives.
+    for (const CTransactionRef& ptx : package) {
+        if (!AcceptToMemoryPoolWorker(chainparams, pool, state, ptx, nullptr /* pfMissingInputs */, nAcceptTime, nullptr /* plTxnReplaced */,
+                                      true /* bypass_limits */, nAbsurdFee, coins_to_uncache, false /* test_accept */)) {
+            for (const CTransactionRef& tx : package) {
+                pool.removeRecursive(*tx);
+            }
+            return error("%s: BUG! PLEASE REPORT THIS! %s passed the package checks but was not accepted: %s",
+                         __func__, ptx->GetHash().ToString(), FormatStateMessage(state));
+        }
+    }
+
+    // As for a single transaction, whatever is evicted to make room for the
+    // package stays evicted, even if the package itself does not fit.
+    LimitMempoolSize(pool, gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, gArgs.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60);
+    for (const CTransactionRef& ptx : package) {
+        if (!pool.exists(ptx->GetHash())) {
+            for (const CTransactionRef& tx : package) {
+                pool.removeRecursive(*tx, MemPoolRemovalReason::SIZELIMIT);
+            }
+            return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool full");
+        }
+    }
+
+    // Listeners only learn about the package once all of it is in.
+    for (const CTransactionRef& ptx : package) {
+        GetMainSignals().TransactionAddedToMempool(ptx);
+    }
+
+    return true;
+}
+
+bool AcceptPackageToMemoryPool(CTxMemPool& pool, CValidationState &state, const std::vector<CTransactionRef>& package,
+                               const CAmount nAbsurdFee)
 {
     const CChainParams& chainparams = Params();
-    return AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, pfMissingInputs, GetTime(), plTxnReplaced, bypass_limits, nAbsurdFee);
+    std::vector<COutPoint> coins_to_uncache;
+    bool res = AcceptPackageToMemoryPoolWorker(chainparams, pool, state, package, GetTime(), nAbsurdFee, coins_to_uncache);
+    if (!res) {
+        for (const COutPoint& hashTx : coins_to_uncache)
+            pcoinsTip->Uncache(hashTx);
+    }
+    // After we've (potentially) uncached entries, ensure our coins cache is still within its size limits
+    CValidationState stateDummy;
+    FlushStateToDisk(chainparams, stateDummy, FLUSH_STATE_PERIODIC);
+    return res;
 }
 
 /**
@@ -1012,28 +1185,8 @@ bool GetTransaction(const uint256& hash, CTransactionRef& txOut, const Consensus
             return true;
         }
 
-        if (fTxIndex) {
-            CDiskTxPos postx;
-            if (pblocktree->ReadTxIndex(hash, postx)) {
-                CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-                if (file.IsNull())
-                    return error("%s: OpenBlockFile failed", __func__);
-                CBlockHeader header;
-                try {
-                    file >> header;
-                    fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
-                    file >> txOut;
-                } catch (const std::exception& e) {
-                    return error("%s: Deserialize or I/O error - %s", __func__, e.what());
-                }
-                hashBlock = header.GetHash();
-                if (txOut->GetHash() != hash)
-                    return error("%s: txid mismatch", __func__);
-                return true;
-            }
-
-            // transaction not found in index, nothing more can be done
-            return false;
+        if (g_txindex) {
+            return g_txindex->FindTx(hash, hashBlock, txOut);
         }
 
         if (fAllowSlow) { // use coin database to locate block that contains transaction, and scan it
@@ -1335,11 +1488,84 @@ void InitScriptExecutionCache() {
     // nMaxCacheSize is unsigned. If -maxsigcachesize is set to zero,
     // setup_bytes creates the minimum possible cache (2 elements).
     size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE) / 2), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
+    // setup_bytes does not clear the table, but no existing entry matches
+    // under a new nonce.
+    scriptExecutionCacheNonce = GetRandHash();
     size_t nElems = scriptExecutionCache.setup_bytes(nMaxCacheSize);
     LogPrintf("Using %zu MiB out of %zu/2 requested for script execution cache, able to store %zu elements\n",
             (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
 }
 
+static const uint64_t SCRIPT_CACHE_DUMP_VERSION = 1;
+
+bool DumpScriptExecutionCache()
+{
+    int64_t start = GetTimeMicros();
+
+    uint256 nonce;
+    std::vector<uint256> entries;
+    {
+        LOCK(cs_main);
+        nonce = scriptExecutionCacheNonce;
+        scriptExecutionCache.for_each([&entries](const uint256& entry) { entries.push_back(entry); });
+    }
+
+    try {
+        FILE* filestr = fsbridge::fopen(GetDataDir() / "scriptcache.dat.new", "wb");
+        if (!filestr) {
+            return false;
+        }
+
+        CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+
+        uint64_t version = SCRIPT_CACHE_DUMP_VERSION;
+        file << version;
+        file << nonce << entries;
+
+        FileCommit(file.Get());
+        file.fclose();
+        RenameOver(GetDataDir() / "scriptcache.dat.new", GetDataDir() / "scriptcache.dat");
+        LogPrintf("Dumped script execution cache: %.2fs\n", (GetTimeMicros() - start) * MICRO);
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to dump script execution cache: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+    return true;
+}
+
+bool LoadScriptExecutionCache()
+{
+    FILE* filestr = fsbridge::fopen(GetDataDir() / "scriptcache.dat", "rb");
+    CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        LogPrintf("Failed to open script execution cache file from disk. Continuing anyway.\n");
+        return false;
+    }
+
+    try {
+        uint64_t version;
+        file >> version;
+        if (version != SCRIPT_CACHE_DUMP_VERSION) {
+            return false;
+        }
+        uint256 nonce;
+        std::vector<uint256> entries;
+        file >> nonce >> entries;
+
+        LOCK(cs_main);
+        // Entries are keyed with the nonce of the run that dumped them.
+        scriptExecutionCacheNonce = nonce;
+        for (const uint256& entry : entries) {
+            scriptExecutionCache.insert(entry);
+        }
+        LogPrintf("Loaded %u script execution cache entries from disk\n", entries.size());
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to deserialize script execution cache data on disk: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+    return true;
+}
+
 /**
  * Check whether all inputs of this transaction are valid (no double spends, scripts & sigs, amounts)
  * This does not modify the UTXO set.
@@ -1466,7 +1692,9 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     return true;
 }
 
-static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
+} // namespace
+
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
 {
     CDiskBlockPos pos = pindex->GetUndoPos();
     if (pos.IsNull()) {
@@ -1497,6 +1725,8 @@ static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
     return true;
 }
 
+namespace {
+
 /** Abort with a message */
 bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
 {
@@ -1551,6 +1781,56 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out)
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
+/** UTXO set hashes of connected blocks not yet written to the block tree database */
+static std::map<uint256, CUTXOSetHash> mapUTXOSetHashDirty;
+
+bool GetUTXOSetHash(const CBlockIndex* pindex, CUTXOSetHash& utxo_hash)
+{
+    AssertLockHeld(cs_main);
+    auto it = mapUTXOSetHashDirty.find(pindex->GetBlockHash());
+    if (it != mapUTXOSetHashDirty.end()) {
+        utxo_hash = it->second;
+        return true;
+    }
+    return pblocktree->ReadUTXOSetHash(pindex->GetBlockHash(), utxo_hash);
+}
+
+/**
+ * Apply the UTXO set changes of connecting a block to utxo_hash, or undo
+ * them. Coinbase outputs that overwrote an unspent duplicate (only possible
+ * in the two blocks exempt from BIP30) replace that coin when connecting, as
+ * they do in the UTXO set.
+ */
+static void UpdateUTXOSetHash(CUTXOSetHash& utxo_hash, const CBlock& block, const CBlockUndo& blockundo, int nHeight,
+                              const std::vector<std::pair<COutPoint, Coin>>& overwritten, bool fDisconnect)
+{
+    for (const auto& entry : overwritten) {
+        utxo_hash.Remove(entry.first, entry.second);
+    }
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        for (size_t o = 0; o < tx.vout.size(); o++) {
+            if (tx.vout[o].scriptPubKey.IsUnspendable()) continue;
+            const COutPoint out(tx.GetHash(), o);
+            const Coin coin(tx.vout[o], nHeight, tx.IsCoinBase());
+            if (fDisconnect) {
+                utxo_hash.Remove(out, coin);
+            } else {
+                utxo_hash.Add(out, coin);
+            }
+        }
+        if (i == 0) continue;
+        const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+        for (size_t j = 0; j < tx.vin.size(); j++) {
+            if (fDisconnect) {
+                utxo_hash.Add(tx.vin[j].prevout, txundo.vprevout[j]);
+            } else {
+                utxo_hash.Remove(tx.vin[j].prevout, txundo.vprevout[j]);
+            }
+        }
+    }
+}
+
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
  *  When FAILED is returned, view is left in an indeterminate state. */
 DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view)
@@ -1568,6 +1848,21 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
         return DISCONNECT_FAILED;
     }
 
+    // Derive the UTXO set hash of the previous block if it was never connected with -utxohash
+    if (fUTXOSetHash) {
+        CUTXOSetHash utxo_hash;
+        if (!GetUTXOSetHash(pindex->pprev, utxo_hash) && GetUTXOSetHash(pindex, utxo_hash)) {
+            bool fConsistent = true;
+            for (size_t i = 1; i < block.vtx.size(); i++) {
+                fConsistent = fConsistent && blockUndo.vtxundo[i - 1].vprevout.size() == block.vtx[i]->vin.size();
+            }
+            if (fConsistent) {
+                UpdateUTXOSetHash(utxo_hash, block, blockUndo, pindex->nHeight, {}, true);
+                mapUTXOSetHashDirty[pindex->pprev->GetBlockHash()] = utxo_hash;
+            }
+        }
+    }
+
     // undo transactions in reverse order
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
         const CTransaction &tx = *(block.vtx[i]);
@@ -1654,23 +1949,20 @@ static bool WriteUndoDataForBlock(const CBlockUndo& blockundo, CValidationState&
     return true;
 }
 
-static bool WriteTxIndexDataForBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex)
+static bool WriteUTXOSetHashForBlock(const CBlock& block, const CBlockUndo& blockundo, const std::vector<std::pair<COutPoint, Coin>>& overwritten,
+                                     CValidationState& state, const CBlockIndex* pindex)
 {
-    if (!fTxIndex) return true;
-
-    CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
-    std::vector<std::pair<uint256, CDiskTxPos> > vPos;
-    vPos.reserve(block.vtx.size());
-    for (const CTransactionRef& tx : block.vtx)
-    {
-        vPos.push_back(std::make_pair(tx->GetHash(), pos));
-        pos.nTxOffset += ::GetSerializeSize(*tx, SER_DISK, CLIENT_VERSION);
-    }
+    if (!fUTXOSetHash) return true;
 
-    if (!pblocktree->WriteTxIndex(vPos)) {
-        return AbortNode(state, "Failed to write transaction index");
+    // The hash of a block's UTXO set never changes, so a block reconnected
+    // after a reorg or by VerifyDB already has it.
+    CUTXOSetHash utxo_hash;
+    if (GetUTXOSetHash(pindex, utxo_hash)) return true;
+    if (!GetUTXOSetHash(pindex->pprev, utxo_hash)) {
+        return AbortNode(state, "Failed to read UTXO set hash");
     }
-
+    UpdateUTXOSetHash(utxo_hash, block, blockundo, pindex->nHeight, overwritten, false);
+    mapUTXOSetHashDirty[pindex->GetBlockHash()] = utxo_hash;
     return true;
 }
 
@@ -1806,8 +2098,10 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     // Special case for the genesis block, skipping connection of its transactions
     // (its coinbase is unspendable)
     if (block.GetHash() == chainparams.GetConsensus().hashGenesisBlock) {
-        if (!fJustCheck)
+        if (!fJustCheck) {
             view.SetBestBlock(pindex->GetBlockHash());
+            if (fUTXOSetHash) mapUTXOSetHashDirty[pindex->GetBlockHash()] = CUTXOSetHash();
+        }
         return true;
     }
 
@@ -1856,6 +2150,9 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     // initial block download.
     bool fEnforceBIP30 = !((pindex->nHeight==91842 && pindex->GetBlockHash() == uint256S("0x00000000000a4d0a398161ffc163c503763b1f4360639393e0e4c8e300e0caec")) ||
                            (pindex->nHeight==91880 && pindex->GetBlockHash() == uint256S("0x00000000000743f190a18c5577a3c2d2a1f610ae9601ac046a38084ccb7cd721")));
+    // Only these two blocks overwrite unspent coins; see below for why no
+    // other block can.
+    const bool fOverwritesCoins = !fEnforceBIP30;
 
     // Once BIP34 activated it was not possible to create new duplicate coinbases and thus other than starting
     // with the 2 existing duplicate coinbase pairs, not possible to create overwriting txs.  But by the
@@ -1945,6 +2242,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     LogPrint(BCLog::BENCH, "    - Fork checks: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime2 - nTime1), nTimeForks * MICRO, nTimeForks * MILLI / nBlocksTotal);
 
     CBlockUndo blockundo;
+    std::vector<std::pair<COutPoint, Coin>> overwritten;
 
     CCheckQueueControl<CScriptCheck> control(fScriptChecks && nScriptCheckThreads ? &scriptcheckqueue : nullptr);
 
@@ -2010,6 +2308,12 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         CTxUndo undoDummy;
         if (i > 0) {
             blockundo.vtxundo.push_back(CTxUndo());
+        } else if (fUTXOSetHash && !fJustCheck && fOverwritesCoins) {
+            for (size_t o = 0; o < tx.vout.size(); o++) {
+                const COutPoint out(tx.GetHash(), o);
+                const Coin& coin = view.AccessCoin(out);
+                if (!coin.IsSpent()) overwritten.emplace_back(out, coin);
+            }
         }
         UpdateCoins(tx, view, i == 0 ? undoDummy : blockundo.vtxundo.back(), pindex->nHeight);
     }
@@ -2039,7 +2343,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         setDirtyBlockIndex.insert(pindex);
     }
 
-    if (!WriteTxIndexDataForBlock(block, state, pindex))
+    if (!WriteUTXOSetHashForBlock(block, blockundo, overwritten, state, pindex))
         return false;
 
     assert(pindex->phashBlock);
@@ -2101,7 +2405,9 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
             nLastSetChain = nNow;
         }
         int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
-        int64_t cacheSize = pcoinsTip->DynamicMemoryUsage();
+        // UTXO set hashes not yet written take about 800 bytes per block, so
+        // they count towards the cache as well.
+        int64_t cacheSize = pcoinsTip->DynamicMemoryUsage() + memusage::DynamicUsage(mapUTXOSetHashDirty);
         int64_t nTotalSpace = nCoinCacheUsage + std::max<int64_t>(nMempoolSizeMax - nMempoolUsage, 0);
         // The cache is large and we're within 10% and 10 MiB of the limit, but we have time now (not in the middle of a block processing).
         bool fCacheLarge = mode == FLUSH_STATE_PERIODIC && cacheSize > std::max((9 * nTotalSpace) / 10, nTotalSpace - MAX_BLOCK_COINSDB_USAGE * 1024 * 1024);
@@ -2134,6 +2440,12 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
                     vBlocks.push_back(*it);
                     setDirtyBlockIndex.erase(it++);
                 }
+                if (!mapUTXOSetHashDirty.empty()) {
+                    if (!pblocktree->WriteUTXOSetHashes(mapUTXOSetHashDirty)) {
+                        return AbortNode(state, "Failed to write UTXO set hashes");
+                    }
+                    mapUTXOSetHashDirty.clear();
+                }
                 if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
                     return AbortNode(state, "Failed to write to block index database");
                 }
@@ -2279,9 +2591,11 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
         return false;
 
     if (disconnectpool) {
-        // Save transactions to re-add to mempool at end of reorg
+        // Save transactions to re-add to mempool at end of reorg. They are
+        // copied out of the block so that the mempool does not keep the whole
+        // block's memory alive (see UnserializeTransactionsInArena).
         for (auto it = block.vtx.rbegin(); it != block.vtx.rend(); ++it) {
-            disconnectpool->addTransaction(*it);
+            disconnectpool->addTransaction(MakeTransactionRef(**it));
         }
         while (disconnectpool->DynamicMemoryUsage() > MAX_DISCONNECTED_TX_POOL_SIZE * 1000) {
             // Drop the earliest entry, and remove its children from the mempool.
@@ -2847,7 +3161,8 @@ CBlockIndex* CChainState::AddToBlockIndex(const CBlockHeader& block)
         return it->second;
 
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
+    CBlockIndex* pindexNew = m_block_index_arena.Allocate();
+    *pindexNew = CBlockIndex(block);
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -3730,7 +4045,7 @@ CBlockIndex * CChainState::InsertBlockIndex(const uint256& hash)
         return (*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
+    CBlockIndex* pindexNew = m_block_index_arena.Allocate();
     mi = mapBlockIndex.insert(std::make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
 
@@ -3744,18 +4059,28 @@ bool CChainState::LoadBlockIndex(const Consensus::Params& consensus_params, CBlo
 
     boost::this_thread::interruption_point();
 
-    // Calculate nChainWork
-    std::vector<std::pair<int, CBlockIndex*> > vSortedByHeight;
-    vSortedByHeight.reserve(mapBlockIndex.size());
-    for (const std::pair<uint256, CBlockIndex*>& item : mapBlockIndex)
-    {
-        CBlockIndex* pindex = item.second;
-        vSortedByHeight.push_back(std::make_pair(pindex->nHeight, pindex));
+    const int64_t time_start = GetTimeMicros();
+
+    // Calculate nChainWork. Entries are visited in height order, so that
+    // each entry's predecessor has been visited before it. Heights are
+    // dense, so a counting sort replaces a comparison sort.
+    int max_height = -1;
+    for (const std::pair<const uint256, CBlockIndex*>& item : mapBlockIndex) {
+        max_height = std::max(max_height, item.second->nHeight);
+    }
+    std::vector<size_t> height_offsets(max_height + 2, 0);
+    for (const std::pair<const uint256, CBlockIndex*>& item : mapBlockIndex) {
+        ++height_offsets[item.second->nHeight + 1];
+    }
+    for (size_t i = 1; i < height_offsets.size(); ++i) {
+        height_offsets[i] += height_offsets[i - 1];
+    }
+    std::vector<CBlockIndex*> vSortedByHeight(mapBlockIndex.size());
+    for (const std::pair<const uint256, CBlockIndex*>& item : mapBlockIndex) {
+        vSortedByHeight[height_offsets[item.second->nHeight]++] = item.second;
     }
-    sort(vSortedByHeight.begin(), vSortedByHeight.end());
-    for (const std::pair<int, CBlockIndex*>& item : vSortedByHeight)
+    for (CBlockIndex* pindex : vSortedByHeight)
     {
-        CBlockIndex* pindex = item.second;
         pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) + GetBlockProof(*pindex);
         pindex->nTimeMax = (pindex->pprev ? std::max(pindex->pprev->nTimeMax, pindex->nTime) : pindex->nTime);
         // We can link the chain of blocks for which we've received transactions at some point.
@@ -3786,6 +4111,10 @@ bool CChainState::LoadBlockIndex(const Consensus::Params& consensus_params, CBlo
             pindexBestHeader = pindex;
     }
 
+    LogPrintf("%s: computed chain work of %u block index entries in %.2fs (%.1fMiB)\n", __func__,
+              vSortedByHeight.size(), (GetTimeMicros() - time_start) * 0.000001,
+              m_block_index_arena.DynamicMemoryUsage() * (1.0 / 1024 / 1024));
+
     return true;
 }
 
@@ -3839,10 +4168,6 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     pblocktree->ReadReindexing(fReindexing);
     if(fReindexing) fReindex = true;
 
-    // Check whether we have a transaction index
-    pblocktree->ReadFlag("txindex", fTxIndex);
-    LogPrintf("%s: transaction index %s\n", __func__, fTxIndex ? "enabled" : "disabled");
-
     return true;
 }
 
@@ -4180,6 +4505,8 @@ void CChainState::UnloadBlockIndex() {
     nBlockSequenceId = 1;
     g_failed_blocks.clear();
     setBlockIndexCandidates.clear();
+    mapBlockIndex.clear();
+    m_block_index_arena.Clear();
 }
 
 // May NOT be used after any connections are up as much
@@ -4197,20 +4524,45 @@ void UnloadBlockIndex()
     nLastBlockFile = 0;
     setDirtyBlockIndex.clear();
     setDirtyFileInfo.clear();
+    mapUTXOSetHashDirty.clear();
     versionbitscache.Clear();
     for (int b = 0; b < VERSIONBITS_NUM_BITS; b++) {
         warningcache[b].clear();
     }
 
-    for (BlockMap::value_type& entry : mapBlockIndex) {
-        delete entry.second;
-    }
-    mapBlockIndex.clear();
     fHavePruned = false;
 
     g_chainstate.UnloadBlockIndex();
 }
 
+bool InitUTXOSetHash()
+{
+    LOCK(cs_main);
+    const CBlockIndex* pindex = chainActive.Tip();
+    CUTXOSetHash utxo_hash;
+    // Without a tip, connecting the genesis block starts the hashes
+    if (!fUTXOSetHash || pindex == nullptr || GetUTXOSetHash(pindex, utxo_hash)) return true;
+
+    LogPrintf("Computing the UTXO set hash at height %d, this may take a while...\n", pindex->nHeight);
+    FlushStateToDisk();
+    std::unique_ptr<CCoinsViewCursor> pcursor(pcoinsdbview->Cursor());
+    if (pcursor->GetBestBlock() != pindex->GetBlockHash()) {
+        return error("%s: coins database is not at the tip", __func__);
+    }
+    for (; pcursor->Valid(); pcursor->Next()) {
+        if (ShutdownRequested()) return false;
+        COutPoint key;
+        Coin coin;
+        if (!pcursor->GetKey(key) || !pcursor->GetValue(coin)) {
+            return error("%s: unable to read coin", __func__);
+        }
+        utxo_hash.Add(key, coin);
+    }
+    mapUTXOSetHashDirty[pindex->GetBlockHash()] = utxo_hash;
+    LogPrintf("UTXO set hash at height %d: %s\n", pindex->nHeight, utxo_hash.GetHash().ToString());
+    return true;
+}
+
 bool LoadBlockIndex(const CChainParams& chainparams)
 {
     // Load block index from databases
@@ -4229,9 +4581,6 @@ bool LoadBlockIndex(const CChainParams& chainparams)
         // needs_init.
 
         LogPrintf("Initializing databases...\n");
-        // Use the provided setting for -txindex in the new database
-        fTxIndex = gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX);
-        pblocktree->WriteFlag("txindex", fTxIndex);
     }
     return true;
 }
@@ -4606,6 +4955,47 @@ int VersionBitsTipStateSinceHeight(const Consensus::Params& params, Consensus::D
 
 static const uint64_t MEMPOOL_DUMP_VERSION = 1;
 
+void PrecheckTransactionScripts(const std::vector<CTransactionRef>& txs, CCoinsView& view, unsigned int flags,
+                                std::vector<COutPoint>* coins_to_uncache)
+{
+    AssertLockHeld(cs_main);
+
+    // Outputs of earlier transactions in the batch are added to this view, so
+    // chains of unconfirmed transactions can be checked in one pass.
+    CCoinsViewCache batchView(&view);
+
+    // CScriptCheck keeps a pointer to its PrecomputedTransactionData, so this
+    // vector must not reallocate while the checks are queued.
+    std::vector<PrecomputedTransactionData> txdata;
+    txdata.reserve(txs.size());
+
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    for (const CTransactionRef& tx : txs) {
+        if (tx->IsCoinBase()) {
+            continue;
+        }
+        if (coins_to_uncache) {
+            for (const CTxIn& txin : tx->vin) {
+                if (!pcoinsTip->HaveCoinInCache(txin.prevout)) {
+                    coins_to_uncache->push_back(txin.prevout);
+                }
+            }
+        }
+        if (!batchView.HaveInputs(*tx)) {
+            continue;
+        }
+        txdata.emplace_back(*tx);
+        CValidationState state;
+        std::vector<CScriptCheck> vChecks;
+        CheckInputs(*tx, state, batchView, true, flags, true /* cacheSigStore */, false /* cacheFullScriptStore */, txdata.back(), &vChecks);
+        control.Add(vChecks);
+        AddCoins(batchView, *tx, MEMPOOL_HEIGHT, true);
+    }
+    // A failing check only means that AcceptToMemoryPool will reject the
+    // transaction on its own later; there is nothing to report here.
+    control.Wait();
+}
+
 bool LoadMempool(void)
 {
     const CChainParams& chainparams = Params();
@@ -4623,6 +5013,11 @@ bool LoadMempool(void)
     int64_t already_there = 0;
     int64_t nNow = GetTime();
 
+    int64_t nTimeStart = GetTimeMicros();
+    int64_t nTimeRead = 0;
+    int64_t nTimePrecheck = 0;
+    int64_t nTimeAccept = 0;
+
     try {
         uint64_t version;
         file >> version;
@@ -4631,23 +5026,52 @@ bool LoadMempool(void)
         }
         uint64_t num;
         file >> num;
-        while (num--) {
-            CTransactionRef tx;
-            int64_t nTime;
-            int64_t nFeeDelta;
-            file >> tx;
-            file >> nTime;
-            file >> nFeeDelta;
-
-            CAmount amountdelta = nFeeDelta;
-            if (amountdelta) {
-                mempool.PrioritiseTransaction(tx->GetHash(), amountdelta);
+        while (num) {
+            // Entries are read and processed in batches, so memory use is
+            // bounded by the batch size rather than by the size of the file.
+            int64_t nTime1 = GetTimeMicros();
+            std::vector<CTransactionRef> batch;
+            std::vector<int64_t> batch_times;
+            while (num && batch.size() < MEMPOOL_LOAD_BATCH_SIZE) {
+                --num;
+                CTransactionRef tx;
+                int64_t nTime;
+                int64_t nFeeDelta;
+                file >> tx;
+                file >> nTime;
+                file >> nFeeDelta;
+
+                CAmount amountdelta = nFeeDelta;
+                if (amountdelta) {
+                    mempool.PrioritiseTransaction(tx->GetHash(), amountdelta);
+                }
+                if (nTime + nExpiryTimeout > nNow) {
+                    batch.push_back(std::move(tx));
+                    batch_times.push_back(nTime);
+                } else {
+                    ++expired;
+                }
             }
-            CValidationState state;
-            if (nTime + nExpiryTimeout > nNow) {
+            int64_t nTime2 = GetTimeMicros(); nTimeRead += nTime2 - nTime1;
+
+            // Verify the scripts of the whole batch on the script check
+            // threads first. This fills the signature cache, so the serial
+            // AcceptToMemoryPool calls below do not repeat the ECDSA work.
+            std::vector<COutPoint> coins_to_uncache;
+            if (nScriptCheckThreads) {
+                LOCK2(cs_main, mempool.cs);
+                CCoinsViewMemPool viewMemPool(pcoinsTip.get(), mempool);
+                PrecheckTransactionScripts(batch, viewMemPool, STANDARD_SCRIPT_VERIFY_FLAGS, &coins_to_uncache);
+            }
+            int64_t nTime3 = GetTimeMicros(); nTimePrecheck += nTime3 - nTime2;
+
+            for (size_t i = 0; i < batch.size(); ++i) {
+                const CTransactionRef& tx = batch[i];
+                CValidationState state;
                 LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(chainparams, mempool, state, tx, nullptr /* pfMissingInputs */, nTime,
-                                           nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */);
+                AcceptToMemoryPoolWithTime(chainparams, mempool, state, tx, nullptr /* pfMissingInputs */, batch_times[i],
+                                           nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */,
+                                           false /* test_accept */);
                 if (state.IsValid()) {
                     ++count;
                 } else {
@@ -4661,11 +5085,21 @@ bool LoadMempool(void)
                         ++failed;
                     }
                 }
-            } else {
-                ++expired;
+                if (ShutdownRequested())
+                    return false;
             }
-            if (ShutdownRequested())
-                return false;
+            // AcceptToMemoryPool finds the coins fetched by the precheck
+            // already cached, so it does not uncache them when it rejects a
+            // transaction. Do that here for inputs nothing in the mempool spends.
+            {
+                LOCK(cs_main);
+                for (const COutPoint& outpoint : coins_to_uncache) {
+                    if (!mempool.isSpent(outpoint)) {
+                        pcoinsTip->Uncache(outpoint);
+                    }
+                }
+            }
+            nTimeAccept += GetTimeMicros() - nTime3;
         }
         std::map<uint256, CAmount> mapDeltas;
         file >> mapDeltas;
@@ -4679,6 +5113,8 @@ bool LoadMempool(void)
     }
 
     LogPrintf("Imported mempool transactions from disk: %i succeeded, %i failed, %i expired, %i already there\n", count, failed, expired, already_there);
+    LogPrintf("Loaded mempool: %.2fs total (%.2fs reading, %.2fs checking scripts on %d threads, %.2fs accepting)\n",
+        (GetTimeMicros() - nTimeStart) * MICRO, nTimeRead * MICRO, nTimePrecheck * MICRO, nScriptCheckThreads, nTimeAccept * MICRO);
     return true;
 }
 
@@ -4750,15 +5186,3 @@ double GuessVerificationProgress(const ChainTxData& data, const CBlockIndex *pin
     return pindex->nChainTx / fTxTotal;
 }
 
-class CMainCleanup
-{
-public:
-    CMainCleanup() {}
-    ~CMainCleanup() {
-        // block headers
-        BlockMap::iterator it1 = mapBlockIndex.begin();
-        for (; it1 != mapBlockIndex.end(); it1++)
-            delete (*it1).second;
-        mapBlockIndex.clear();
-    }
-} instance_of_cmaincleanup;
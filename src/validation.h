@@ -32,6 +32,7 @@
 
 class CBlockIndex;
 class CBlockTreeDB;
+class CBlockUndo;
 class CChainParams;
 class CCoinsViewDB;
 class CInv;
@@ -44,6 +45,7 @@ struct ChainTxData;
 
 struct PrecomputedTransactionData;
 struct LockPoints;
+struct CUTXOSetHash;
 
 /** Default for -whitelistrelay. */
 static const bool DEFAULT_WHITELISTRELAY = true;
@@ -65,6 +67,8 @@ static const unsigned int DEFAULT_ANCESTOR_SIZE_LIMIT = 101;
 static const unsigned int DEFAULT_DESCENDANT_LIMIT = 25;
 /** Default for -limitdescendantsize, maximum kilobytes of in-mempool descendants */
 static const unsigned int DEFAULT_DESCENDANT_SIZE_LIMIT = 101;
+/** Maximum number of transactions in a package submitted with AcceptPackageToMemoryPool */
+static const unsigned int MAX_PACKAGE_COUNT = 25;
 /** Default for -mempoolexpiry, expiration time for mempool transactions in hours */
 static const unsigned int DEFAULT_MEMPOOL_EXPIRY = 336;
 /** Maximum kilobytes for transactions to store for processing during reorg */
@@ -130,9 +134,14 @@ static const int64_t MAX_FEE_ESTIMATION_TIP_AGE = 3 * 60 * 60;
 static const bool DEFAULT_PERMIT_BAREMULTISIG = true;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
 static const bool DEFAULT_TXINDEX = false;
+static const bool DEFAULT_ADDRINDEX = false;
+static const bool DEFAULT_BLOCKFILTERINDEX = false;
+static const bool DEFAULT_UTXOSETHASH = false;
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 /** Default for -persistmempool */
 static const bool DEFAULT_PERSIST_MEMPOOL = true;
+/** Number of mempool.dat entries LoadMempool reads and script-checks at a time */
+static const unsigned int MEMPOOL_LOAD_BATCH_SIZE = 1000;
 /** Default for -mempoolreplacement */
 static const bool DEFAULT_ENABLE_REPLACEMENT = true;
 /** Default for using fee filter */
@@ -168,7 +177,7 @@ extern CConditionVariable cvBlockChange;
 extern std::atomic_bool fImporting;
 extern std::atomic_bool fReindex;
 extern int nScriptCheckThreads;
-extern bool fTxIndex;
+extern bool fUTXOSetHash;
 extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
@@ -270,6 +279,10 @@ bool LoadBlockIndex(const CChainParams& chainparams);
 bool LoadChainTip(const CChainParams& chainparams);
 /** Unload database information */
 void UnloadBlockIndex();
+/** With -utxohash, make sure the tip has a UTXO set hash, computing it from the coins database if needed */
+bool InitUTXOSetHash();
+/** Read the UTXO set hash as of a block connected with -utxohash */
+bool GetUTXOSetHash(const CBlockIndex* pindex, CUTXOSetHash& utxo_hash);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
@@ -304,10 +317,21 @@ void PruneAndFlush();
 void PruneBlockFilesManual(int nManualPruneHeight);
 
 /** (try to) add transaction to memory pool
- * plTxnReplaced will be appended to with all transactions replaced from mempool **/
+ * plTxnReplaced will be appended to with all transactions replaced from mempool
+ * @param[in] test_accept  When true, run all the checks but leave the mempool unchanged **/
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx,
                         bool* pfMissingInputs, std::list<CTransactionRef>* plTxnReplaced,
-                        bool bypass_limits, const CAmount nAbsurdFee);
+                        bool bypass_limits, const CAmount nAbsurdFee, bool test_accept=false);
+
+/** (try to) add a package of transactions to memory pool as a unit
+ * The package must be sorted so that parents come before their children. Fee
+ * limits are evaluated against the feerate of the whole package, so a parent
+ * below the mempool minimum fee is accepted if its descendants in the package
+ * pay for it. Every transaction is checked before any is added, so either all
+ * transactions are accepted or none are. A package that conflicts with the
+ * mempool is rejected; packages never replace mempool transactions. **/
+bool AcceptPackageToMemoryPool(CTxMemPool& pool, CValidationState &state, const std::vector<CTransactionRef>& package,
+                               const CAmount nAbsurdFee);
 
 /** Convert CValidationState to a human-readable message for logging */
 std::string FormatStateMessage(const CValidationState &state);
@@ -349,10 +373,13 @@ bool TestLockPointValidity(const LockPoints* lp);
  * of the block needed for calculation or skips the calculation and uses the LockPoints
  * passed in for evaluation.
  * The LockPoints should not be considered valid if CheckSequenceLocks returns false.
+ * The inputs are looked up in coins_view if given, and otherwise in pcoinsTip
+ * with the mempool on top.
  *
  * See consensus/consensus.h for flag definitions.
  */
-bool CheckSequenceLocks(const CTransaction &tx, int flags, LockPoints* lp = nullptr, bool useExistingLockPoints = false);
+bool CheckSequenceLocks(const CTransaction &tx, int flags, LockPoints* lp = nullptr, bool useExistingLockPoints = false,
+                        const CCoinsView* coins_view = nullptr);
 
 /**
  * Closure representing one script verification
@@ -389,13 +416,20 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
-/** Initializes the script-execution cache */
+/** Initializes the script-execution cache. Calling it again empties the cache. */
 void InitScriptExecutionCache();
 
+/** Write the script-execution cache to scriptcache.dat in the data directory */
+bool DumpScriptExecutionCache();
+
+/** Fill the script-execution cache from scriptcache.dat, taking over the nonce its entries were computed with */
+bool LoadScriptExecutionCache();
+
 
 /** Functions for disk access for blocks */
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -490,4 +524,19 @@ bool DumpMempool();
 /** Load the mempool from disk. */
 bool LoadMempool();
 
+/**
+ * Verify the scripts of a batch of transactions on the script check threads,
+ * storing valid signatures in the signature cache. Inputs are looked up in
+ * view or among the outputs of earlier transactions in the batch; transactions
+ * with missing inputs are skipped. This only warms the cache for a following
+ * AcceptToMemoryPool and does not decide validity. Requires cs_main.
+ *
+ * Looking up inputs pulls their coins into pcoinsTip. If coins_to_uncache is
+ * given, the inputs that were not cached there before are appended to it, so
+ * the caller can uncache those of transactions it ends up rejecting, as
+ * AcceptToMemoryPool does for its own lookups.
+ */
+void PrecheckTransactionScripts(const std::vector<CTransactionRef>& txs, CCoinsView& view, unsigned int flags,
+                                std::vector<COutPoint>* coins_to_uncache = nullptr);
+
 #endif // BITCOIN_VALIDATION_H
@@ -4,6 +4,7 @@
 
 #include <wallet/wallet.h>
 
+#include <deque>
 #include <set>
 #include <stdint.h>
 #include <utility>
@@ -201,7 +202,11 @@ static int64_t AddTx(CWallet& wallet, uint32_t lockTime, int64_t mockTime, int64
     CBlockIndex* block = nullptr;
     if (blockTime > 0) {
         LOCK(cs_main);
-        auto inserted = mapBlockIndex.emplace(GetRandHash(), new CBlockIndex);
+        // Block index entries are owned by an arena in validation, so these
+        // test entries are kept here for the lifetime of the test binary.
+        static std::deque<CBlockIndex> block_indexes;
+        block_indexes.emplace_back();
+        auto inserted = mapBlockIndex.emplace(GetRandHash(), &block_indexes.back());
         assert(inserted.second);
         const uint256& hash = inserted.first->first;
         block = inserted.first->second;
@@ -1052,7 +1052,11 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransactionRef& ptx, const CBlockI
                 }
             }
 
-            CWalletTx wtx(this, ptx);
+            // Keep a copy, so the wallet does not keep the whole memory of the
+            // block ptx may come from alive (see UnserializeTransactionsInArena).
+            // That includes transactions of disconnected blocks, which have no
+            // pIndex.
+            CWalletTx wtx(this, MakeTransactionRef(*ptx));
 
             // Get merkle branch if transaction was found in a block
             if (pIndex != nullptr)